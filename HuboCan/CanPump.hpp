@@ -116,6 +116,15 @@ public:
         return (double)(_deadline.tv_sec)+(double)(_deadline.tv_nsec)/1E9;
     }
 
+    /*!
+     * \brief Time at which the frame currently being decoded was received. Devices should use
+     * this to timestamp their readings.
+     */
+    inline double last_frame_time_value()
+    {
+        return (double)(_frame_time.tv_sec)+(double)(_frame_time.tv_nsec)/1E9;
+    }
+
     inline const ChannelHandle& channel(size_t num)
     {
         if(num < _channels.size())
@@ -156,6 +165,7 @@ protected:
     bool _first_tick;
     double _timestep;
     timespec_t _deadline;
+    timespec_t _frame_time;
     
     int _get_max_frame_count();
     int _get_max_frame_expectation();
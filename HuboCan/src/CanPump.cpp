@@ -51,6 +51,7 @@ CanPump::CanPump(double nominal_frequency, double bitrate, size_t channels, size
     _can_error = false;
     _first_tick = true;
     zero_clock(_deadline);
+    zero_clock(_frame_time);
     
     _bitrate = bitrate;
     
@@ -261,6 +262,8 @@ void CanPump::_wait_on_next_frames(const timespec_t &timeout)
 
 void CanPump::_decode_frame(const can_frame_t& frame, size_t channel)
 {
+    clock_gettime(CLOCK_MONOTONIC, &_frame_time);
+
     bool decoded = false;
     for(size_t i=0; i<_devices.size(); ++i)
     {
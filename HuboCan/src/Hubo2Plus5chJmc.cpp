@@ -89,8 +89,8 @@ bool Hubo2Plus5chJmc::_decode_encoder_reading(const can_frame_t &frame)
         encoder = (encoder << 8) + frame.data[0 + i*2];
 
         size_t joint_index = joints[i]->info.software_index;
-        _state->joints[joint_index].position =
-                joints[i]->encoder2radian(encoder);
+        _state->set_joint_position(joint_index, joints[i]->encoder2radian(encoder),
+                                   _pump->last_frame_time_value());
 
         joints[i]->updated = true;
     }
@@ -189,10 +189,8 @@ bool Hubo2PlusBasicJmc::_decode_encoder_reading(const can_frame_t& frame)
 
             size_t joint_index = joints[i]->info.software_index;
 
-            _state->joints[joint_index].position =
-                        joints[i]->encoder2radian(encoder);
-
-            // TODO: Decide if velocity should be computed here
+            _state->set_joint_position(joint_index, joints[i]->encoder2radian(encoder),
+                                       _pump->last_frame_time_value());
 
             joints[i]->updated = true;
             ++joints[i]->received_replies;
@@ -308,6 +306,10 @@ void Hubo2PlusBasicJmc::_handle_home_joint(const hubo_aux_cmd_t& cmd)
 
     _pump->add_frame(_frame, info.can_channel);
 
+    // The encoder reading will jump once the joint is homed, so the old samples should not be
+    // used for estimating its velocity.
+    _state->joint_estimator.reset(joints[cmd.component_id]->info.software_index);
+
     // TODO: Decide what other bookkeeping should be done when a joint gets homed.
 }
 
@@ -337,6 +339,9 @@ void Hubo2PlusBasicJmc::_handle_home_all_joints()
 
     _pump->add_frame(_frame, info.can_channel);
 
+    for(size_t i=0; i<joints.size(); ++i)
+        _state->joint_estimator.reset(joints[i]->info.software_index);
+
     // TODO: Decide what other bookkeeping should be done when a joint gets homed.
 }
 
@@ -117,6 +117,8 @@ bool Hubo2PlusImu::decode(const can_frame_t& frame, size_t channel)
 
         data.angular_velocity[2] = 0.0;
 
+        _state->estimate_imu(_index, _pump->last_frame_time_value());
+
         return true;
     }
 
@@ -202,8 +204,12 @@ bool Hubo2PlusTilt::decode(const can_frame_t& frame, size_t channel)
         val = (frame.data[5] << 8) | frame.data[4];
         state.angular_position[2] = (double)(val)/750.0 * M_PI/180.0;
 
+        // The tilt sensors have no rate measurements to fuse with
         for(size_t i=0; i<3; ++i)
+        {
             state.angular_velocity[i] = 0.0;
+            state.estimated_position[i] = state.angular_position[i];
+        }
 
         return true;
     }
@@ -39,6 +39,7 @@
 #include "HuboCmd/Commander.hpp"
 #include "HuboCmd/Aggregator.hpp"
 #include "HuboState/State.hpp"
+#include "HuboState/hubo_delta_c.h"
 #include "HuboPath/hubo_path.hpp"
 #include "HuboRT/LogRelay.hpp"
 
@@ -52,9 +53,13 @@ int main(int argc, char* argv[])
                           +":10:4096:"+ACHD_PULL_STRING+":");
 
     mgr.register_new_chan(std::string("command:")+HUBO_CMD_CHANNEL
-                          +":10:4096:"+ACHD_INTERNAL_STRING+":");
+                          +":10:8192:"+ACHD_INTERNAL_STRING+":");
+    mgr.register_new_chan(std::string("cmd_stats:")+HUBO_CMD_STATS_CHANNEL
+                          +":10:4096:"+ACHD_PULL_STRING+":");
+    mgr.register_new_chan(std::string("cmd_owners:")+HUBO_CMD_OWNERS_CHANNEL
+                          +":10:4096:"+ACHD_PULL_STRING+":");
     mgr.register_new_chan(std::string("aggregate:")+HUBO_AGG_CHANNEL
-                          +":20:4096:"+ACHD_INTERNAL_STRING+":");
+                          +":20:8192:"+ACHD_INTERNAL_STRING+":");
     mgr.register_new_chan(std::string("auxiliary:")+HUBO_AUX_CMD_CHANNEL
                           +":100:64:"+ACHD_PUSH_STRING+":");
 
@@ -64,11 +69,13 @@ int main(int argc, char* argv[])
                           +":10:4096:"+ACHD_PULL_STRING+":");
     mgr.register_new_chan(std::string("ft_state:")+HUBO_FT_SENSOR_CHANNEL
                           +":10:4096:"+ACHD_PULL_STRING+":");
+    mgr.register_new_chan(std::string("state_delta:")+HUBO_DELTA_CHANNEL
+                          +":10:4096:"+ACHD_PULL_STRING+":");
 
     mgr.register_new_chan(std::string("instruction:")+HUBO_PATH_INSTRUCTION_CHANNEL
                           +":5:64:"+ACHD_PUSH_STRING+":");
     mgr.register_new_chan(std::string("trajectory:")+HUBO_PATH_INPUT_CHANNEL
-                          +":3:65536:"+ACHD_PUSH_STRING+":");
+                          +":16:65536:"+ACHD_PUSH_STRING+":");
     mgr.register_new_chan(std::string("traj_rx_feedback:")+HUBO_PATH_FEEDBACK_CHANNEL
                           +":5:64:"+ACHD_PULL_STRING+":");
     mgr.register_new_chan(std::string("player:")+HUBO_PATH_PLAYER_STATE_CHANNEL
@@ -82,6 +89,8 @@ int main(int argc, char* argv[])
                           + ":/usr/bin/huboplayer::");
     mgr.register_new_proc(std::string("log_publisher")
                           + ":/usr/bin/hubo_log_publisher::");
+    mgr.register_new_proc(std::string("state_delta")
+                          + ":/usr/bin/hubo_state_bridge:encode:");
 
 
     std::string robot_type = "Hubo2Plus";
@@ -38,6 +38,8 @@
 
 #include <vector>
 #include <map>
+#include <pthread.h>
+#include <Eigen/Core>
 
 extern "C" {
 #include "HuboCmd/hubo_cmd_c.h"
@@ -46,14 +48,22 @@ extern "C" {
 #include "HuboCan/HuboDescription.hpp"
 #include "HuboCan/AchIncludes.hpp"
 #include "HuboRT/Daemonizer.hpp"
+#include "HuboState/StateNotifier.hpp"
+#include "HuboCmd/CmdSlots.hpp"
 
 #define HUBO_AGG_CHANNEL "hubo_agg"
 
+namespace HuboState {
+class State;
+} // namespace HuboState
+
 namespace HuboCmd {
 
 typedef std::vector<pid_t> PidArray;
 typedef std::map<pid_t,bool> PidBoolMap;
 typedef std::vector<hubo_joint_cmd_t> JointCmdArray;
+typedef std::vector<hubo_joint_owner_t> JointOwnerArray;
+typedef std::vector<hubo_cmd_safety_counts_t> SafetyCountArray;
 
 class Aggregator
 {
@@ -67,8 +77,36 @@ public:
     bool open_channels();
     void close_channels();
 
+    /*!
+     * \fn run()
+     * \brief Fork the aggregator into its own daemon process
+     *
+     * The daemon reads commands from hubo_cmd and publishes the collated result on hubo_agg,
+     * which update() then reads from.
+     */
     bool run();
 
+    /*!
+     * \fn run_thread(int priority)
+     * \brief Run the aggregator as a real-time thread inside the calling process
+     * \param priority SCHED_FIFO priority of the thread. It should be a bit below the priority
+     * of the CAN pump. If it cannot be set, the thread will run with the default scheduler.
+     *
+     * Instead of re-publishing on hubo_agg, the thread hands the collated commands directly to
+     * update() through a lock-free triple buffer, which saves an ach copy and a process hop for
+     * every command. Use either this or run(), but not both.
+     */
+    bool run_thread(int priority = 48);
+
+    /*!
+     * \fn stop_thread()
+     * \brief Stop the aggregator thread and wait for it to finish. This is called automatically
+     * by the destructor.
+     */
+    void stop_thread();
+
+    inline bool is_threaded() const { return _threaded; }
+
     const JointCmdArray& update();
     
     inline JointCmdArray& last_commands()
@@ -84,6 +122,51 @@ public:
         return _aggregated_cmds[index];
     }
 
+    /*!
+     * \fn stats()
+     * \brief Latency and expiry statistics for each process which has sent commands. These are
+     * only filled in where the aggregation happens (the aggregator process or thread). Other
+     * processes can read them from the hubo_cmd_stats channel.
+     */
+    inline const hubo_cmd_stats_t& stats() const { return _stats; }
+
+    /*!
+     * \fn owners()
+     * \brief Who owns each joint, at what priority, and who it will be handed back to. Like
+     * stats(), this is only filled in where the aggregation happens, and gets published on the
+     * hubo_cmd_owners channel.
+     */
+    inline const JointOwnerArray& owners() const { return _owners; }
+
+    /*!
+     * \fn set_safety_policy(hubo_cmd_safety_policy_t policy)
+     * \brief Choose what update() does with references which violate the joint limits
+     *
+     * Every cycle, update() checks the final reference of each RIGID or HYBRID joint against the
+     * position, speed, and acceleration limits in its hubo_joint_limits_t, where the speed and
+     * acceleration are measured against the references of the previous cycles. A limit of zero
+     * (or a min_position which is not below max_position) is treated as unlimited. The default
+     * policy is HUBO_CMD_SAFETY_CLAMP.
+     */
+    void set_safety_policy(hubo_cmd_safety_policy_t policy);
+    inline hubo_cmd_safety_policy_t get_safety_policy() const { return _safety_policy; }
+
+    /*!
+     * \fn set_state(const HuboState::State* state)
+     * \brief Give the safety check access to the latest measured joint positions
+     *
+     * When a joint starts being commanded, its speed and acceleration limits are then applied
+     * starting from where the joint actually is, rather than from its first reference. The state
+     * must be updated by the same thread that calls update(), which is the case for the pump.
+     */
+    void set_state(const HuboState::State* state);
+
+    /*!
+     * \fn safety_counts()
+     * \brief The number of limit violations which update() has found for each joint
+     */
+    inline const SafetyCountArray& safety_counts() const { return _safety_counts; }
+
 protected:
 
     bool _memory_set;
@@ -96,33 +179,92 @@ protected:
     void _init_aggregator();
     void _aggregator_loop();
     void _quit_aggregator();
+    bool _keep_running();
+    static void* _aggregator_thread(void* aggregator);
 
+    size_t _drain_input();
+    bool _check_input(size_t frame_size);
+    void _load_limits();
     void _check_hubocan_state();
+    void _report_safety(double now);
     void _collate_input();
     bool _resolve_ownership(size_t joint_index);
+    void _release_joint(size_t joint_index);
+    void _report_conflict(size_t joint_index, pid_t pid, uint8_t priority);
     void _accept_command(size_t joint_index);
+    bool _expire_commands(double now);
+    void _evaluate_received_cmds(double now);
     void _send_output();
 
-    PidArray _pids;
+    hubo_cmd_owner_stats_t* _owner_stats(pid_t pid, bool create);
+    void _record_message(const hubo_cmd_data* data);
+    void _publish_stats(double now);
+    void _publish_owners();
+    hubo_cmd_stats_t _stats;
+    double _receive_time;
+    double _last_stats_publish;
+
+    JointOwnerArray _owners;
+    std::vector<double> _conflict_report_time;
+    std::vector<uint32_t> _conflicts_reported;
+    std::vector<uint8_t> _owners_message;
+    bool _owners_changed;
     PidBoolMap _reception_check;
 
-    hubo_joint_cmd_t _container;
+    hubo_joint_cmd_t _container; // Only for the aggregator loop
 
     hubo_cmd_data* _input_data;
     hubo_cmd_data* _output_data;
 
     hubo_cmd_data* _final_data;
+    JointCmdArray _received_cmds;
     JointCmdArray _aggregated_cmds;
-    void _copy_final_data_to_array();
+    void _copy_data_to_array(const hubo_cmd_data* data);
 
     HuboCan::HuboDescription _desc;
 
+    // The safety check works on one array per quantity, so that the whole robot gets checked
+    // by a handful of vectorized operations. Speeds and accelerations are converted into the
+    // largest step (and change of step) that a reference may take in one cycle.
+    hubo_cmd_safety_policy_t _safety_policy;
+    const HuboState::State* _state;
+    Eigen::ArrayXd _min_position;
+    Eigen::ArrayXd _max_position;
+    Eigen::ArrayXd _max_step;
+    Eigen::ArrayXd _max_step_change;
+    Eigen::ArrayXd _reference;
+    Eigen::ArrayXd _previous_reference;
+    Eigen::ArrayXd _previous_step;
+    Eigen::ArrayXd _active;
+    Eigen::ArrayXd _resting;
+    SafetyCountArray _safety_counts;
+    SafetyCountArray _safety_reported;
+    double _safety_report_time;
+
     ach_channel_t _cmd_chan;
     ach_channel_t _agg_chan;
+    ach_channel_t _stats_chan;
+    bool _stats_opened;
+    ach_channel_t _owners_chan;
+    bool _owners_opened;
+
+    CmdSlots _slots;
 
     pid_t _child;
     size_t _child_death_count;
 
+    // Thread mode: the thread owns _handoff_write, update() owns _handoff_read, and
+    // _handoff holds the index of the third buffer, plus _handoff_fresh if it has not been
+    // read yet. The buffers are only ever exchanged through atomic operations on _handoff.
+    bool _threaded;
+    int _thread_active;
+    pthread_t _thread;
+    hubo_cmd_data* _handoff_data[3];
+    unsigned int _handoff;
+    unsigned int _handoff_write;
+    unsigned int _handoff_read;
+    static const unsigned int _handoff_fresh = 0x04;
+
     HuboRT::Daemonizer _rt;
 
     Aggregator(const Aggregator& doNotCopy);
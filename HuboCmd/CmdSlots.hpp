@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HUBOCMD_CMDSLOTS_HPP
+#define HUBOCMD_CMDSLOTS_HPP
+
+extern "C" {
+#include "HuboCmd/hubo_cmd_c.h"
+}
+
+#include <string>
+
+namespace HuboCmd {
+
+/*!
+ * \class CmdSlots
+ * \brief Lock-free shared memory transport between Commanders and the Aggregator.
+ *
+ * The Aggregator create()s the slot table, and each Commander attach()es to it and claim()s a
+ * slot of its own. A commander write()s its latest message into its slot, and the aggregator
+ * read()s every slot once per cycle. Each slot is a seqlock with exactly one writer and one
+ * reader, so neither side ever waits on the other. Nothing gets allocated after the table has
+ * been mapped.
+ */
+class CmdSlots
+{
+public:
+
+    CmdSlots(const std::string& shm_name = HUBO_CMD_SLOTS_SHM);
+    ~CmdSlots();
+
+    /*!
+     * \fn create(size_t total_num_joints)
+     * \brief Create a fresh slot table. Any table left over from before is marked as closed so
+     * that commanders which are still attached to it know to move over.
+     */
+    bool create(size_t total_num_joints);
+
+    /*!
+     * \fn attach(size_t total_num_joints, bool verbose)
+     * \brief Map an existing slot table. Fails if no table exists or if it was made for a
+     * different number of joints.
+     */
+    bool attach(size_t total_num_joints, bool verbose = true);
+
+    void detach();
+
+    inline bool attached() const { return _table != NULL; }
+
+    /*!
+     * \fn closed()
+     * \brief True if the aggregator has abandoned this table, so the commander should detach()
+     * and attach() again.
+     */
+    bool closed() const;
+
+    /*!
+     * \fn claim()
+     * \brief Claim a free slot for this process. Slots of processes which no longer exist get
+     * recycled.
+     * \return The slot index, or -1 if every slot is taken
+     */
+    int claim();
+
+    void release(int slot);
+
+    /*!
+     * \fn write(int slot, const hubo_cmd_data* data, size_t size)
+     * \brief Publish a message into a slot that was claim()ed by this process
+     */
+    bool write(int slot, const hubo_cmd_data* data, size_t size);
+
+    /*!
+     * \fn consumed(int slot)
+     * \brief True if the reader has picked up the last message written into this slot. If not,
+     * the next write() will replace it before it is ever seen.
+     */
+    bool consumed(int slot) const;
+
+    /*!
+     * \fn read(size_t slot, hubo_cmd_data* output, size_t max_size, size_t& size)
+     * \brief Copy out the message in a slot if it has been written since the last read()
+     * \return True if a new and consistent message was copied into output
+     */
+    bool read(size_t slot, hubo_cmd_data* output, size_t max_size, size_t& size);
+
+    inline size_t slot_count() const { return _table ? _table->slot_count : 0; }
+
+protected:
+
+    hubo_cmd_slot_t* _slot(size_t index) const;
+    bool _map(int fd, size_t size, bool verbose);
+
+    std::string _name;
+    hubo_cmd_slot_table_t* _table;
+    size_t _mapped_size;
+    bool _owner;
+
+    uint32_t _last_sequence[HUBO_CMD_MAX_SLOTS];
+
+    CmdSlots(const CmdSlots& doNotCopy);
+    CmdSlots& operator=(const CmdSlots& doNotCopy);
+};
+
+} // namespace HuboCmd
+
+#endif // HUBOCMD_CMDSLOTS_HPP
@@ -37,11 +37,41 @@
 #define HUBOCMD_HUBOCOMMANDER_HPP
 
 #include "HuboState/State.hpp"
+#include "HuboCmd/CmdSlots.hpp"
+
+#include <Eigen/Core>
 
 namespace HuboCmd {
 
 typedef std::vector<hubo_cmd_mode_t> ModeArray;
 
+/*!
+ * \class JointGroup
+ * \brief A set of joints which Commander::create_group() has validated once, so that the bulk
+ * setters and getters can write straight into the command data in a single pass.
+ *
+ * A group stays valid until the Commander loads a different HuboDescription.
+ */
+class JointGroup
+{
+public:
+
+    JointGroup();
+
+    inline size_t size() const { return _indices.size(); }
+    inline const IndexArray& indices() const { return _indices; }
+
+protected:
+
+    friend class Commander;
+
+    IndexArray _indices;
+    std::vector<size_t> _offsets; // Byte offset of each joint's command within the command data
+    std::vector<hubo_cmd_bitmap_t> _masks; // Bitmap words which register every joint in the group
+    size_t _generation;
+
+};
+
 class Commander : public HuboState::State
 {
 public:
@@ -63,6 +93,22 @@ public:
     float       get_position_cmd(size_t joint_index);
     ValueArray  get_position_cmds(const IndexArray& joints);
 
+    /*!
+     * \fn set_setpoints(size_t joint_index, const ValueArray& times, const ValueArray& positions)
+     * \brief Send a short horizon of future positions instead of a single position
+     * \param times When each position should be reached, in the hubo_cmd_time_now() clock and in
+     * increasing order
+     * \param positions The position references, at most HUBO_CMD_MAX_SETPOINTS of them
+     *
+     * The pump interpolates between the setpoints at its own rate, so a slow or jittery client
+     * still produces a smooth, full-rate reference. Calling set_position() on the joint goes back
+     * to sending a single position.
+     */
+    HuboCan::error_result_t set_setpoints(size_t joint_index, const ValueArray& times,
+                                          const ValueArray& positions);
+
+    size_t      get_setpoint_count(size_t joint_index);
+
     HuboCan::error_result_t set_base_torque(size_t joint_index, double value);
     HuboCan::error_result_t set_base_torques(const IndexArray& joints, const ValueArray& values);
 
@@ -84,6 +130,33 @@ public:
     size_t      get_index(const std::string& joint_name);
     IndexArray  get_indices(const StringArray& joint_names);
 
+    /*!
+     * \fn create_group(const IndexArray& joints)
+     * \brief Validate a set of joints for use with the bulk setters and getters
+     * \return An empty group if any of the joints are out of bounds
+     */
+    JointGroup  create_group(const IndexArray& joints);
+    JointGroup  create_group(const StringArray& joint_names);
+    bool        is_valid(const JointGroup& group) const;
+
+    HuboCan::error_result_t set_modes(const JointGroup& group, hubo_cmd_mode_t mode);
+
+    HuboCan::error_result_t set_positions(const JointGroup& group, const Eigen::VectorXd& values);
+    HuboCan::error_result_t set_positions(const JointGroup& group, const double* values, size_t count);
+    HuboCan::error_result_t get_position_cmds(const JointGroup& group, Eigen::VectorXd& values);
+
+    HuboCan::error_result_t set_base_torques(const JointGroup& group, const Eigen::VectorXd& values);
+    HuboCan::error_result_t set_base_torques(const JointGroup& group, const double* values, size_t count);
+    HuboCan::error_result_t get_base_torque_cmds(const JointGroup& group, Eigen::VectorXd& values);
+
+    HuboCan::error_result_t set_kp_gains(const JointGroup& group, const Eigen::VectorXd& values);
+    HuboCan::error_result_t set_kp_gains(const JointGroup& group, const double* values, size_t count);
+    HuboCan::error_result_t get_kp_gain_cmds(const JointGroup& group, Eigen::VectorXd& values);
+
+    HuboCan::error_result_t set_kd_gains(const JointGroup& group, const Eigen::VectorXd& values);
+    HuboCan::error_result_t set_kd_gains(const JointGroup& group, const double* values, size_t count);
+    HuboCan::error_result_t get_kd_gain_cmds(const JointGroup& group, Eigen::VectorXd& values);
+
     inline size_t get_joint_count()
     {
         return _desc.getJointCount();
@@ -92,6 +165,44 @@ public:
     virtual HuboCan::error_result_t update(double timeout_sec=1, bool report_sync = true);
     HuboCan::error_result_t send_commands();
 
+    /*!
+     * \fn set_validity(double horizon, hubo_cmd_expiry_t expiry)
+     * \brief Give every command sent from now on a deadline
+     * \param horizon How many seconds after being sent a command stays valid. If no newer command
+     * arrives before then, the aggregator and the pump apply the expiry policy. A horizon of zero
+     * (the default) means commands never expire.
+     * \param expiry What should happen to a joint once its command has expired
+     */
+    void set_validity(double horizon, hubo_cmd_expiry_t expiry = HUBO_CMD_EXPIRE_HOLD);
+
+    inline double get_validity_horizon() const { return _validity_horizon; }
+
+    /*!
+     * \fn set_priority(uint8_t priority)
+     * \brief Set the ownership priority of this commander (see hubo_cmd_priority_t)
+     *
+     * A higher priority commander takes joints away from lower priority owners, and hands them
+     * back when it releases them. Commanders of equal priority can only take joints from each
+     * other with HUBO_CMD_CLAIM.
+     */
+    inline void set_priority(uint8_t priority) { _priority = priority; }
+    inline uint8_t get_priority() const { return _priority; }
+
+    /*!
+     * \fn set_keepalive(double period)
+     * \brief Only send joints whose commands have changed, plus a refresh of every joint at
+     * least once per period
+     * \param period Seconds between refreshes of an unchanged joint (0.25 by default). If a
+     * validity horizon is set, refreshes happen at least twice per horizon. A period of zero or
+     * less sends every joint on every call to send_commands().
+     *
+     * The aggregator holds on to the last command it accepted for each joint, so a joint that
+     * is not resent keeps doing what it was told.
+     */
+    inline void set_keepalive(double period) { _keepalive = period; }
+    inline double get_keepalive() const { return _keepalive; }
+    inline hubo_cmd_expiry_t get_expiry_policy() const { return _expiry_policy; }
+
     HuboCan::error_result_t release_joint(size_t joint_index);
     HuboCan::error_result_t release_joints(const IndexArray& joints);
     void release_joints();
@@ -117,8 +228,38 @@ protected:
     HuboCan::error_result_t _register_joint(size_t joint_index);
     void _fill_container(size_t joint_index);
 
+    template<class Field>
+    HuboCan::error_result_t _set_group_values(const JointGroup& group, const double* values,
+                                              size_t count);
+    template<class Field>
+    HuboCan::error_result_t _get_group_values(const JointGroup& group, Eigen::VectorXd& values);
+    size_t _cmd_generation;
+
     hubo_cmd_data* _compressed_data;
 
+    bool _send_to_slot(size_t size);
+
+    size_t _select_joints_to_send(double now);
+    double _keepalive;
+    std::vector<hubo_joint_cmd_t> _last_sent;
+    std::vector<double> _last_sent_time;
+    std::vector<hubo_cmd_bitmap_t> _send_mask;
+    std::vector<hubo_cmd_bitmap_t> _unconsumed_mask;
+
+    // The aggregator's ownership table, which tells us when a joint has been handed back
+    void _update_ownership();
+    bool _owners_opened;
+    ach_channel_t _owners_chan;
+    std::vector<uint8_t> _owners_buffer;
+    std::vector<uint8_t> _owned;
+    CmdSlots _slots;
+    int _slot;
+    size_t _slot_retry;
+
+    double _validity_horizon;
+    hubo_cmd_expiry_t _expiry_policy;
+    uint8_t _priority;
+
     hubo_joint_cmd_t _container;
 
     ach_channel_t _cmd_chan;
@@ -45,7 +45,7 @@
 #define HUBO_CMD_CHANNEL "hubo_cmd"
 
 //                            123456789012345
-#define HUBO_CMD_HEADER_CODE "CMDHEADER_V0.01"
+#define HUBO_CMD_HEADER_CODE "CMDHEADER_V0.05"
 #define HUBO_CMD_HEADER_CODE_SIZE 16 // including null-terminator \0
 
 typedef uint8_t hubo_cmd_data;
@@ -63,16 +63,43 @@ typedef enum hubo_data_error {
 
 } hubo_data_error_t;
 
+/*
+ * The header is followed by a bitmap of hubo_cmd_data_bitmap_words(total_num_joints) 64-bit
+ * words, where bit (joint_index % 64) of word (joint_index / 64) indicates whether that joint has
+ * been set. The joint commands come after the bitmap. In compressed data, only the commands of
+ * the joints which are set are included, in order of increasing joint index.
+ */
 typedef struct hubo_cmd_header {
 
     char code[HUBO_CMD_HEADER_CODE_SIZE];
-    uint16_t pid;
+    int32_t pid;
     uint8_t is_compressed;
     uint16_t total_num_joints;
-    uint64_t bitmap;
+    uint8_t priority; // See hubo_cmd_priority_t
+    double send_time; // hubo_cmd_time_now() at the moment the message was sent. 8-byte aligned,
+                      // as are the bitmap words which follow the header
 
 }__attribute__((packed)) hubo_cmd_header_t;
 
+/*
+ * A command from a higher priority process takes a joint away from a lower priority owner. The
+ * joint is handed back once the higher priority process releases it. Values in between these
+ * are allowed for finer distinctions.
+ */
+typedef enum hubo_cmd_priority {
+
+    HUBO_CMD_PRIORITY_TELEOP        = 10,
+    HUBO_CMD_PRIORITY_MANIPULATION  = 20,
+    HUBO_CMD_PRIORITY_BALANCE       = 30,
+    HUBO_CMD_PRIORITY_SAFETY        = 40
+
+} hubo_cmd_priority_t;
+
+#define HUBO_CMD_DEFAULT_PRIORITY HUBO_CMD_PRIORITY_MANIPULATION
+
+typedef uint64_t hubo_cmd_bitmap_t;
+#define HUBO_CMD_BITMAP_WORD_BITS 64
+
 typedef enum hubo_cmd_mode {
 
     HUBO_CMD_IGNORE = 0,
@@ -85,6 +112,31 @@ typedef enum hubo_cmd_mode {
 
 } hubo_cmd_mode_t;
 
+/*
+ * What happens to a joint command once its deadline has passed without a fresh command
+ * arriving to replace it
+ */
+typedef enum hubo_cmd_expiry {
+
+    HUBO_CMD_EXPIRE_HOLD = 0,   // Keep holding the last reference
+    HUBO_CMD_EXPIRE_COMPLY,     // Drop the gains and torque, and switch to compliant mode
+    HUBO_CMD_EXPIRE_RELEASE     // Stop sending references, and give up ownership of the joint
+
+} hubo_cmd_expiry_t;
+
+#define HUBO_CMD_MAX_SETPOINTS 4
+
+/*
+ * A future position reference. When a joint command contains setpoints, the pump interpolates
+ * between them at its own rate instead of using the command's position directly.
+ */
+typedef struct hubo_cmd_setpoint {
+
+    double time; // In the hubo_cmd_time_now() clock
+    float position;
+
+}__attribute__((packed)) hubo_cmd_setpoint_t;
+
 typedef struct hubo_joint_cmd {
 
     hubo_cmd_mode_t mode;
@@ -93,13 +145,143 @@ typedef struct hubo_joint_cmd {
     double kP_gain;
     double kD_gain;
 
+    double deadline; // hubo_cmd_time_now() after which this command is stale. 0 means it never expires
+    hubo_cmd_expiry_t expiry;
+
+    uint8_t setpoint_count; // 0 means the position is used as-is
+    hubo_cmd_setpoint_t setpoints[HUBO_CMD_MAX_SETPOINTS]; // In order of increasing time
+
 }__attribute__((packed)) hubo_joint_cmd_t;
 
+#define HUBO_CMD_STATS_CHANNEL "hubo_cmd_stats"
+#define HUBO_CMD_MAX_STATS_OWNERS 32
+
+typedef struct hubo_cmd_owner_stats {
+
+    int32_t pid;
+    uint32_t messages;      // Number of command messages received from this owner
+    uint32_t late;          // Number of joint commands which had already expired on arrival
+    uint32_t expired;       // Number of joint commands which expired before being replaced
+    double last_time;       // When the last message from this owner arrived
+    double last_latency;    // Seconds between sending and collation
+    double mean_latency;
+    double max_latency;
+
+}__attribute__((packed)) hubo_cmd_owner_stats_t;
+
+typedef struct hubo_cmd_stats {
+
+    double time;
+    uint32_t owner_count;
+    hubo_cmd_owner_stats_t owners[HUBO_CMD_MAX_STATS_OWNERS];
+
+}__attribute__((packed)) hubo_cmd_stats_t;
+
+/*
+ * What the pump does with a reference which would violate the joint's limits
+ */
+typedef enum hubo_cmd_safety_policy {
+
+    HUBO_CMD_SAFETY_OFF = 0,    // Pass every reference through untouched
+    HUBO_CMD_SAFETY_CLAMP,      // Move the reference as far toward the command as the limits allow
+    HUBO_CMD_SAFETY_REJECT      // Keep holding the last safe reference
+
+} hubo_cmd_safety_policy_t;
+
+typedef struct hubo_cmd_safety_counts {
+
+    uint32_t position;      // References outside of [min_position, max_position]
+    uint32_t velocity;      // Steps from the previous reference which were faster than max_speed
+    uint32_t acceleration;  // Changes of velocity which were sharper than max_accel
+    uint32_t rejected;      // Cycles where the previous reference was held instead
+
+}__attribute__((packed)) hubo_cmd_safety_counts_t;
+
+#define HUBO_CMD_SLOTS_SHM "/hubo_cmd_slots"
+//                             123456789012345
+#define HUBO_CMD_SLOTS_CODE   "CMDSLOTS_V0.02"
+#define HUBO_CMD_MAX_SLOTS 16
+#define HUBO_CMD_SLOT_ALIGNMENT 64
+
+/*
+ * Shared memory table of per-commander command slots. The table header is followed by
+ * slot_count slots, each slot_size bytes apart. Every slot begins with a hubo_cmd_slot_t and is
+ * followed by up to data_capacity bytes of (compressed) hubo_cmd_data.
+ *
+ * Each slot has a single writer (the process in owner) and a single reader (the aggregator).
+ * The writer makes sequence odd while it is copying and even again once it is done, so the
+ * reader can tell a torn copy from a consistent one without taking any locks.
+ */
+typedef struct hubo_cmd_slot_table {
+
+    char code[HUBO_CMD_HEADER_CODE_SIZE];
+    uint32_t closed; // Set when the aggregator abandons this table
+    uint32_t slot_count;
+    uint64_t slot_size;
+    uint64_t data_capacity;
+    uint64_t total_num_joints;
+
+} hubo_cmd_slot_table_t;
+
+typedef struct hubo_cmd_slot {
+
+    uint32_t sequence;
+    int32_t owner; // pid of the writer, or 0 if the slot is free
+    uint64_t size;
+    uint32_t consumed; // The last sequence which the reader picked up
+    uint32_t reserved;
+
+} hubo_cmd_slot_t;
+
+#define HUBO_CMD_OWNERS_CHANNEL "hubo_cmd_owners"
+
+typedef struct hubo_joint_owner {
+
+    int32_t pid;            // 0 if nobody owns the joint
+    uint8_t priority;
+    int32_t preempted_pid;  // The owner which the joint gets handed back to, or 0
+    uint8_t preempted_priority;
+    uint32_t conflicts;     // Number of commands rejected for this joint
+
+}__attribute__((packed)) hubo_joint_owner_t;
+
+/*
+ * The ownership table is a hubo_cmd_owners_header_t followed by total_num_joints entries of
+ * hubo_joint_owner_t
+ */
+typedef struct hubo_cmd_owners_header {
+
+    double time;
+    uint16_t total_num_joints;
+
+}__attribute__((packed)) hubo_cmd_owners_header_t;
+
+double hubo_cmd_time_now(void);
+
+void hubo_cmd_data_stamp(hubo_cmd_data* data, double send_time,
+                         double horizon, hubo_cmd_expiry_t expiry);
+
+double hubo_cmd_data_get_send_time(const hubo_cmd_data* data);
+
+int hubo_joint_cmd_is_expired(const hubo_joint_cmd_t* cmd, double now);
+
+void hubo_joint_cmd_apply_expiry(hubo_joint_cmd_t* cmd);
+
+float hubo_joint_cmd_interpolate(const hubo_joint_cmd_t* cmd, double time);
+
 size_t hubo_cmd_data_predict_max_message_size(size_t num_joints);
 
 size_t hubo_cmd_data_get_min_data_size(const hubo_cmd_data* data);
 
-size_t hubo_cmd_data_location(size_t joint_index);
+size_t hubo_cmd_data_location(const hubo_cmd_data* data, size_t joint_index);
+
+size_t hubo_cmd_data_bitmap_words(size_t num_joints);
+
+const hubo_cmd_bitmap_t* hubo_cmd_data_get_bitmap(const hubo_cmd_data* data);
+
+size_t hubo_cmd_data_count_set_joints(const hubo_cmd_data* data);
+
+size_t hubo_cmd_data_compressed_index(const hubo_cmd_data* data, size_t joint_index);
 
 int hubo_cmd_data_is_compressed(const hubo_cmd_data* data);
 
@@ -111,6 +293,15 @@ hubo_cmd_data* hubo_cmd_init_data(size_t num_total_joints);
 
 size_t hubo_cmd_data_compressor(hubo_cmd_data* compressed, const hubo_cmd_data* uncompressed);
 
+/*
+ * Compress only the joints which are set in both the bitmap of uncompressed and in selection,
+ * which must contain hubo_cmd_data_bitmap_words(total_num_joints) words. A NULL selection
+ * includes every set joint.
+ */
+size_t hubo_cmd_data_compress_selection(hubo_cmd_data* compressed,
+                                        const hubo_cmd_data* uncompressed,
+                                        const hubo_cmd_bitmap_t* selection);
+
 hubo_data_error_t hubo_cmd_data_set_joint_cmd(hubo_cmd_data* data, const hubo_joint_cmd_t* cmd, size_t joint_index);
 
 hubo_data_error_t hubo_cmd_data_get_joint_cmd(hubo_joint_cmd_t* output, const hubo_cmd_data* data, size_t joint_index);
@@ -119,6 +310,12 @@ hubo_joint_cmd_t* hubo_cmd_data_access_joint_cmd(hubo_cmd_data* data, size_t joi
 
 hubo_data_error_t hubo_cmd_data_register_joint(hubo_cmd_data* data, size_t joint_index);
 
+/*
+ * Register every joint whose bit is set in masks, which must contain
+ * hubo_cmd_data_bitmap_words(total_num_joints) words
+ */
+hubo_data_error_t hubo_cmd_data_register_joints(hubo_cmd_data* data, const hubo_cmd_bitmap_t* masks);
+
 hubo_data_error_t hubo_cmd_data_unregister_released_joints(hubo_cmd_data* data);
 
 size_t hubo_cmd_data_get_size(const hubo_cmd_data* data);
@@ -49,6 +49,12 @@ std::ostream& operator<<(std::ostream& stream, const hubo_cmd_mode_t& mode);
 const char* hubo_data_error_to_string(hubo_data_error_t error);
 std::ostream& operator<<(std::ostream& stream, const hubo_data_error_t& error);
 
+const char* hubo_cmd_expiry_to_string(hubo_cmd_expiry_t expiry);
+std::ostream& operator<<(std::ostream& stream, const hubo_cmd_expiry_t& expiry);
+
+const char* hubo_cmd_safety_policy_to_string(hubo_cmd_safety_policy_t policy);
+std::ostream& operator<<(std::ostream& stream, const hubo_cmd_safety_policy_t& policy);
+
 std::ostream& operator<<(std::ostream& stream, const hubo_joint_cmd_t& cmd);
 
 #endif // HUBOCMD_HUBO_CMD_STREAM_HPP
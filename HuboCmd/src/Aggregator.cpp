@@ -38,8 +38,11 @@
 #include <errno.h>
 #include <iostream>
 #include <unistd.h>
+#include <signal.h>
+#include <limits>
 
 #include "HuboCmd/Aggregator.hpp"
+#include "HuboState/State.hpp"
 
 using namespace HuboCan;
 
@@ -54,8 +57,12 @@ Aggregator::Aggregator(HuboDescription& description)
 
 Aggregator::~Aggregator()
 {
+    stop_thread();
+
     free(_input_data);
     free(_output_data);
+    for(size_t i=0; i<3; ++i)
+        free(_handoff_data[i]);
     free(_final_data);
 
     close_channels();
@@ -69,8 +76,27 @@ void Aggregator::_initialize()
     _final_data = NULL;
 
     _channels_opened = false;
+    _stats_opened = false;
+    _owners_opened = false;
+    _owners_changed = true;
     _is_launched = false;
 
+    memset(&_stats, 0, sizeof(_stats));
+    _receive_time = 0;
+    _last_stats_publish = 0;
+
+    _safety_policy = HUBO_CMD_SAFETY_CLAMP;
+    _state = NULL;
+    _safety_report_time = 0;
+
+    _threaded = false;
+    _thread_active = 0;
+    for(size_t i=0; i<3; ++i)
+        _handoff_data[i] = NULL;
+    _handoff = 0;
+    _handoff_write = 1;
+    _handoff_read = 2;
+
     open_channels();
 }
 
@@ -108,6 +134,25 @@ bool Aggregator::open_channels()
     report_ach_errors(ach_flush(&_agg_chan), "Aggregator::open_channels",
                       "ach_flush", HUBO_AGG_CHANNEL);
 
+    // The statistics are a diagnostic, so aggregation can proceed without them
+    result = ach_open(&_stats_chan, HUBO_CMD_STATS_CHANNEL, NULL);
+    _stats_opened = (ACH_OK == result);
+    if(!_stats_opened)
+    {
+        fprintf(stderr, "Could not open the command statistics channel: %s (%d)\n"
+                        " -- Command latencies will not be published\n",
+                ach_result_to_string(result), (int)result);
+    }
+
+    result = ach_open(&_owners_chan, HUBO_CMD_OWNERS_CHANNEL, NULL);
+    _owners_opened = (ACH_OK == result);
+    if(!_owners_opened)
+    {
+        fprintf(stderr, "Could not open the joint ownership channel: %s (%d)\n"
+                        " -- Joint ownership will not be published\n",
+                ach_result_to_string(result), (int)result);
+    }
+
     return true;
 }
 
@@ -118,6 +163,20 @@ void Aggregator::close_channels()
 
     report_ach_errors(ach_close(&_agg_chan), "Aggregator::close_channels",
                       "ach_close", HUBO_AGG_CHANNEL);
+
+    if(_stats_opened)
+    {
+        report_ach_errors(ach_close(&_stats_chan), "Aggregator::close_channels",
+                          "ach_close", HUBO_CMD_STATS_CHANNEL);
+        _stats_opened = false;
+    }
+
+    if(_owners_opened)
+    {
+        report_ach_errors(ach_close(&_owners_chan), "Aggregator::close_channels",
+                          "ach_close", HUBO_CMD_OWNERS_CHANNEL);
+        _owners_opened = false;
+    }
 }
 
 void Aggregator::_create_memory()
@@ -126,23 +185,50 @@ void Aggregator::_create_memory()
     free(_input_data);
     free(_output_data);
     free(_final_data);
+    for(size_t i=0; i<3; ++i)
+    {
+        free(_handoff_data[i]);
+        _handoff_data[i] = NULL;
+    }
 
     if(_desc.getJointCount() > 0)
     {
         _input_data  = hubo_cmd_init_data( _desc.getJointCount() );
         _output_data = hubo_cmd_init_data( _desc.getJointCount() );
         _final_data  = hubo_cmd_init_data( _desc.getJointCount() );
+        for(size_t i=0; i<3; ++i)
+            _handoff_data[i] = hubo_cmd_init_data( _desc.getJointCount() );
+        _received_cmds.resize(_desc.getJointCount());
         _aggregated_cmds.resize(_desc.getJointCount());
-        _pids.resize(_desc.getJointCount(), 0);
+        hubo_joint_owner_t unowned;
+        memset(&unowned, 0, sizeof(unowned));
+        _owners.assign(_desc.getJointCount(), unowned);
+        _conflict_report_time.assign(_desc.getJointCount(), 0);
+        _conflicts_reported.assign(_desc.getJointCount(), 0);
+        _owners_message.resize(sizeof(hubo_cmd_owners_header_t)
+                               + _desc.getJointCount()*sizeof(hubo_joint_owner_t));
+        _owners_changed = true;
+        _load_limits();
         _memory_set = true;
+
+        if(!_slots.create(_desc.getJointCount()))
+        {
+            std::cout << "Could not create the shared memory command slots, so commanders "
+                      << "will only be heard on the ach channel" << std::endl;
+        }
     }
     else
     {
         _input_data  = NULL;
         _output_data = NULL;
         _final_data  = NULL;
+        _received_cmds.resize(0);
         _aggregated_cmds.resize(0);
-        _pids.resize(0);
+        _owners.clear();
+        _conflict_report_time.clear();
+        _conflicts_reported.clear();
+        _owners_message.clear();
+        _load_limits();
         _memory_set = false;
     }
 }
@@ -186,6 +272,92 @@ bool Aggregator::run()
     return false;
 }
 
+bool Aggregator::run_thread(int priority)
+{
+    if(!_memory_set)
+    {
+        std::cerr << "Trying to launch the aggregator before a valid Description has been loaded!" << std::endl;
+        return false;
+    }
+
+    if(_threaded)
+    {
+        std::cerr << "The aggregator thread is already running!" << std::endl;
+        return true;
+    }
+
+    if(!open_channels())
+    {
+        std::cout << "Could not open the ach channels for aggregation!" << std::endl;
+        return false;
+    }
+
+    _handoff = 0;
+    _handoff_write = 1;
+    _handoff_read = 2;
+
+    // The thread reads these as soon as it starts, so they must be set before it exists
+    _threaded = true;
+    _is_launched = true;
+    __atomic_store_n(&_thread_active, 1, __ATOMIC_RELEASE);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    pthread_attr_setschedparam(&attr, &param);
+
+    int result = pthread_create(&_thread, &attr, &Aggregator::_aggregator_thread, this);
+    pthread_attr_destroy(&attr);
+
+    if(EPERM == result)
+    {
+        std::cout << "Did not have permissions to give the aggregator thread real-time "
+                  << "priority. It will run with the default scheduler instead." << std::endl;
+        result = pthread_create(&_thread, NULL, &Aggregator::_aggregator_thread, this);
+    }
+
+    if(result != 0)
+    {
+        std::cerr << "Unable to create the aggregator thread, code=" << result << " ("
+                  << strerror(result) << ")" << std::endl;
+        __atomic_store_n(&_thread_active, 0, __ATOMIC_RELEASE);
+        _threaded = false;
+        _is_launched = false;
+        return false;
+    }
+
+    return true;
+}
+
+void Aggregator::stop_thread()
+{
+    if(!_threaded)
+        return;
+
+    __atomic_store_n(&_thread_active, 0, __ATOMIC_RELEASE);
+    pthread_join(_thread, NULL);
+    _threaded = false;
+    _is_launched = false;
+}
+
+void* Aggregator::_aggregator_thread(void* aggregator)
+{
+    static_cast<Aggregator*>(aggregator)->_aggregator_loop();
+    return NULL;
+}
+
+bool Aggregator::_keep_running()
+{
+    if(_threaded)
+        return __atomic_load_n(&_thread_active, __ATOMIC_ACQUIRE) == 1;
+
+    return _rt.good();
+}
+
 void Aggregator::_init_aggregator()
 {
     if(!_rt.begin("hubo_cmd_aggregator"))
@@ -214,57 +386,269 @@ void Aggregator::_init_aggregator()
 
 void Aggregator::_aggregator_loop()
 {
-    size_t max_expected_size = hubo_cmd_data_get_size(_input_data);
-    while(_rt.good())
+    // Collate once per pump cycle: wake up when the pump publishes a new state, drain every
+    // command that has arrived since the last cycle, and publish one consistent output.
+    HuboState::StateListener listener(false);
+    if(!listener.connect())
+    {
+        std::cout << "Aggregator could not find the pump's cycle notifier, so it will pace "
+                  << "itself at the nominal frequency instead" << std::endl;
+    }
+
+    double period = _desc.params.frequency > 0 ? 1.0/_desc.params.frequency : 0.005;
+    size_t reconnect_cycles = (size_t)(1.0/period);
+    size_t cycles_since_attempt = 0;
+    struct timespec next_cycle;
+    clock_gettime(CLOCK_MONOTONIC, &next_cycle);
+
+    while(_keep_running())
+    {
+        if(listener.connected())
+        {
+            HuboCan::error_result_t result = listener.wait(1);
+            if(result != HuboCan::OKAY)
+                continue;
+        }
+        else
+        {
+            long nano_wait = next_cycle.tv_nsec + (long)(period*1E9);
+            next_cycle.tv_sec += (long)(nano_wait/1E9);
+            next_cycle.tv_nsec = (long)(nano_wait%((long)1E9));
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_cycle, NULL);
+
+            if(++cycles_since_attempt >= reconnect_cycles)
+            {
+                cycles_since_attempt = 0;
+                listener.connect(false);
+            }
+        }
+
+        size_t drained = _drain_input();
+
+        double now = hubo_cmd_time_now();
+        bool expired = _expire_commands(now);
+        _publish_stats(now);
+
+        if(drained == 0 && !expired)
+            continue;
+
+        _send_output();
+    }
+}
+
+size_t Aggregator::_drain_input()
+{
+    size_t max_expected_size = hubo_cmd_data_predict_max_message_size(_desc.getJointCount());
+    size_t collated = 0;
+    while(true)
     {
         size_t fs;
-        double quit_check = 1;
-        struct timespec wait_time;
-        clock_gettime( ACH_DEFAULT_CLOCK, &wait_time);
-        long nano_wait = wait_time.tv_nsec + (long)(quit_check*1E9);
-        wait_time.tv_sec += (long)(nano_wait/1E9);
-        wait_time.tv_nsec = (long)(nano_wait%((long)1E9));
         ach_status_t result = ach_get(&_cmd_chan, _input_data, max_expected_size,
-                                 &fs, &wait_time, ACH_O_WAIT);
+                                      &fs, NULL, 0);
 
-        if(ACH_TIMEOUT == result)
+        if(ACH_STALE_FRAMES == result || ACH_TIMEOUT == result)
         {
-            continue;
+            break;
         }
 
-        if( ACH_OK != result )
+        if( ACH_OK != result && ACH_MISSED_FRAME != result )
         {
             std::cout << "Ach error: (" << (int)result << ")" << ach_result_to_string(result) << std::endl;
             // TODO: Broadcast the fact that we had an ach error?
-            continue;
+            break;
         }
 
-        if(hubo_cmd_header_check(_input_data) != HUBO_DATA_OKAY)
-        {
-            std::cout << "Malformed command header!" << std::endl;
-            // TODO: Broadcast the fact that the header was malformed?
+        if(!_check_input(fs))
             continue;
-        }
 
-        if( hubo_cmd_data_get_size(_input_data) != fs )
-        {
-            std::cout << "Data size error! Expected size:" << hubo_cmd_data_get_size(_input_data)
-                         << ", Frame size:" << fs <<", Max size:" << max_expected_size << std::endl;
-            // TODO: Broadcast the fact that we had a sizing error?
+        _receive_time = hubo_cmd_time_now();
+        _record_message(_input_data);
+        _collate_input();
+        ++collated;
+    }
+
+    // Each slot holds only the latest message of its commander, so one pass is enough
+    for(size_t i=0; i < _slots.slot_count(); ++i)
+    {
+        size_t fs;
+        if(!_slots.read(i, _input_data, max_expected_size, fs))
             continue;
-        }
 
-        _check_hubocan_state();
+        if(!_check_input(fs))
+            continue;
 
+        _receive_time = hubo_cmd_time_now();
+        _record_message(_input_data);
         _collate_input();
+        ++collated;
+    }
 
-        _send_output();
+    return collated;
+}
+
+bool Aggregator::_check_input(size_t frame_size)
+{
+    if(hubo_cmd_header_check(_input_data) != HUBO_DATA_OKAY)
+    {
+        std::cout << "Malformed command header!" << std::endl;
+        // TODO: Broadcast the fact that the header was malformed?
+        return false;
+    }
+
+    if( hubo_cmd_data_get_size(_input_data) != frame_size )
+    {
+        std::cout << "Data size error! Expected size:" << hubo_cmd_data_get_size(_input_data)
+                     << ", Frame size:" << frame_size << std::endl;
+        // TODO: Broadcast the fact that we had a sizing error?
+        return false;
+    }
+
+    return true;
+}
+
+void Aggregator::set_safety_policy(hubo_cmd_safety_policy_t policy)
+{
+    _safety_policy = policy;
+}
+
+void Aggregator::set_state(const HuboState::State* state)
+{
+    _state = state;
+}
+
+void Aggregator::_load_limits()
+{
+    size_t joint_count = _desc.getJointCount();
+    double dt = _desc.params.frequency > 0 ? 1.0/_desc.params.frequency : 0.005;
+    double inf = std::numeric_limits<double>::infinity();
+
+    _min_position.resize(joint_count);
+    _max_position.resize(joint_count);
+    _max_step.resize(joint_count);
+    _max_step_change.resize(joint_count);
+    for(size_t i=0; i<joint_count; ++i)
+    {
+        const hubo_joint_limits_t& limits = _desc.joints[i]->info.limits;
+
+        bool bounded = limits.min_position < limits.max_position;
+        _min_position[i] = bounded ? limits.min_position : -inf;
+        _max_position[i] = bounded ? limits.max_position : inf;
+        _max_step[i] = limits.max_speed > 0 ? limits.max_speed*dt : inf;
+        _max_step_change[i] = limits.max_accel > 0 ? limits.max_accel*dt*dt : inf;
     }
+
+    _reference.setZero(joint_count);
+    _previous_reference.setZero(joint_count);
+    _previous_step.setZero(joint_count);
+    _active.setZero(joint_count);
+    _resting.setZero(joint_count);
+
+    hubo_cmd_safety_counts_t zero;
+    memset(&zero, 0, sizeof(zero));
+    _safety_counts.assign(joint_count, zero);
+    _safety_reported.assign(joint_count, zero);
 }
 
 void Aggregator::_check_hubocan_state()
 {
-    // TODO: Grab the current state and do a sanity check
+    if(HUBO_CMD_SAFETY_OFF == _safety_policy || _aggregated_cmds.empty())
+        return;
+
+    size_t joint_count = _aggregated_cmds.size();
+    bool measured = (NULL != _state && _state->joints.size() == joint_count);
+    for(size_t i=0; i<joint_count; ++i)
+    {
+        const hubo_joint_cmd_t& cmd = _aggregated_cmds[i];
+        _reference[i] = cmd.position;
+        _active[i] = (HUBO_CMD_RIGID == cmd.mode || HUBO_CMD_HYBRID == cmd.mode) ? 1 : 0;
+        _resting[i] = measured ? _state->joints[i].position : cmd.position;
+    }
+
+    // Joints which are not being driven by position get ramped in from wherever they rest,
+    // so a joint that starts being commanded cannot jump to its first reference
+    _previous_reference = (_active > 0).select(_previous_reference, _resting);
+    _previous_step = (_active > 0).select(_previous_step, 0);
+
+    const Eigen::ArrayXd target = _reference.max(_min_position).min(_max_position);
+    const Eigen::ArrayXd desired_step = target - _previous_reference;
+
+    // The fastest step from which the reference can still come to a stop at the target: a step
+    // of v followed by v-a, v-2a, ... covers about v^2/(2a) + v/2 before it stops
+    const double inf = std::numeric_limits<double>::infinity();
+    const Eigen::ArrayXd braking = _max_step_change.isFinite().select(
+                (0.25*_max_step_change.square()
+                 + 2*_max_step_change*desired_step.abs()).sqrt() - 0.5*_max_step_change, inf);
+
+    // When the reference is already too fast to stop in time, slowing down as hard as the
+    // acceleration limit allows takes priority over the braking distance
+    const Eigen::ArrayXd upper = _max_step.min(_previous_step + _max_step_change)
+            .min((desired_step >= 0).select(braking, inf))
+            .max(_previous_step - _max_step_change);
+    const Eigen::ArrayXd lower = (-_max_step).max(_previous_step - _max_step_change)
+            .max((desired_step < 0).select(-braking, -inf))
+            .min(_previous_step + _max_step_change);
+    const Eigen::ArrayXd step = desired_step.max(lower).min(upper);
+
+    // A reference that is carried too fast toward a position limit cannot always stop in
+    // time, so the position limits have the final word
+    Eigen::ArrayXd safe = (_previous_reference + step).max(_min_position).min(_max_position);
+
+    const Eigen::ArrayXd position_violation = (target != _reference).cast<double>() * _active;
+    const Eigen::ArrayXd velocity_violation = (desired_step.abs() > _max_step).cast<double>() * _active;
+    const Eigen::ArrayXd acceleration_violation =
+            ((desired_step - _previous_step).abs() > _max_step_change).cast<double>() * _active;
+
+    if(HUBO_CMD_SAFETY_REJECT == _safety_policy)
+    {
+        safe = (position_violation + velocity_violation + acceleration_violation > 0)
+                .select(_previous_reference, _reference);
+    }
+
+    safe = (_active > 0).select(safe, _reference);
+    _previous_step = safe - _previous_reference;
+    _previous_reference = safe;
+
+    for(size_t i=0; i<joint_count; ++i)
+    {
+        if(_active[i] == 0)
+            continue;
+
+        hubo_cmd_safety_counts_t& counts = _safety_counts[i];
+        counts.position += (uint32_t)position_violation[i];
+        counts.velocity += (uint32_t)velocity_violation[i];
+        counts.acceleration += (uint32_t)acceleration_violation[i];
+        if(HUBO_CMD_SAFETY_REJECT == _safety_policy && safe[i] != _reference[i])
+            ++counts.rejected;
+
+        _aggregated_cmds[i].position = safe[i];
+    }
+}
+
+void Aggregator::_report_safety(double now)
+{
+    // Like ownership conflicts, a violation tends to repeat every cycle, so only say
+    // something once a second
+    if(now - _safety_report_time < 1.0)
+        return;
+
+    _safety_report_time = now;
+    for(size_t i=0; i < _safety_counts.size(); ++i)
+    {
+        const hubo_cmd_safety_counts_t& counts = _safety_counts[i];
+        hubo_cmd_safety_counts_t& reported = _safety_reported[i];
+        if(memcmp(&counts, &reported, sizeof(counts)) == 0)
+            continue;
+
+        std::cerr << "Joint '" << _desc.getJointName(i) << "' (" << i << ") violated its limits "
+                  << "in the last second: " << counts.position - reported.position << " position, "
+                  << counts.velocity - reported.velocity << " velocity, "
+                  << counts.acceleration - reported.acceleration << " acceleration";
+        if(HUBO_CMD_SAFETY_REJECT == _safety_policy)
+            std::cerr << " (" << counts.rejected - reported.rejected << " rejected)";
+        std::cerr << std::endl;
+
+        reported = counts;
+    }
 }
 
 void Aggregator::_collate_input()
@@ -284,6 +668,15 @@ void Aggregator::_collate_input()
 
 void Aggregator::_send_output()
 {
+    if(_threaded)
+    {
+        memcpy(_handoff_data[_handoff_write], _output_data,
+               hubo_cmd_data_get_size(_output_data));
+        _handoff_write = __atomic_exchange_n(&_handoff, _handoff_write | _handoff_fresh,
+                                             __ATOMIC_ACQ_REL) & ~_handoff_fresh;
+        return;
+    }
+
     ach_put(&_agg_chan, _output_data, hubo_cmd_data_get_size(_output_data));
 }
 
@@ -298,47 +691,136 @@ void Aggregator::_quit_aggregator()
 
 bool Aggregator::_resolve_ownership(size_t joint_index)
 {
-    if(joint_index >= _pids.size())
+    if(joint_index >= _owners.size())
     {
         std::cerr << "Attempting to collate a joint index which is out of bounds. THIS SHOULD BE IMPOSSIBLE. REPORT BUG IMMEDIATELY." << std::endl;
         return false;
     }
 
     hubo_cmd_header_t* header = (hubo_cmd_header_t*)_input_data;
+    hubo_joint_owner_t& owner = _owners[joint_index];
+
+    hubo_cmd_data_get_joint_cmd(&_container, _input_data, joint_index);
 
-    if(_pids[joint_index] == 0) // Joint is unclaimed, so we're good to go
+    if(owner.pid == 0) // Joint is unclaimed, so we're good to go
     {
-        _pids[joint_index] = header->pid;
+        if(HUBO_CMD_RELEASE != _container.mode)
+        {
+            owner.pid = header->pid;
+            owner.priority = header->priority;
+            _owners_changed = true;
+        }
         return true;
     }
 
-    hubo_cmd_data_get_joint_cmd(&_container, _input_data, joint_index);
-
-    if(_pids[joint_index] == header->pid) // Incoming PID matches the current owner
+    if(owner.pid == header->pid) // Incoming PID matches the current owner
     {
+        if(owner.priority != header->priority)
+        {
+            owner.priority = header->priority;
+            _owners_changed = true;
+        }
+
         if(HUBO_CMD_RELEASE == _container.mode)
         {
-            _pids[joint_index] = 0;
-            return true;
+            _release_joint(joint_index);
         }
 
         return true;
     }
-    else if(HUBO_CMD_CLAIM == _container.mode)
+
+    if(owner.preempted_pid == header->pid && HUBO_CMD_RELEASE == _container.mode)
+    {
+        // The preempted owner no longer wants the joint back
+        owner.preempted_pid = 0;
+        owner.preempted_priority = 0;
+        _owners_changed = true;
+        return false;
+    }
+
+    if(header->priority > owner.priority)
+    {
+        std::cout << "PID# " << header->pid << " (priority " << (int)header->priority
+                  << ") has preempted PID# " << owner.pid << " (priority " << (int)owner.priority
+                  << ") on joint '" << _desc.getJointName(joint_index) << "' ("
+                  << joint_index << ")." << std::endl;
+        owner.preempted_pid = owner.pid;
+        owner.preempted_priority = owner.priority;
+        owner.pid = header->pid;
+        owner.priority = header->priority;
+        _owners_changed = true;
+        return true;
+    }
+    else if(HUBO_CMD_CLAIM == _container.mode && header->priority == owner.priority)
     {
         std::cout << "PID# " << header->pid << " has demanded ownership of joint '"
                   << _desc.getJointName(joint_index) << "' (" << joint_index << ")." << std::endl;
-        _pids[joint_index] = header->pid;
+        owner.pid = header->pid;
+        _owners_changed = true;
         return true;
     }
 
-    std::cerr << "PID# " << header->pid << " is trying to command joint '"
-                 << _desc.getJointName(joint_index) << "' (" << joint_index << ") which is already "
-                    << "owned by PID# " << _pids[joint_index] << "! Please resolve this conflict!" << std::endl;
+    _report_conflict(joint_index, header->pid, header->priority);
 
     return false;
 }
 
+void Aggregator::_release_joint(size_t joint_index)
+{
+    hubo_joint_owner_t& owner = _owners[joint_index];
+
+    owner.pid = owner.preempted_pid;
+    owner.priority = owner.preempted_priority;
+    owner.preempted_pid = 0;
+    owner.preempted_priority = 0;
+    _owners_changed = true;
+
+    if(owner.pid == 0)
+        return;
+
+    if(kill(owner.pid, 0) != 0 && ESRCH == errno)
+    {
+        owner.pid = 0;
+        owner.priority = 0;
+        return;
+    }
+
+    std::cout << "Joint '" << _desc.getJointName(joint_index) << "' (" << joint_index
+              << ") has been handed back to PID# " << owner.pid << "." << std::endl;
+}
+
+void Aggregator::_report_conflict(size_t joint_index, pid_t pid, uint8_t priority)
+{
+    hubo_joint_owner_t& owner = _owners[joint_index];
+    ++owner.conflicts;
+
+    // A preempted owner is expected to keep commanding while it waits to get the joint back
+    if(pid == owner.preempted_pid)
+        return;
+
+    // Conflicting clients tend to collide every cycle, so only say something once a second
+    if(_receive_time - _conflict_report_time[joint_index] < 1.0)
+        return;
+
+    uint32_t rejected = owner.conflicts - _conflicts_reported[joint_index];
+    _conflict_report_time[joint_index] = _receive_time;
+    _conflicts_reported[joint_index] = owner.conflicts;
+
+    if(kill(owner.pid, 0) != 0 && ESRCH == errno)
+    {
+        std::cout << "PID# " << owner.pid << " died while owning joint '"
+                  << _desc.getJointName(joint_index) << "' (" << joint_index
+                  << "), so it is being released." << std::endl;
+        _release_joint(joint_index);
+        return;
+    }
+
+    std::cerr << "PID# " << pid << " (priority " << (int)priority << ") had " << rejected
+              << " command(s) rejected for joint '" << _desc.getJointName(joint_index) << "' ("
+              << joint_index << "), which is owned by PID# " << owner.pid << " (priority "
+              << (int)owner.priority << ")! Please resolve this conflict!" << std::endl;
+}
+
 void Aggregator::_accept_command(size_t joint_index)
 {
     hubo_cmd_data_get_joint_cmd(&_container, _input_data, joint_index);
@@ -347,10 +829,141 @@ void Aggregator::_accept_command(size_t joint_index)
     {
         _container.mode = HUBO_CMD_IGNORE;
     }
+    else if(hubo_joint_cmd_is_expired(&_container, _receive_time))
+    {
+        // The command outlived its own deadline before we got to it, so forwarding it would
+        // only make a stalled commander look fresh
+        hubo_cmd_owner_stats_t* stats = _owner_stats(_owners[joint_index].pid, false);
+        if(stats)
+            ++stats->late;
+        return;
+    }
 
     hubo_cmd_data_set_joint_cmd(_output_data, &_container, joint_index);
 }
 
+bool Aggregator::_expire_commands(double now)
+{
+    bool changed = false;
+    size_t joint_count = hubo_cmd_data_get_total_num_joints(_output_data);
+    for(size_t i=0; i<joint_count; ++i)
+    {
+        if(hubo_cmd_data_check_if_joint_is_set(_output_data, i) != 1)
+            continue;
+
+        hubo_joint_cmd_t* cmd = hubo_cmd_data_access_joint_cmd(_output_data, i);
+        if(!hubo_joint_cmd_is_expired(cmd, now))
+            continue;
+
+        hubo_cmd_owner_stats_t* stats = _owner_stats(_owners[i].pid, false);
+        if(stats)
+            ++stats->expired;
+
+        if(HUBO_CMD_EXPIRE_RELEASE == cmd->expiry)
+            _release_joint(i);
+
+        hubo_joint_cmd_apply_expiry(cmd);
+        changed = true;
+    }
+
+    return changed;
+}
+
+void Aggregator::_evaluate_received_cmds(double now)
+{
+    for(size_t i=0; i < _received_cmds.size(); ++i)
+    {
+        hubo_joint_cmd_t& received = _received_cmds[i];
+
+        // This is a second line of defense in case the aggregator itself has stalled
+        if(hubo_joint_cmd_is_expired(&received, now))
+            hubo_joint_cmd_apply_expiry(&received);
+
+        _aggregated_cmds[i] = received;
+        if(received.setpoint_count > 0)
+            _aggregated_cmds[i].position = hubo_joint_cmd_interpolate(&received, now);
+    }
+}
+
+hubo_cmd_owner_stats_t* Aggregator::_owner_stats(pid_t pid, bool create)
+{
+    if(pid == 0)
+        return NULL;
+
+    size_t oldest = 0;
+    for(size_t i=0; i < _stats.owner_count; ++i)
+    {
+        if(_stats.owners[i].pid == pid)
+            return &_stats.owners[i];
+
+        if(_stats.owners[i].last_time < _stats.owners[oldest].last_time)
+            oldest = i;
+    }
+
+    if(!create)
+        return NULL;
+
+    // Make room by forgetting whichever owner has been quiet for the longest
+    size_t index = _stats.owner_count < HUBO_CMD_MAX_STATS_OWNERS ?
+                _stats.owner_count++ : oldest;
+
+    hubo_cmd_owner_stats_t& stats = _stats.owners[index];
+    memset(&stats, 0, sizeof(stats));
+    stats.pid = pid;
+    return &stats;
+}
+
+void Aggregator::_record_message(const hubo_cmd_data* data)
+{
+    hubo_cmd_owner_stats_t* stats = _owner_stats(((const hubo_cmd_header_t*)data)->pid, true);
+    ++stats->messages;
+    stats->last_time = _receive_time;
+
+    double send_time = hubo_cmd_data_get_send_time(data);
+    if(send_time <= 0)
+        return;
+
+    double latency = _receive_time - send_time;
+    stats->last_latency = latency;
+    stats->mean_latency += (latency - stats->mean_latency)/stats->messages;
+    if(latency > stats->max_latency)
+        stats->max_latency = latency;
+}
+
+void Aggregator::_publish_stats(double now)
+{
+    // Tools should hear about ownership changes right away, but otherwise 10Hz is plenty
+    if(now - _last_stats_publish < 0.1)
+    {
+        if(_owners_changed)
+            _publish_owners();
+        return;
+    }
+
+    _last_stats_publish = now;
+    _stats.time = now;
+    if(_stats_opened)
+        ach_put(&_stats_chan, &_stats, sizeof(_stats));
+
+    _publish_owners();
+}
+
+void Aggregator::_publish_owners()
+{
+    if(!_owners_opened || _owners.empty())
+        return;
+
+    hubo_cmd_owners_header_t header;
+    header.time = hubo_cmd_time_now();
+    header.total_num_joints = _owners.size();
+    memcpy(&_owners_message[0], &header, sizeof(header));
+    memcpy(&_owners_message[sizeof(header)], &_owners[0],
+           _owners.size()*sizeof(hubo_joint_owner_t));
+
+    ach_put(&_owners_chan, &_owners_message[0], _owners_message.size());
+    _owners_changed = false;
+}
+
 
 const JointCmdArray& Aggregator::update()
 {
@@ -360,35 +973,59 @@ const JointCmdArray& Aggregator::update()
         return _aggregated_cmds;
     }
 
+    if(_threaded)
+    {
+        if(__atomic_load_n(&_handoff, __ATOMIC_ACQUIRE) & _handoff_fresh)
+        {
+            _handoff_read = __atomic_exchange_n(&_handoff, _handoff_read,
+                                                __ATOMIC_ACQ_REL) & ~_handoff_fresh;
+            _copy_data_to_array(_handoff_data[_handoff_read]);
+        }
+        double now = hubo_cmd_time_now();
+        _evaluate_received_cmds(now);
+        _check_hubocan_state();
+        _report_safety(now);
+        return _aggregated_cmds;
+    }
+
     size_t fs;
     ach_status_t result = ach_get(&_agg_chan, _final_data, hubo_cmd_data_get_size(_final_data), &fs, NULL, ACH_O_LAST);
     if( ACH_OK != result && ACH_STALE_FRAMES != result && ACH_MISSED_FRAME != result )
-    { // TODO: Is ACH_STALE_FRAMES really okay? It might imply that the upstream pipeline has been frozen
+    { // ACH_STALE_FRAMES may mean the aggregator is frozen, which the command deadlines catch
         std::cout << "Unexpected Ach result: " << ach_result_to_string(result) << " (" << (int)result << ")" << std::endl;
-        return _aggregated_cmds;
+    }
+    else
+    {
+        _copy_data_to_array(_final_data);
     }
 
-    _copy_final_data_to_array();
+    double now = hubo_cmd_time_now();
+    _evaluate_received_cmds(now);
+    _check_hubocan_state();
+    _report_safety(now);
 
     return _aggregated_cmds;
 }
 
-void Aggregator::_copy_final_data_to_array()
+void Aggregator::_copy_data_to_array(const hubo_cmd_data* data)
 {
-    if(_aggregated_cmds.size() != hubo_cmd_data_get_total_num_joints(_final_data))
+    if(_received_cmds.size() != hubo_cmd_data_get_total_num_joints(data))
     {
-        std::cout << "Mismatch between final data size (" << hubo_cmd_data_get_total_num_joints(_final_data)
-                  << ") and the command array size (" << _aggregated_cmds.size()
+        std::cout << "Mismatch between final data size (" << hubo_cmd_data_get_total_num_joints(data)
+                  << ") and the command array size (" << _received_cmds.size()
                   << ")!\n"
                   << " -- You must have a defunct aggregator for a different version of Hubo running!"
                   << std::endl;
         return;
     }
 
-    for(size_t i=0; i < _aggregated_cmds.size(); ++i)
+    // In threaded mode this runs on the pump thread, while _container belongs to the
+    // aggregator thread, so use a container of our own
+    hubo_joint_cmd_t container;
+    for(size_t i=0; i < _received_cmds.size(); ++i)
     {
-        hubo_cmd_data_get_joint_cmd(&_container, _final_data, i);
-        _aggregated_cmds[i] = _container;
+        hubo_cmd_data_get_joint_cmd(&container, data, i);
+        _received_cmds[i] = container;
     }
 }
 
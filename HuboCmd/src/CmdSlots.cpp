@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <string.h>
+
+#include <iostream>
+
+#include "HuboCmd/CmdSlots.hpp"
+
+namespace HuboCmd {
+
+static size_t round_to_alignment(size_t size)
+{
+    return ( (size + HUBO_CMD_SLOT_ALIGNMENT - 1)/HUBO_CMD_SLOT_ALIGNMENT )
+            * HUBO_CMD_SLOT_ALIGNMENT;
+}
+
+CmdSlots::CmdSlots(const std::string& shm_name) :
+    _name(shm_name),
+    _table(NULL),
+    _mapped_size(0),
+    _owner(false)
+{
+    memset(_last_sequence, 0, sizeof(_last_sequence));
+}
+
+CmdSlots::~CmdSlots()
+{
+    if(_owner && _table)
+    {
+        __atomic_store_n(&_table->closed, 1, __ATOMIC_RELEASE);
+        shm_unlink(_name.c_str());
+    }
+
+    detach();
+}
+
+bool CmdSlots::create(size_t total_num_joints)
+{
+    detach();
+
+    // Tell anyone who is still attached to an old table that it has been abandoned
+    if(attach(0, false))
+    {
+        __atomic_store_n(&_table->closed, 1, __ATOMIC_RELEASE);
+        detach();
+    }
+    shm_unlink(_name.c_str());
+
+    size_t data_capacity = hubo_cmd_data_predict_max_message_size(total_num_joints);
+    size_t slot_size = round_to_alignment(sizeof(hubo_cmd_slot_t) + data_capacity);
+    size_t size = round_to_alignment(sizeof(hubo_cmd_slot_table_t))
+                    + HUBO_CMD_MAX_SLOTS*slot_size;
+
+    int fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+    if(fd < 0)
+    {
+        std::cerr << "Unable to create the command slots '" << _name << "': "
+                  << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Let commanders owned by other users attach regardless of our umask
+    fchmod(fd, 0666);
+
+    if(ftruncate(fd, size) != 0)
+    {
+        std::cerr << "Unable to size the command slots '" << _name << "': "
+                  << strerror(errno) << std::endl;
+        close(fd);
+        shm_unlink(_name.c_str());
+        return false;
+    }
+
+    if(!_map(fd, size, true))
+    {
+        shm_unlink(_name.c_str());
+        return false;
+    }
+
+    memset(_table, 0, size);
+    _table->slot_count = HUBO_CMD_MAX_SLOTS;
+    _table->slot_size = slot_size;
+    _table->data_capacity = data_capacity;
+    _table->total_num_joints = total_num_joints;
+    memset(_last_sequence, 0, sizeof(_last_sequence));
+    _owner = true;
+
+    // The code goes in last, so nobody attaches to a half-initialized table
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    strcpy(_table->code, HUBO_CMD_SLOTS_CODE);
+
+    return true;
+}
+
+bool CmdSlots::attach(size_t total_num_joints, bool verbose)
+{
+    detach();
+
+    int fd = shm_open(_name.c_str(), O_RDWR, 0);
+    if(fd < 0)
+    {
+        if(verbose)
+            std::cerr << "Could not open the command slots '" << _name << "': "
+                      << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(hubo_cmd_slot_table_t))
+    {
+        if(verbose)
+            std::cerr << "The command slots '" << _name << "' have not been set up yet" << std::endl;
+        close(fd);
+        return false;
+    }
+
+    if(!_map(fd, info.st_size, verbose))
+        return false;
+
+    if(strncmp(_table->code, HUBO_CMD_SLOTS_CODE, HUBO_CMD_HEADER_CODE_SIZE) != 0)
+    {
+        if(verbose)
+            std::cerr << "The command slots '" << _name << "' have a malformed header!" << std::endl;
+        detach();
+        return false;
+    }
+
+    if(total_num_joints > 0 && _table->total_num_joints != total_num_joints)
+    {
+        if(verbose)
+            std::cerr << "The command slots '" << _name << "' were made for "
+                      << _table->total_num_joints << " joints, but we have "
+                      << total_num_joints << "!" << std::endl;
+        detach();
+        return false;
+    }
+
+    return true;
+}
+
+bool CmdSlots::_map(int fd, size_t size, bool verbose)
+{
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(MAP_FAILED == memory)
+    {
+        if(verbose)
+            std::cerr << "Unable to map the command slots '" << _name << "': "
+                      << strerror(errno) << std::endl;
+        return false;
+    }
+
+    _table = (hubo_cmd_slot_table_t*)memory;
+    _mapped_size = size;
+    return true;
+}
+
+void CmdSlots::detach()
+{
+    if(NULL == _table)
+        return;
+
+    munmap(_table, _mapped_size);
+    _table = NULL;
+    _mapped_size = 0;
+    _owner = false;
+}
+
+bool CmdSlots::closed() const
+{
+    if(NULL == _table)
+        return true;
+
+    return __atomic_load_n(&_table->closed, __ATOMIC_ACQUIRE) != 0;
+}
+
+hubo_cmd_slot_t* CmdSlots::_slot(size_t index) const
+{
+    return (hubo_cmd_slot_t*)( (char*)_table
+                               + round_to_alignment(sizeof(hubo_cmd_slot_table_t))
+                               + index*_table->slot_size );
+}
+
+int CmdSlots::claim()
+{
+    if(NULL == _table)
+        return -1;
+
+    int32_t pid = getpid();
+    for(size_t i=0; i < slot_count(); ++i)
+    {
+        int32_t expected = 0;
+        if(__atomic_compare_exchange_n(&_slot(i)->owner, &expected, pid, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            return i;
+    }
+
+    // Every slot is taken, so look for slots whose owners have died
+    for(size_t i=0; i < slot_count(); ++i)
+    {
+        int32_t owner = __atomic_load_n(&_slot(i)->owner, __ATOMIC_ACQUIRE);
+        if(owner == pid || kill(owner, 0) == 0 || errno != ESRCH)
+            continue;
+
+        if(__atomic_compare_exchange_n(&_slot(i)->owner, &owner, pid, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            return i;
+    }
+
+    return -1;
+}
+
+void CmdSlots::release(int slot)
+{
+    if(NULL == _table || slot < 0 || (size_t)slot >= slot_count())
+        return;
+
+    int32_t pid = getpid();
+    __atomic_compare_exchange_n(&_slot(slot)->owner, &pid, 0, false,
+                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+bool CmdSlots::write(int slot, const hubo_cmd_data* data, size_t size)
+{
+    if(NULL == _table || slot < 0 || (size_t)slot >= slot_count()
+            || size > _table->data_capacity)
+        return false;
+
+    hubo_cmd_slot_t* s = _slot(slot);
+    uint32_t sequence = __atomic_load_n(&s->sequence, __ATOMIC_RELAXED);
+
+    // An odd sequence means the last owner of this slot died in the middle of a copy. Readers
+    // skip odd sequences, so get back onto even ones or the slot would never be read again.
+    if(sequence & 0x01)
+        ++sequence;
+
+    __atomic_store_n(&s->sequence, sequence+1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    s->size = size;
+    memcpy((char*)s + sizeof(hubo_cmd_slot_t), data, size);
+
+    __atomic_store_n(&s->sequence, sequence+2, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool CmdSlots::consumed(int slot) const
+{
+    if(NULL == _table || slot < 0 || (size_t)slot >= slot_count())
+        return true;
+
+    const hubo_cmd_slot_t* s = _slot(slot);
+    return __atomic_load_n(&s->consumed, __ATOMIC_ACQUIRE)
+            == __atomic_load_n(&s->sequence, __ATOMIC_ACQUIRE);
+}
+
+bool CmdSlots::read(size_t slot, hubo_cmd_data* output, size_t max_size, size_t& size)
+{
+    if(NULL == _table || slot >= slot_count())
+        return false;
+
+    hubo_cmd_slot_t* s = _slot(slot);
+    for(size_t attempt=0; attempt < 3; ++attempt)
+    {
+        uint32_t before = __atomic_load_n(&s->sequence, __ATOMIC_ACQUIRE);
+        if(before == _last_sequence[slot])
+            return false;
+
+        if(before & 0x01) // The writer is in the middle of a copy
+            continue;
+
+        size = s->size;
+        if(size > max_size || size > _table->data_capacity)
+            return false;
+
+        memcpy(output, (char*)s + sizeof(hubo_cmd_slot_t), size);
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&s->sequence, __ATOMIC_RELAXED) == before)
+        {
+            _last_sequence[slot] = before;
+            __atomic_store_n(&s->consumed, before, __ATOMIC_RELEASE);
+            return true;
+        }
+    }
+
+    // We'll catch the next message on the next cycle
+    return false;
+}
+
+CmdSlots::CmdSlots(const CmdSlots&) { }
+
+CmdSlots& CmdSlots::operator=(const CmdSlots&) { return *this; }
+
+} // namespace HuboCmd
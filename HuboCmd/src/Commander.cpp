@@ -35,8 +35,11 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <iostream>
+#include <algorithm>
 
 #include "HuboCmd/Commander.hpp"
 
@@ -63,6 +66,16 @@ void Commander::_initialize()
     cmd_data = NULL;
     _compressed_data = NULL;
 
+    _validity_horizon = 0;
+    _expiry_policy = HUBO_CMD_EXPIRE_HOLD;
+    _priority = HUBO_CMD_DEFAULT_PRIORITY;
+    _keepalive = 0.25;
+
+    _slot = -1;
+    _slot_retry = 0;
+    _cmd_generation = 0;
+
+    _owners_opened = false;
     _channels_opened = false;
     open_channels();
 
@@ -86,17 +99,35 @@ bool Commander::open_channels()
     report_ach_errors(ach_flush(&_cmd_chan), "Commander::open_channels",
                       "ach_flush", HUBO_CMD_CHANNEL);
 
+    // Optional: without the ownership table, every joint is assumed to be ours
+    _owners_opened = (ACH_OK == ach_open(&_owners_chan, HUBO_CMD_OWNERS_CHANNEL, NULL));
+
     return _channels_opened;
 }
 
 void Commander::_create_memory()
 {
+    ++_cmd_generation;
     free(cmd_data);
     free(_compressed_data);
     if(_desc.getJointCount() > 0)
     {
         cmd_data = hubo_cmd_init_data( _desc.getJointCount() );
         _compressed_data = hubo_cmd_init_data( _desc.getJointCount() );
+        _slots.release(_slot);
+        _slots.detach();
+        _slot = -1;
+        _slot_retry = 0;
+
+        hubo_joint_cmd_t blank;
+        memset(&blank, 0, sizeof(blank));
+        _last_sent.assign(_desc.getJointCount(), blank);
+        _last_sent_time.assign(_desc.getJointCount(), -1);
+        _owned.assign(_desc.getJointCount(), 1);
+        _owners_buffer.resize(sizeof(hubo_cmd_owners_header_t)
+                              + _desc.getJointCount()*sizeof(hubo_joint_owner_t));
+        _send_mask.assign(hubo_cmd_data_bitmap_words(_desc.getJointCount()), 0);
+        _unconsumed_mask.assign(_send_mask.size(), 0);
     }
     else
     {
@@ -114,6 +145,9 @@ void Commander::_create_memory()
     }
 }
 
+// How long a closing Commander waits for the aggregator to pick up its final release
+static const double release_drain_time = 0.1;
+
 Commander::~Commander()
 {
     update(0);
@@ -121,8 +155,34 @@ Commander::~Commander()
     release_joints();
     send_commands();
 
+    if(_slot >= 0)
+    {
+        // Once the slot is given up, another process may claim it and overwrite the release
+        // before the aggregator ever reads it
+        double give_up = hubo_cmd_time_now() + release_drain_time;
+        while(!_slots.consumed(_slot) && hubo_cmd_time_now() < give_up)
+        {
+            struct timespec nap;
+            nap.tv_sec = 0;
+            nap.tv_nsec = 1000000L;
+            nanosleep(&nap, NULL);
+        }
+
+        if(!_slots.consumed(_slot))
+        {
+            // The aggregator is not draining the slots, so make sure the release gets through
+            ach_put(&_cmd_chan, _compressed_data,
+                    hubo_cmd_data_get_min_data_size(_compressed_data));
+        }
+    }
+
+    _slots.release(_slot);
+
     report_ach_errors(ach_close(&_cmd_chan), "Commander::~Commander",
                       "ach_close", HUBO_CMD_CHANNEL);
+    if(_owners_opened)
+        report_ach_errors(ach_close(&_owners_chan), "Commander::~Commander",
+                          "ach_close", HUBO_CMD_OWNERS_CHANNEL);
     free(cmd_data);
     free(_compressed_data);
 }
@@ -264,10 +324,57 @@ HuboCan::error_result_t Commander::set_position(size_t joint_index, float value)
         return HuboCan::INDEX_OUT_OF_BOUNDS;
     }
     cptr->position = value;
+    cptr->setpoint_count = 0;
+
+    return _register_joint(joint_index);
+}
+
+HuboCan::error_result_t Commander::set_setpoints(size_t joint_index, const ValueArray& times,
+                                                 const ValueArray& positions)
+{
+    if(times.size() != positions.size() || times.size() == 0)
+        return HuboCan::ARRAY_MISMATCH;
+
+    if(times.size() > HUBO_CMD_MAX_SETPOINTS)
+    {
+        std::cerr << "Attempting to send " << times.size() << " setpoints to joint #" << joint_index
+                  << ", but the maximum is " << HUBO_CMD_MAX_SETPOINTS << "!" << std::endl;
+        return HuboCan::ARRAY_MISMATCH;
+    }
+
+    for(size_t i=1; i < times.size(); ++i)
+    {
+        if(times[i] <= times[i-1])
+        {
+            std::cerr << "The setpoint times for joint #" << joint_index
+                      << " must be strictly increasing!" << std::endl;
+            return HuboCan::ARRAY_MISMATCH;
+        }
+    }
+
+    hubo_joint_cmd_t* cptr = hubo_cmd_data_access_joint_cmd(cmd_data, joint_index);
+    if(NULL == cptr)
+    {
+        return HuboCan::INDEX_OUT_OF_BOUNDS;
+    }
+
+    for(size_t i=0; i < times.size(); ++i)
+    {
+        cptr->setpoints[i].time = times[i];
+        cptr->setpoints[i].position = positions[i];
+    }
+    cptr->setpoint_count = times.size();
+    cptr->position = positions[0];
 
     return _register_joint(joint_index);
 }
 
+size_t Commander::get_setpoint_count(size_t joint_index)
+{
+    _fill_container(joint_index);
+    return _container.setpoint_count;
+}
+
 HuboCan::error_result_t Commander::set_positions(const IndexArray& joints,
                                                  const ValueArray& values)
 {
@@ -437,6 +544,206 @@ IndexArray Commander::get_indices(const StringArray& joint_names)
     return _desc.getJointIndices(joint_names);
 }
 
+JointGroup::JointGroup() :
+    _generation(0)
+{
+
+}
+
+JointGroup Commander::create_group(const IndexArray& joints)
+{
+    JointGroup group;
+    if(NULL == cmd_data)
+    {
+        std::cerr << "Attempting to create a joint group before a valid HuboDescription has been loaded!" << std::endl;
+        return group;
+    }
+
+    group._masks.resize(hubo_cmd_data_bitmap_words(get_joint_count()), 0);
+    for(size_t i=0; i < joints.size(); ++i)
+    {
+        if(joints[i] >= get_joint_count())
+        {
+            std::cerr << "Attempting to create a joint group with an out-of-bounds joint index ("
+                      << joints[i] << ")! The maximum is " << get_joint_count()-1 << std::endl;
+            return JointGroup();
+        }
+
+        group._offsets.push_back(hubo_cmd_data_location(cmd_data, joints[i]));
+        group._masks[joints[i]/HUBO_CMD_BITMAP_WORD_BITS]
+                |= (hubo_cmd_bitmap_t)1 << (joints[i]%HUBO_CMD_BITMAP_WORD_BITS);
+    }
+
+    group._indices = joints;
+    group._generation = _cmd_generation;
+    return group;
+}
+
+JointGroup Commander::create_group(const StringArray& joint_names)
+{
+    return create_group(get_indices(joint_names));
+}
+
+bool Commander::is_valid(const JointGroup& group) const
+{
+    return NULL != cmd_data && group._generation == _cmd_generation;
+}
+
+namespace {
+
+struct PositionField
+{
+    static inline void set(hubo_joint_cmd_t& cmd, double value)
+    {
+        cmd.position = value;
+        cmd.setpoint_count = 0;
+    }
+    static inline double get(const hubo_joint_cmd_t& cmd) { return cmd.position; }
+};
+
+struct BaseTorqueField
+{
+    static inline void set(hubo_joint_cmd_t& cmd, double value) { cmd.base_torque = value; }
+    static inline double get(const hubo_joint_cmd_t& cmd) { return cmd.base_torque; }
+};
+
+struct KpGainField
+{
+    static inline void set(hubo_joint_cmd_t& cmd, double value) { cmd.kP_gain = value; }
+    static inline double get(const hubo_joint_cmd_t& cmd) { return cmd.kP_gain; }
+};
+
+struct KdGainField
+{
+    static inline void set(hubo_joint_cmd_t& cmd, double value) { cmd.kD_gain = value; }
+    static inline double get(const hubo_joint_cmd_t& cmd) { return cmd.kD_gain; }
+};
+
+} // anonymous namespace
+
+template<class Field>
+HuboCan::error_result_t Commander::_set_group_values(const JointGroup& group,
+                                                     const double* values, size_t count)
+{
+    if(!is_valid(group))
+    {
+        std::cerr << "Attempting to use a joint group which was not created by this Commander, "
+                  << "or which was created for a different HuboDescription!" << std::endl;
+        return HuboCan::UNINITIALIZED;
+    }
+
+    if(count != group._offsets.size())
+        return HuboCan::ARRAY_MISMATCH;
+
+    for(size_t i=0; i < count; ++i)
+    {
+        Field::set(*(hubo_joint_cmd_t*)(cmd_data + group._offsets[i]), values[i]);
+    }
+
+    if(hubo_cmd_data_register_joints(cmd_data, &group._masks[0]) != HUBO_DATA_OKAY)
+        return HuboCan::READ_ONLY;
+
+    return HuboCan::OKAY;
+}
+
+template<class Field>
+HuboCan::error_result_t Commander::_get_group_values(const JointGroup& group,
+                                                     Eigen::VectorXd& values)
+{
+    if(!is_valid(group))
+    {
+        std::cerr << "Attempting to use a joint group which was not created by this Commander, "
+                  << "or which was created for a different HuboDescription!" << std::endl;
+        return HuboCan::UNINITIALIZED;
+    }
+
+    if((size_t)values.size() != group._offsets.size())
+        values.resize(group._offsets.size());
+
+    for(size_t i=0; i < group._offsets.size(); ++i)
+    {
+        values[i] = Field::get(*(const hubo_joint_cmd_t*)(cmd_data + group._offsets[i]));
+    }
+
+    return HuboCan::OKAY;
+}
+
+HuboCan::error_result_t Commander::set_modes(const JointGroup& group, hubo_cmd_mode_t mode)
+{
+    if(!is_valid(group))
+        return HuboCan::UNINITIALIZED;
+
+    for(size_t i=0; i < group._offsets.size(); ++i)
+    {
+        ((hubo_joint_cmd_t*)(cmd_data + group._offsets[i]))->mode = mode;
+    }
+
+    if(hubo_cmd_data_register_joints(cmd_data, &group._masks[0]) != HUBO_DATA_OKAY)
+        return HuboCan::READ_ONLY;
+
+    return HuboCan::OKAY;
+}
+
+HuboCan::error_result_t Commander::set_positions(const JointGroup& group, const Eigen::VectorXd& values)
+{
+    return _set_group_values<PositionField>(group, values.data(), values.size());
+}
+
+HuboCan::error_result_t Commander::set_positions(const JointGroup& group, const double* values, size_t count)
+{
+    return _set_group_values<PositionField>(group, values, count);
+}
+
+HuboCan::error_result_t Commander::get_position_cmds(const JointGroup& group, Eigen::VectorXd& values)
+{
+    return _get_group_values<PositionField>(group, values);
+}
+
+HuboCan::error_result_t Commander::set_base_torques(const JointGroup& group, const Eigen::VectorXd& values)
+{
+    return _set_group_values<BaseTorqueField>(group, values.data(), values.size());
+}
+
+HuboCan::error_result_t Commander::set_base_torques(const JointGroup& group, const double* values, size_t count)
+{
+    return _set_group_values<BaseTorqueField>(group, values, count);
+}
+
+HuboCan::error_result_t Commander::get_base_torque_cmds(const JointGroup& group, Eigen::VectorXd& values)
+{
+    return _get_group_values<BaseTorqueField>(group, values);
+}
+
+HuboCan::error_result_t Commander::set_kp_gains(const JointGroup& group, const Eigen::VectorXd& values)
+{
+    return _set_group_values<KpGainField>(group, values.data(), values.size());
+}
+
+HuboCan::error_result_t Commander::set_kp_gains(const JointGroup& group, const double* values, size_t count)
+{
+    return _set_group_values<KpGainField>(group, values, count);
+}
+
+HuboCan::error_result_t Commander::get_kp_gain_cmds(const JointGroup& group, Eigen::VectorXd& values)
+{
+    return _get_group_values<KpGainField>(group, values);
+}
+
+HuboCan::error_result_t Commander::set_kd_gains(const JointGroup& group, const Eigen::VectorXd& values)
+{
+    return _set_group_values<KdGainField>(group, values.data(), values.size());
+}
+
+HuboCan::error_result_t Commander::set_kd_gains(const JointGroup& group, const double* values, size_t count)
+{
+    return _set_group_values<KdGainField>(group, values, count);
+}
+
+HuboCan::error_result_t Commander::get_kd_gain_cmds(const JointGroup& group, Eigen::VectorXd& values)
+{
+    return _get_group_values<KdGainField>(group, values);
+}
+
 HuboCan::error_result_t Commander::update(double timeout_sec, bool report_sync)
 {
     _has_been_updated = true;
@@ -452,9 +759,25 @@ HuboCan::error_result_t Commander::send_commands()
         // TODO: Decide if I should terminate here or allow the command to proceed anyway
     }
 
-    hubo_cmd_data_compressor(_compressed_data, cmd_data);
+    double now = hubo_cmd_time_now();
+    ((hubo_cmd_header_t*)cmd_data)->priority = _priority;
+    hubo_cmd_data_stamp(cmd_data, now, _validity_horizon, _expiry_policy);
+
+    if(_select_joints_to_send(now) > 0)
+    {
+        hubo_cmd_data_compress_selection(_compressed_data, cmd_data, &_send_mask[0]);
 
-    ach_put(&_cmd_chan, _compressed_data, hubo_cmd_data_get_min_data_size(_compressed_data));
+        size_t size = hubo_cmd_data_get_min_data_size(_compressed_data);
+        if(_send_to_slot(size))
+        {
+            _unconsumed_mask = _send_mask;
+        }
+        else
+        {
+            ach_put(&_cmd_chan, _compressed_data, size);
+            std::fill(_unconsumed_mask.begin(), _unconsumed_mask.end(), 0);
+        }
+    }
 
     hubo_cmd_data_unregister_released_joints(cmd_data);
 
@@ -463,6 +786,152 @@ HuboCan::error_result_t Commander::send_commands()
     return HuboCan::OKAY;
 }
 
+static bool same_command(const hubo_joint_cmd_t& a, const hubo_joint_cmd_t& b)
+{
+    // The deadline gets restamped on every send, so it does not count as a change
+    if(a.mode != b.mode || a.position != b.position || a.base_torque != b.base_torque
+            || a.kP_gain != b.kP_gain || a.kD_gain != b.kD_gain || a.expiry != b.expiry
+            || a.setpoint_count != b.setpoint_count)
+        return false;
+
+    for(size_t i=0; i < a.setpoint_count && i < HUBO_CMD_MAX_SETPOINTS; ++i)
+    {
+        if(a.setpoints[i].time != b.setpoints[i].time
+                || a.setpoints[i].position != b.setpoints[i].position)
+            return false;
+    }
+
+    return true;
+}
+
+void Commander::_update_ownership()
+{
+    if(!_owners_opened || _owned.empty())
+        return;
+
+    size_t fs = 0;
+    ach_status_t result = ach_get(&_owners_chan, &_owners_buffer[0], _owners_buffer.size(),
+                                  &fs, NULL, ACH_O_LAST);
+    if( (ACH_OK != result && ACH_MISSED_FRAME != result) || fs != _owners_buffer.size() )
+        return;
+
+    const hubo_cmd_owners_header_t* header = (const hubo_cmd_owners_header_t*)&_owners_buffer[0];
+    if(header->total_num_joints != _owned.size())
+        return;
+
+    int32_t pid = getpid();
+    for(size_t i=0; i < _owned.size(); ++i)
+    {
+        hubo_joint_owner_t owner;
+        memcpy(&owner, &_owners_buffer[sizeof(hubo_cmd_owners_header_t)
+                                       + i*sizeof(hubo_joint_owner_t)], sizeof(owner));
+        uint8_t owned = owner.pid == pid ? 1 : 0;
+
+        // A joint that was just handed back holds the preemptor's last reference, so ours has
+        // to go out again right away, even if it has not changed
+        if(owned && !_owned[i])
+            _last_sent_time[i] = -1;
+
+        _owned[i] = owned;
+    }
+}
+
+size_t Commander::_select_joints_to_send(double now)
+{
+    double keepalive = _keepalive;
+    if(keepalive > 0 && _validity_horizon > 0 && keepalive > _validity_horizon/2)
+        keepalive = _validity_horizon/2;
+
+    // A slot only holds one message, so anything the aggregator did not get to has to go again
+    bool resend_unconsumed = _slot >= 0 && !_slots.consumed(_slot);
+
+    if(keepalive > 0)
+        _update_ownership();
+
+    const hubo_cmd_bitmap_t* bitmap = hubo_cmd_data_get_bitmap(cmd_data);
+    size_t count = 0;
+    for(size_t w=0; w < _send_mask.size(); ++w)
+    {
+        hubo_cmd_bitmap_t selected = 0;
+        if(keepalive <= 0)
+        {
+            selected = bitmap[w];
+        }
+        else
+        {
+            hubo_cmd_bitmap_t word = bitmap[w];
+            while(word)
+            {
+                size_t bit = __builtin_ctzll(word);
+                size_t i = w*HUBO_CMD_BITMAP_WORD_BITS + bit;
+                const hubo_joint_cmd_t& cmd = *(const hubo_joint_cmd_t*)(
+                            cmd_data + hubo_cmd_data_location(cmd_data, i));
+
+                // Joints which are not ours (yet, or anymore) always get sent, so that the
+                // aggregator has our latest command the moment it hands them to us
+                if(_last_sent_time[i] < 0 || !_owned[i] || now - _last_sent_time[i] >= keepalive
+                        || !same_command(cmd, _last_sent[i]))
+                    selected |= (hubo_cmd_bitmap_t)1 << bit;
+
+                word &= word - 1;
+            }
+        }
+
+        if(resend_unconsumed)
+            selected |= _unconsumed_mask[w] & bitmap[w];
+
+        _send_mask[w] = selected;
+        count += __builtin_popcountll(selected);
+
+        while(selected)
+        {
+            size_t i = w*HUBO_CMD_BITMAP_WORD_BITS + __builtin_ctzll(selected);
+            _last_sent[i] = *(const hubo_joint_cmd_t*)(cmd_data + hubo_cmd_data_location(cmd_data, i));
+            _last_sent_time[i] = now;
+            selected &= selected - 1;
+        }
+    }
+
+    return count;
+}
+
+bool Commander::_send_to_slot(size_t size)
+{
+    if(_slot >= 0 && _slots.closed())
+    {
+        // The aggregator has been restarted, so find our way into its new table
+        _slots.detach();
+        _slot = -1;
+        _slot_retry = 0;
+    }
+
+    if(_slot < 0)
+    {
+        // Fall back on the ach channel for a while before trying the slots again
+        if(_slot_retry > 0)
+        {
+            --_slot_retry;
+            return false;
+        }
+
+        _slot_retry = 100;
+        if(!_slots.attached() && !_slots.attach(_desc.getJointCount(), false))
+            return false;
+
+        _slot = _slots.claim();
+        if(_slot < 0)
+            return false;
+    }
+
+    return _slots.write(_slot, _compressed_data, size);
+}
+
+void Commander::set_validity(double horizon, hubo_cmd_expiry_t expiry)
+{
+    _validity_horizon = horizon > 0 ? horizon : 0;
+    _expiry_policy = expiry;
+}
+
 Commander::Commander(const Commander &doNotCopy) :
     HuboState::State(doNotCopy)
 {
@@ -37,17 +37,74 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "HuboCmd/hubo_cmd_c.h"
 
+static size_t hubo_cmd_data_header_size(size_t num_total_joints)
+{
+    return sizeof(hubo_cmd_header_t)
+            + hubo_cmd_data_bitmap_words(num_total_joints)*sizeof(hubo_cmd_bitmap_t);
+}
+
+static size_t hubo_cmd_data_message_size(size_t num_total_joints, size_t num_included_joints)
+{
+    return hubo_cmd_data_header_size(num_total_joints)
+            + num_included_joints*sizeof(hubo_joint_cmd_t);
+}
+
+static hubo_cmd_bitmap_t* hubo_cmd_data_access_bitmap(hubo_cmd_data* data)
+{
+    return (hubo_cmd_bitmap_t*)(data+sizeof(hubo_cmd_header_t));
+}
+
+size_t hubo_cmd_data_bitmap_words(size_t num_joints)
+{
+    return (num_joints + HUBO_CMD_BITMAP_WORD_BITS - 1)/HUBO_CMD_BITMAP_WORD_BITS;
+}
+
+const hubo_cmd_bitmap_t* hubo_cmd_data_get_bitmap(const hubo_cmd_data* data)
+{
+    return (const hubo_cmd_bitmap_t*)(data+sizeof(hubo_cmd_header_t));
+}
+
 size_t hubo_cmd_data_predict_max_message_size(size_t num_joints)
 {
-    return sizeof(hubo_cmd_header_t)+num_joints*sizeof(hubo_joint_cmd_t);
+    return hubo_cmd_data_message_size(num_joints, num_joints);
 }
 
-size_t hubo_cmd_data_location(size_t joint_index)
+size_t hubo_cmd_data_location(const hubo_cmd_data* data, size_t joint_index)
 {
-    return hubo_cmd_data_predict_max_message_size(joint_index);
+    return hubo_cmd_data_message_size(hubo_cmd_data_get_total_num_joints(data), joint_index);
+}
+
+size_t hubo_cmd_data_count_set_joints(const hubo_cmd_data* data)
+{
+    const hubo_cmd_bitmap_t* bitmap = hubo_cmd_data_get_bitmap(data);
+    size_t words = hubo_cmd_data_bitmap_words(hubo_cmd_data_get_total_num_joints(data));
+    size_t count = 0;
+    size_t w=0;
+    for(w=0; w<words; ++w)
+        count += __builtin_popcountll(bitmap[w]);
+
+    return count;
+}
+
+size_t hubo_cmd_data_compressed_index(const hubo_cmd_data* data, size_t joint_index)
+{
+    // Count the set bits of every joint which comes before joint_index
+    const hubo_cmd_bitmap_t* bitmap = hubo_cmd_data_get_bitmap(data);
+    size_t word = joint_index/HUBO_CMD_BITMAP_WORD_BITS;
+    size_t bit = joint_index%HUBO_CMD_BITMAP_WORD_BITS;
+    size_t index = 0;
+    size_t w=0;
+    for(w=0; w<word; ++w)
+        index += __builtin_popcountll(bitmap[w]);
+
+    if(bit > 0)
+        index += __builtin_popcountll(bitmap[word] & (((hubo_cmd_bitmap_t)1 << bit) - 1));
+
+    return index;
 }
 
 int hubo_cmd_data_is_compressed(const hubo_cmd_data* data)
@@ -94,11 +151,12 @@ hubo_cmd_data* hubo_cmd_init_data(size_t num_total_joints)
     unallocated_cmd = (hubo_cmd_data*)malloc(cmd_size);
 
     hubo_cmd_header_t header;
+    memset(&header, 0, sizeof(hubo_cmd_header_t));
     strcpy(header.code, HUBO_CMD_HEADER_CODE);
     header.pid = getpid();
     header.is_compressed = 0;
-    header.bitmap = 0;
     header.total_num_joints = num_total_joints;
+    header.priority = HUBO_CMD_DEFAULT_PRIORITY;
 
     memcpy(unallocated_cmd, &header, sizeof(hubo_cmd_header_t));
     memset(unallocated_cmd+sizeof(hubo_cmd_header_t), 0, cmd_size-sizeof(hubo_cmd_header_t));
@@ -111,30 +169,22 @@ inline size_t hubo_cmd_data_get_min_data_size(const hubo_cmd_data *data)
     if(hubo_cmd_header_check(data) != HUBO_DATA_OKAY)
         return 0;
 
-    size_t joint_count = 0;
+    size_t num_total_joints = hubo_cmd_data_get_total_num_joints(data);
     if( hubo_cmd_data_is_compressed(data) == 1 )
-    {
-        const hubo_cmd_header_t* header = (hubo_cmd_header_t*)data;
-        size_t num_total_joints = header->total_num_joints;
-        size_t i=0;
-        for(i=0; i<num_total_joints; ++i)
-        {
-            if( (header->bitmap >> i) & 0x01 )
-            {
-                ++joint_count;
-            }
-        }
-    }
-    else
-    {
-        joint_count = hubo_cmd_data_get_total_num_joints(data);
-    }
+        return hubo_cmd_data_message_size(num_total_joints, hubo_cmd_data_count_set_joints(data));
 
-    return hubo_cmd_data_predict_max_message_size(joint_count);
+    return hubo_cmd_data_predict_max_message_size(num_total_joints);
 }
 
 size_t hubo_cmd_data_compressor(hubo_cmd_data *compressed,
                                 const hubo_cmd_data *uncompressed)
+{
+    return hubo_cmd_data_compress_selection(compressed, uncompressed, NULL);
+}
+
+size_t hubo_cmd_data_compress_selection(hubo_cmd_data *compressed,
+                                        const hubo_cmd_data *uncompressed,
+                                        const hubo_cmd_bitmap_t *selection)
 {
     if(hubo_cmd_header_check(uncompressed) != 0)
         return 0;
@@ -161,31 +211,46 @@ size_t hubo_cmd_data_compressor(hubo_cmd_data *compressed,
         return hubo_cmd_data_get_size(compressed);
     }
 
-    hubo_cmd_header_t header;
-    memcpy(&header, uncompressed, sizeof(hubo_cmd_header_t));
-    header.is_compressed = 1;
+    size_t num_total_joints = hubo_cmd_data_get_total_num_joints(uncompressed);
+    size_t header_size = hubo_cmd_data_header_size(num_total_joints);
+    memcpy(compressed, uncompressed, header_size);
+    ((hubo_cmd_header_t*)compressed)->is_compressed = 1;
 
-    memcpy(compressed, &header, sizeof(hubo_cmd_header_t));
+    const hubo_cmd_bitmap_t* bitmap = hubo_cmd_data_get_bitmap(uncompressed);
+    hubo_cmd_bitmap_t* compressed_bitmap = hubo_cmd_data_access_bitmap(compressed);
+    const hubo_cmd_data* source = uncompressed + header_size;
+    hubo_cmd_data* destination = compressed + header_size;
 
-    size_t comp_memory_count = sizeof(hubo_cmd_header_t);
-    size_t uncomp_memory_count = sizeof(hubo_cmd_header_t);
-
-    size_t num_total_joints = header.total_num_joints;
+    size_t words = hubo_cmd_data_bitmap_words(num_total_joints);
     size_t joint_count=0;
-    size_t i=0;
-
-    for(i=0; i<num_total_joints; ++i)
+    size_t w=0;
+    for(w=0; w<words; ++w)
     {
-        if( (header.bitmap >> i) & 0x01 )
+        hubo_cmd_bitmap_t word = bitmap[w];
+        if(selection)
         {
-            memcpy(compressed+comp_memory_count, uncompressed+uncomp_memory_count,
-                   sizeof(hubo_joint_cmd_t));
-
-            ++joint_count;
-            comp_memory_count += sizeof(hubo_joint_cmd_t);
+            word &= selection[w];
+            compressed_bitmap[w] = word;
         }
 
-        uncomp_memory_count += sizeof(hubo_joint_cmd_t);
+        while(word)
+        {
+            // Gather each contiguous run of set joints with a single copy
+            size_t start = __builtin_ctzll(word);
+            hubo_cmd_bitmap_t remaining = ~(word >> start);
+            size_t run = remaining ? (size_t)__builtin_ctzll(remaining)
+                                   : HUBO_CMD_BITMAP_WORD_BITS - start;
+
+            memcpy(destination + joint_count*sizeof(hubo_joint_cmd_t),
+                   source + (w*HUBO_CMD_BITMAP_WORD_BITS + start)*sizeof(hubo_joint_cmd_t),
+                   run*sizeof(hubo_joint_cmd_t));
+
+            joint_count += run;
+            if(start + run >= HUBO_CMD_BITMAP_WORD_BITS)
+                word = 0;
+            else
+                word &= ~(( ((hubo_cmd_bitmap_t)1 << run) - 1 ) << start);
+        }
     }
 
     return joint_count;
@@ -214,10 +279,10 @@ hubo_data_error_t hubo_cmd_data_set_joint_cmd(hubo_cmd_data *data, const hubo_jo
         return HUBO_DATA_READ_ONLY;
     }
 
-    hubo_cmd_header_t* header = (hubo_cmd_header_t*)data;
-    header->bitmap |= (0x01 << joint_index);
+    hubo_cmd_data_access_bitmap(data)[joint_index/HUBO_CMD_BITMAP_WORD_BITS]
+            |= (hubo_cmd_bitmap_t)1 << (joint_index%HUBO_CMD_BITMAP_WORD_BITS);
 
-    memcpy(data+hubo_cmd_data_location(joint_index), cmd, sizeof(hubo_joint_cmd_t));
+    memcpy(data+hubo_cmd_data_location(data, joint_index), cmd, sizeof(hubo_joint_cmd_t));
 
     return HUBO_DATA_OKAY;
 }
@@ -245,8 +310,31 @@ hubo_data_error_t hubo_cmd_data_register_joint(hubo_cmd_data *data, size_t joint
         return HUBO_DATA_READ_ONLY;
     }
 
-    hubo_cmd_header_t* header = (hubo_cmd_header_t*)data;
-    header->bitmap |= (0x01 << joint_index);
+    hubo_cmd_data_access_bitmap(data)[joint_index/HUBO_CMD_BITMAP_WORD_BITS]
+            |= (hubo_cmd_bitmap_t)1 << (joint_index%HUBO_CMD_BITMAP_WORD_BITS);
+
+    return HUBO_DATA_OKAY;
+}
+
+hubo_data_error_t hubo_cmd_data_register_joints(hubo_cmd_data *data, const hubo_cmd_bitmap_t *masks)
+{
+    hubo_data_error_t check = hubo_cmd_header_check(data);
+    if( check != HUBO_DATA_OKAY )
+    {
+        return check;
+    }
+
+    if(hubo_cmd_data_is_compressed(data) == 1)
+    {
+        fprintf(stderr, "Attempting to register joint values in a hubo_cmd_data which is compressed. Compressed data is read-only!!\n");
+        return HUBO_DATA_READ_ONLY;
+    }
+
+    hubo_cmd_bitmap_t* bitmap = hubo_cmd_data_access_bitmap(data);
+    size_t words = hubo_cmd_data_bitmap_words(hubo_cmd_data_get_total_num_joints(data));
+    size_t w=0;
+    for(w=0; w<words; ++w)
+        bitmap[w] |= masks[w];
 
     return HUBO_DATA_OKAY;
 }
@@ -260,17 +348,16 @@ hubo_data_error_t hubo_cmd_data_unregister_released_joints(hubo_cmd_data *data)
     }
 
     size_t num_total_joints = hubo_cmd_data_get_total_num_joints(data);
+    hubo_cmd_bitmap_t* bitmap = hubo_cmd_data_access_bitmap(data);
     size_t i=0;
-    hubo_cmd_header_t* header = (hubo_cmd_header_t*)data;
     for(i=0; i<num_total_joints; ++i)
     {
         hubo_joint_cmd_t* cmd = hubo_cmd_data_access_joint_cmd(data, i);
         if(HUBO_CMD_RELEASE == cmd->mode)
         {
             cmd->mode = HUBO_CMD_IGNORE;
-            uint64_t inverse_bitmap = ~(header->bitmap);
-            inverse_bitmap |= (0x01 << i);
-            header->bitmap = ~(inverse_bitmap);
+            bitmap[i/HUBO_CMD_BITMAP_WORD_BITS]
+                    &= ~((hubo_cmd_bitmap_t)1 << (i%HUBO_CMD_BITMAP_WORD_BITS));
         }
     }
 
@@ -300,7 +387,7 @@ hubo_joint_cmd_t* hubo_cmd_data_access_joint_cmd(hubo_cmd_data *data, size_t joi
         return NULL;
     }
 
-    return (hubo_joint_cmd_t*)(data+hubo_cmd_data_location(joint_index));
+    return (hubo_joint_cmd_t*)(data+hubo_cmd_data_location(data, joint_index));
 }
 
 hubo_data_error_t hubo_cmd_data_get_joint_cmd(hubo_joint_cmd_t *output, const hubo_cmd_data *data, size_t joint_index)
@@ -322,29 +409,19 @@ hubo_data_error_t hubo_cmd_data_get_joint_cmd(hubo_joint_cmd_t *output, const hu
 
     if(hubo_cmd_data_is_compressed(data) == 1) // The data is compressed
     {
-        hubo_cmd_header_t* header = (hubo_cmd_header_t*)data;
-        if( ( (header->bitmap >> joint_index) & 0x01 ) == 0 )
+        if( hubo_cmd_data_check_if_joint_is_set(data, joint_index) == 0 )
         {
             fprintf(stderr, "Attempting to get joint information from a compressed data set which does not\n"
                     "\tcontain the requested joint index (%zu)\n", joint_index);
             return HUBO_DATA_UNAVAILABLE_INDEX;
         }
 
-        size_t i=0;
-        size_t location=0;
-        for(i=0; i < joint_index; ++i)
-        {
-            if( (header->bitmap >> i ) & 0x01 )
-            {
-                ++location;
-            }
-        }
-
-        memcpy(output, data+hubo_cmd_data_location(location), sizeof(hubo_joint_cmd_t));
+        memcpy(output, data+hubo_cmd_data_location(data, hubo_cmd_data_compressed_index(data, joint_index)),
+               sizeof(hubo_joint_cmd_t));
     }
     else if(hubo_cmd_data_is_compressed(data) == 0) // The data is NOT compressed
     {
-        memcpy(output, data+hubo_cmd_data_location(joint_index), sizeof(hubo_joint_cmd_t));
+        memcpy(output, data+hubo_cmd_data_location(data, joint_index), sizeof(hubo_joint_cmd_t));
     }
     else
     {
@@ -361,23 +438,7 @@ size_t hubo_cmd_data_get_size(const hubo_cmd_data *data)
     if( hubo_cmd_header_check(data) !=0 )
         return 0;
 
-    const hubo_cmd_header_t* header = (hubo_cmd_header_t*)data;
-
-    if(header->is_compressed == 0)
-        return hubo_cmd_data_predict_max_message_size(header->total_num_joints);
-
-    size_t i=0;
-    size_t joints_used = 0;
-    size_t total_num_joints = header->total_num_joints;
-    for(i=0; i < total_num_joints; ++i)
-    {
-        if( (header->bitmap >> i) & 0x01 )
-        {
-            ++joints_used;
-        }
-    }
-
-    return hubo_cmd_data_predict_max_message_size(joints_used);
+    return hubo_cmd_data_get_min_data_size(data);
 }
 
 
@@ -388,12 +449,132 @@ int hubo_cmd_data_check_if_joint_is_set(const hubo_cmd_data *data, size_t joint_
     if( joint_index >= header->total_num_joints )
         return -1;
     else
-        return (header->bitmap >> joint_index) & 0x01;
+        return (hubo_cmd_data_get_bitmap(data)[joint_index/HUBO_CMD_BITMAP_WORD_BITS]
+                >> (joint_index%HUBO_CMD_BITMAP_WORD_BITS)) & 0x01;
 
 }
 
+double hubo_cmd_time_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec) + (double)(now.tv_nsec)/1E9;
+}
 
+void hubo_cmd_data_stamp(hubo_cmd_data* data, double send_time,
+                         double horizon, hubo_cmd_expiry_t expiry)
+{
+    if(hubo_cmd_header_check(data) != HUBO_DATA_OKAY)
+        return;
 
+    ((hubo_cmd_header_t*)data)->send_time = send_time;
 
+    if(hubo_cmd_data_is_compressed(data) == 1)
+    {
+        fprintf(stderr, "Attempting to stamp the joint deadlines of a hubo_cmd_data which is compressed. Stamp it before compressing!\n");
+        return;
+    }
 
+    double deadline = horizon > 0 ? send_time + horizon : 0;
+    const hubo_cmd_bitmap_t* bitmap = hubo_cmd_data_get_bitmap(data);
+    size_t words = hubo_cmd_data_bitmap_words(hubo_cmd_data_get_total_num_joints(data));
+    size_t w=0;
+    for(w=0; w<words; ++w)
+    {
+        hubo_cmd_bitmap_t word = bitmap[w];
+        while(word)
+        {
+            hubo_joint_cmd_t* cmd = (hubo_joint_cmd_t*)(data + hubo_cmd_data_location(data,
+                                    w*HUBO_CMD_BITMAP_WORD_BITS + __builtin_ctzll(word)));
+            cmd->deadline = deadline;
+            cmd->expiry = expiry;
+            word &= word - 1;
+        }
+    }
+}
 
+double hubo_cmd_data_get_send_time(const hubo_cmd_data* data)
+{
+    if( NULL == data )
+        return 0;
+
+    return ((const hubo_cmd_header_t*)data)->send_time;
+}
+
+int hubo_joint_cmd_is_expired(const hubo_joint_cmd_t* cmd, double now)
+{
+    return cmd->deadline > 0 && now > cmd->deadline;
+}
+
+void hubo_joint_cmd_apply_expiry(hubo_joint_cmd_t* cmd)
+{
+    switch(cmd->expiry)
+    {
+        case HUBO_CMD_EXPIRE_COMPLY:
+            cmd->mode = HUBO_CMD_COMPLIANT;
+            cmd->base_torque = 0;
+            cmd->kP_gain = 0;
+            cmd->kD_gain = 0;
+            break;
+        case HUBO_CMD_EXPIRE_RELEASE:
+            cmd->mode = HUBO_CMD_IGNORE;
+            break;
+        case HUBO_CMD_EXPIRE_HOLD:
+        default:
+            break;
+    }
+
+    cmd->deadline = 0;
+}
+
+static double hubo_cmd_setpoint_slope(const hubo_cmd_setpoint_t* a, const hubo_cmd_setpoint_t* b)
+{
+    double dt = b->time - a->time;
+    if(dt <= 0)
+        return 0;
+
+    return (b->position - a->position)/dt;
+}
+
+float hubo_joint_cmd_interpolate(const hubo_joint_cmd_t* cmd, double time)
+{
+    size_t count = cmd->setpoint_count;
+    if(count > HUBO_CMD_MAX_SETPOINTS)
+        count = HUBO_CMD_MAX_SETPOINTS;
+
+    if(count == 0)
+        return cmd->position;
+
+    const hubo_cmd_setpoint_t* s = cmd->setpoints;
+    if(time <= s[0].time)
+        return s[0].position;
+
+    if(time >= s[count-1].time)
+        return s[count-1].position;
+
+    size_t k=0;
+    while(k+2 < count && time >= s[k+1].time)
+        ++k;
+
+    // Cubic Hermite segment with Catmull-Rom tangents, so the reference stays smooth across
+    // setpoints. The end tangents are one-sided so that we never overshoot the horizon.
+    double h = s[k+1].time - s[k].time;
+    if(h <= 0)
+        return s[k+1].position;
+
+    double m0 = k > 0 ? 0.5*(hubo_cmd_setpoint_slope(&s[k-1], &s[k])
+                             + hubo_cmd_setpoint_slope(&s[k], &s[k+1]))
+                      : hubo_cmd_setpoint_slope(&s[k], &s[k+1]);
+    double m1 = k+2 < count ? 0.5*(hubo_cmd_setpoint_slope(&s[k], &s[k+1])
+                                   + hubo_cmd_setpoint_slope(&s[k+1], &s[k+2]))
+                            : hubo_cmd_setpoint_slope(&s[k], &s[k+1]);
+
+    double u = (time - s[k].time)/h;
+    double u2 = u*u;
+    double u3 = u2*u;
+
+    return (float)( (2*u3 - 3*u2 + 1)*s[k].position
+                   + (u3 - 2*u2 + u)*h*m0
+                   + (-2*u3 + 3*u2)*s[k+1].position
+                   + (u3 - u2)*h*m1 );
+}
@@ -84,6 +84,46 @@ std::ostream& operator<<(std::ostream& stream, const hubo_data_error_t& error)
     return stream;
 }
 
+const char* hubo_cmd_expiry_to_string(hubo_cmd_expiry_t expiry)
+{
+    switch(expiry)
+    {
+        return_enum_string(HUBO_CMD_EXPIRE_HOLD);
+        return_enum_string(HUBO_CMD_EXPIRE_COMPLY);
+        return_enum_string(HUBO_CMD_EXPIRE_RELEASE);
+
+        default: return "HUBO_CMD_EXPIRE_UNKNOWN";
+    }
+
+    return "HUBO_CMD_EXPIRE_IMPOSSIBLE";
+}
+
+std::ostream& operator<<(std::ostream& stream, const hubo_cmd_expiry_t& expiry)
+{
+    stream << hubo_cmd_expiry_to_string(expiry);
+    return stream;
+}
+
+const char* hubo_cmd_safety_policy_to_string(hubo_cmd_safety_policy_t policy)
+{
+    switch(policy)
+    {
+        return_enum_string(HUBO_CMD_SAFETY_OFF);
+        return_enum_string(HUBO_CMD_SAFETY_CLAMP);
+        return_enum_string(HUBO_CMD_SAFETY_REJECT);
+
+        default: return "HUBO_CMD_SAFETY_UNKNOWN";
+    }
+
+    return "HUBO_CMD_SAFETY_IMPOSSIBLE";
+}
+
+std::ostream& operator<<(std::ostream& stream, const hubo_cmd_safety_policy_t& policy)
+{
+    stream << hubo_cmd_safety_policy_to_string(policy);
+    return stream;
+}
+
 std::ostream& operator<<(std::ostream& stream, const hubo_joint_cmd_t& cmd)
 {
     stream.precision(3);
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "HuboCmd/CmdSlots.hpp"
+
+#include <iostream>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace HuboCmd;
+
+// Gives the test a way to break a slot the way a writer dying mid-copy would
+class SlotBreaker : public CmdSlots
+{
+public:
+    SlotBreaker(const std::string& name) : CmdSlots(name) { }
+
+    void leave_mid_copy(int slot)
+    {
+        __atomic_add_fetch(&_slot(slot)->sequence, 1, __ATOMIC_RELEASE);
+    }
+};
+
+int main(int, char* [])
+{
+    const std::string name = "/hubo_cmd_slots_test";
+    size_t num_joints = 40;
+    size_t max_size = hubo_cmd_data_predict_max_message_size(num_joints);
+
+    CmdSlots aggregator_side(name);
+    if(!aggregator_side.create(num_joints))
+        return 1;
+
+    pid_t child = fork();
+    if(child == 0)
+    {
+        CmdSlots commander_side(name);
+        if(!commander_side.attach(num_joints))
+            exit(1);
+
+        int slot = commander_side.claim();
+        if(slot < 0)
+            exit(2);
+
+        hubo_cmd_data* data = hubo_cmd_init_data(num_joints);
+        hubo_joint_cmd_t jc;
+        memset(&jc, 0, sizeof(jc));
+        for(size_t n=1; n <= 200000; ++n)
+        {
+            // Every joint gets the same value, so a torn copy would be easy to spot
+            jc.position = n;
+            for(size_t i=0; i < num_joints; ++i)
+                hubo_cmd_data_set_joint_cmd(data, &jc, i);
+            commander_side.write(slot, data, max_size);
+        }
+
+        commander_side.release(slot);
+        free(data);
+        exit(0);
+    }
+
+    hubo_cmd_data* input = hubo_cmd_init_data(num_joints);
+    hubo_joint_cmd_t jc;
+    size_t reads = 0;
+    float last = 0;
+    int status = -1;
+    while(true)
+    {
+        bool finished = waitpid(child, &status, WNOHANG) == child;
+
+        for(size_t s=0; s < aggregator_side.slot_count(); ++s)
+        {
+            size_t size;
+            if(!aggregator_side.read(s, input, max_size, size))
+                continue;
+
+            ++reads;
+            hubo_cmd_data_get_joint_cmd(&jc, input, 0);
+            float value = jc.position;
+            if(value < last)
+            {
+                std::cout << "Read an older message (" << value << ") after " << last << std::endl;
+                return 1;
+            }
+            last = value;
+
+            for(size_t i=1; i < num_joints; ++i)
+            {
+                hubo_cmd_data_get_joint_cmd(&jc, input, i);
+                if(jc.position != value)
+                {
+                    std::cout << "Torn read! Joint 0 has " << value << " but joint " << i
+                              << " has " << jc.position << std::endl;
+                    return 1;
+                }
+            }
+        }
+
+        if(finished)
+            break;
+    }
+
+    if(WEXITSTATUS(status) != 0 || last != 200000)
+    {
+        std::cout << "The commander side failed (" << WEXITSTATUS(status)
+                  << ") or its last message (" << last << ") was lost" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Read " << reads << " consistent messages from the slot" << std::endl;
+
+    // A commander which dies halfway through a write leaves its slot with an odd sequence
+    child = fork();
+    if(child == 0)
+    {
+        SlotBreaker doomed(name);
+        if(!doomed.attach(num_joints))
+            exit(1);
+
+        int slot = doomed.claim();
+        if(slot < 0)
+            exit(2);
+
+        doomed.leave_mid_copy(slot);
+        exit(0); // Without releasing the slot
+    }
+    waitpid(child, &status, 0);
+    if(WEXITSTATUS(status) != 0)
+    {
+        std::cout << "Failed to set up the dead commander (" << WEXITSTATUS(status) << ")"
+                  << std::endl;
+        return 1;
+    }
+
+    // Take every free slot, so that the last claim has to recycle the dead commander's slot
+    CmdSlots recycler(name);
+    if(!recycler.attach(num_joints))
+        return 1;
+
+    int recycled = -1;
+    for(size_t s=0; s < aggregator_side.slot_count(); ++s)
+        recycled = recycler.claim();
+
+    if(recycled < 0)
+    {
+        std::cout << "The dead commander's slot was not recycled" << std::endl;
+        return 1;
+    }
+
+    hubo_cmd_data* output = hubo_cmd_init_data(num_joints);
+    jc.position = -7;
+    hubo_cmd_data_set_joint_cmd(output, &jc, 0);
+    recycler.write(recycled, output, max_size);
+
+    size_t size;
+    if(!aggregator_side.read(recycled, input, max_size, size))
+    {
+        std::cout << "Slot " << recycled << " could not be read after being recycled" << std::endl;
+        return 1;
+    }
+
+    hubo_cmd_data_get_joint_cmd(&jc, input, 0);
+    if(jc.position != -7)
+    {
+        std::cout << "Read " << jc.position << " from the recycled slot instead of -7" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Recovered slot " << recycled << " from a commander that died mid-copy"
+              << std::endl;
+    free(output);
+    free(input);
+    return 0;
+}
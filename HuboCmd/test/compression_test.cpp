@@ -38,6 +38,8 @@ extern "C" {
 }
 
 #include <iostream>
+#include <stdlib.h>
+#include <vector>
 
 int main(int, char* [])
 {
@@ -56,8 +58,8 @@ int main(int, char* [])
 
     hubo_cmd_header_t* header = (hubo_cmd_header_t*)test_byte;
 
-    std::cout << "pid:\t" << (unsigned int)header->pid << std::endl;
-    std::cout << "bitmap:\t" << (unsigned int)header->bitmap << std::endl;
+    std::cout << "pid:\t" << header->pid << std::endl;
+    std::cout << "bitmap:\t" << hubo_cmd_data_get_bitmap(cx)[0] << std::endl;
 
 
     hubo_joint_cmd_t jc;
@@ -105,5 +107,77 @@ int main(int, char* [])
         std::cout << "mode:" << jc.mode << ", pos:" << jc.position << ", tq:" << jc.base_torque << std::endl;
     }
 
+    // Make sure that robots with more than 64 joints survive the round trip
+    size_t many_joints = 150;
+    hubo_cmd_data* wide = hubo_cmd_init_data(many_joints);
+    hubo_cmd_data* wide_comp = hubo_cmd_init_data(many_joints);
+    size_t expected = 0;
+    for(size_t i=0; i < many_joints; ++i)
+    {
+        if( i%3 == 0 || (i >= 60 && i < 70) || i == many_joints-1 )
+        {
+            jc.position = i;
+            jc.base_torque = -(double)i;
+            hubo_cmd_data_set_joint_cmd(wide, &jc, i);
+            ++expected;
+        }
+    }
+
+    size_t compressed_count = hubo_cmd_data_compressor(wide_comp, wide);
+    if( compressed_count != expected
+            || hubo_cmd_data_count_set_joints(wide_comp) != expected
+            || hubo_cmd_data_get_size(wide_comp) >= hubo_cmd_data_get_size(wide) )
+    {
+        std::cout << "Wide compression produced " << compressed_count << " joints, expected "
+                  << expected << "!" << std::endl;
+        return 1;
+    }
+
+    for(size_t i=0; i < many_joints; ++i)
+    {
+        if( hubo_cmd_data_check_if_joint_is_set(wide, i)
+                != hubo_cmd_data_check_if_joint_is_set(wide_comp, i) )
+        {
+            std::cout << "Bitmap mismatch on joint " << i << std::endl;
+            return 1;
+        }
+
+        if( hubo_cmd_data_check_if_joint_is_set(wide_comp, i) == 1 )
+        {
+            hubo_cmd_data_get_joint_cmd(&jc, wide_comp, i);
+            if( jc.position != i || jc.base_torque != -(double)i )
+            {
+                std::cout << "Wrong command recovered for joint " << i << ": pos:"
+                          << jc.position << ", tq:" << jc.base_torque << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    std::cout << "Compressed " << expected << " of " << many_joints << " joints into "
+              << hubo_cmd_data_get_size(wide_comp) << " bytes (uncompressed: "
+              << hubo_cmd_data_get_size(wide) << ")" << std::endl;
+
+    // Only the selected joints should make it into the compressed data
+    std::vector<hubo_cmd_bitmap_t> selection(hubo_cmd_data_bitmap_words(many_joints), 0);
+    selection[1] = (hubo_cmd_bitmap_t)1 << (66-64);  // Set in the data
+    selection[2] = (hubo_cmd_bitmap_t)1 << (130-128); // Not set in the data
+    if( hubo_cmd_data_compress_selection(wide_comp, wide, &selection[0]) != 1
+            || hubo_cmd_data_count_set_joints(wide_comp) != 1
+            || hubo_cmd_data_check_if_joint_is_set(wide_comp, 66) != 1 )
+    {
+        std::cout << "Selective compression did not pick out joint 66!" << std::endl;
+        return 1;
+    }
+    hubo_cmd_data_get_joint_cmd(&jc, wide_comp, 66);
+    if( jc.position != 66 )
+    {
+        std::cout << "Selective compression recovered the wrong command for joint 66" << std::endl;
+        return 1;
+    }
+
+    free(wide);
+    free(wide_comp);
+
     return 0;
 }
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+extern "C" {
+#include "HuboCmd/hubo_cmd_c.h"
+}
+
+#include "HuboCmd/hubo_cmd_stream.hpp"
+
+#include <iostream>
+#include <stdlib.h>
+
+int main(int, char* [])
+{
+    size_t num_joints = 70;
+    hubo_cmd_data* cmd = hubo_cmd_init_data(num_joints);
+    hubo_cmd_data* comp = hubo_cmd_init_data(num_joints);
+
+    hubo_joint_cmd_t jc;
+    memset(&jc, 0, sizeof(jc));
+    jc.mode = HUBO_CMD_RIGID;
+    jc.position = 0.5;
+    jc.kP_gain = 100;
+    jc.kD_gain = 10;
+
+    hubo_cmd_data_set_joint_cmd(cmd, &jc, 2);
+    hubo_cmd_data_set_joint_cmd(cmd, &jc, 67);
+
+    double now = hubo_cmd_time_now();
+    hubo_cmd_data_stamp(cmd, now, 0.01, HUBO_CMD_EXPIRE_COMPLY);
+    hubo_cmd_data_compressor(comp, cmd);
+
+    if(hubo_cmd_data_get_send_time(comp) != now)
+    {
+        std::cout << "The send time did not survive compression!" << std::endl;
+        return 1;
+    }
+
+    hubo_cmd_data_get_joint_cmd(&jc, comp, 67);
+    if(hubo_joint_cmd_is_expired(&jc, now + 0.005))
+    {
+        std::cout << "Command expired before its deadline!" << std::endl;
+        return 1;
+    }
+
+    if(!hubo_joint_cmd_is_expired(&jc, now + 0.02))
+    {
+        std::cout << "Command did not expire after its deadline!" << std::endl;
+        return 1;
+    }
+
+    hubo_joint_cmd_apply_expiry(&jc);
+    std::cout << "Expired (" << HUBO_CMD_EXPIRE_COMPLY << "): " << jc << std::endl;
+    if(jc.mode != HUBO_CMD_COMPLIANT || jc.kP_gain != 0 || jc.kD_gain != 0
+            || hubo_joint_cmd_is_expired(&jc, now + 1))
+    {
+        std::cout << "The expiry policy was not applied correctly!" << std::endl;
+        return 1;
+    }
+
+    // A horizon of zero means the command never expires
+    hubo_cmd_data_stamp(cmd, now, 0, HUBO_CMD_EXPIRE_RELEASE);
+    hubo_cmd_data_get_joint_cmd(&jc, cmd, 2);
+    if(hubo_joint_cmd_is_expired(&jc, now + 1000))
+    {
+        std::cout << "A command without a horizon expired!" << std::endl;
+        return 1;
+    }
+
+    free(cmd);
+    free(comp);
+
+    return 0;
+}
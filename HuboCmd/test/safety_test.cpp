@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "HuboCmd/Aggregator.hpp"
+
+#include <iostream>
+#include <cmath>
+
+// Runs the aggregator's limit check directly on a single joint
+class SafetyChecker : public HuboCmd::Aggregator
+{
+public:
+    SafetyChecker(HuboCan::HuboDescription& desc) : HuboCmd::Aggregator(desc) { }
+
+    double check(double reference)
+    {
+        hubo_joint_cmd_t& cmd = _aggregated_cmds[0];
+        cmd.mode = HUBO_CMD_RIGID;
+        cmd.position = reference;
+        _check_hubocan_state();
+        return _aggregated_cmds[0].position;
+    }
+};
+
+static HuboCan::HuboDescription make_description()
+{
+    HuboCan::HuboDescription desc;
+    desc.params.frequency = 100;
+
+    HuboCan::HuboJoint* joint = new HuboCan::HuboJoint;
+    strcpy(joint->info.name, "TST");
+    joint->info.limits.min_position = -10;
+    joint->info.limits.max_position = 10;
+    joint->info.limits.max_speed = 1;
+    joint->info.limits.max_accel = 2;
+    desc.joints.push_back(joint);
+    return desc;
+}
+
+int main(int, char* [])
+{
+    HuboCan::HuboDescription desc = make_description();
+    const double max_step = 1.0/100;
+    const double max_step_change = 2.0/(100*100);
+    // The commands carry single precision positions
+    const double eps = 1e-6;
+
+    // A large jump under the clamp policy must be ramped in without overshooting the target
+    SafetyChecker clamp(desc);
+    clamp.set_safety_policy(HUBO_CMD_SAFETY_CLAMP);
+    double previous = clamp.check(0);
+    double previous_step = 0;
+    double target = 1;
+    size_t cycles = 0;
+    for(; cycles < 1000 && previous != target; ++cycles)
+    {
+        double position = clamp.check(target);
+        double step = position - previous;
+        if( position > target + eps )
+        {
+            std::cout << "The clamped reference overshot the target: " << position
+                      << " after " << cycles << " cycles" << std::endl;
+            return 1;
+        }
+
+        if( fabs(step) > max_step + eps || fabs(step - previous_step) > max_step_change + eps )
+        {
+            std::cout << "The clamped reference broke its limits at cycle " << cycles
+                      << " (step " << step << " after " << previous_step << ")" << std::endl;
+            return 2;
+        }
+
+        previous = position;
+        previous_step = step;
+    }
+
+    if( previous != target )
+    {
+        std::cout << "The clamped reference never reached the target (" << previous << ")"
+                  << std::endl;
+        return 3;
+    }
+    std::cout << "Clamped a jump of " << target << " into " << cycles << " cycles" << std::endl;
+
+    // The same jump under the reject policy gets refused outright
+    SafetyChecker reject(desc);
+    reject.set_safety_policy(HUBO_CMD_SAFETY_REJECT);
+    reject.check(0);
+    if( reject.check(target) != 0 || reject.safety_counts()[0].rejected != 1 )
+    {
+        std::cout << "The reject policy let a jump through" << std::endl;
+        return 4;
+    }
+
+    // ... while a reference which respects the limits passes through untouched
+    double position = 0;
+    double step = 0;
+    for(size_t i=0; i < 50; ++i)
+    {
+        step += max_step_change/2;
+        position += step;
+        if( fabs(reject.check(position) - position) > eps )
+        {
+            std::cout << "The reject policy refused a safe reference at cycle " << i << std::endl;
+            return 5;
+        }
+    }
+
+    if( reject.safety_counts()[0].rejected != 1 )
+    {
+        std::cout << "Safe references were counted as rejected" << std::endl;
+        return 6;
+    }
+
+    std::cout << "The reject policy refused the jump and passed the ramp" << std::endl;
+    return 0;
+}
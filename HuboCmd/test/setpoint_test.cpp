@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+extern "C" {
+#include "HuboCmd/hubo_cmd_c.h"
+}
+
+#include <iostream>
+#include <string.h>
+#include <math.h>
+
+int main(int, char* [])
+{
+    hubo_joint_cmd_t cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.position = 5;
+
+    if(hubo_joint_cmd_interpolate(&cmd, 1.0) != 5)
+    {
+        std::cout << "A command without setpoints should use its position directly!" << std::endl;
+        return 1;
+    }
+
+    // Setpoints along a straight line should be reproduced exactly in between
+    cmd.setpoint_count = 4;
+    for(size_t i=0; i < 4; ++i)
+    {
+        cmd.setpoints[i].time = 10.0 + 0.01*i;
+        cmd.setpoints[i].position = 0.2*i;
+    }
+
+    for(double t = 10.0; t <= 10.03; t += 0.001)
+    {
+        double expected = 0.2*(t-10.0)/0.01;
+        float ref = hubo_joint_cmd_interpolate(&cmd, t);
+        if(fabs(ref - expected) > 1e-4)
+        {
+            std::cout << "Interpolated " << ref << " at t=" << t << " but expected "
+                      << expected << std::endl;
+            return 1;
+        }
+    }
+
+    if(hubo_joint_cmd_interpolate(&cmd, 9.0) != 0.0f
+            || hubo_joint_cmd_interpolate(&cmd, 11.0) != cmd.setpoints[3].position)
+    {
+        std::cout << "References outside of the horizon should hold the nearest setpoint!" << std::endl;
+        return 1;
+    }
+
+    // A curved horizon should stay smooth and pass through every setpoint
+    cmd.setpoints[2].position = 0.6;
+    cmd.setpoints[3].position = 0.5;
+    float last = hubo_joint_cmd_interpolate(&cmd, 10.0);
+    for(double t = 10.0005; t <= 10.03; t += 0.0005)
+    {
+        float ref = hubo_joint_cmd_interpolate(&cmd, t);
+        if(fabs(ref - last) > 0.05)
+        {
+            std::cout << "Jump of " << ref - last << " at t=" << t << std::endl;
+            return 1;
+        }
+        last = ref;
+    }
+
+    for(size_t i=0; i < 4; ++i)
+    {
+        if(fabs(hubo_joint_cmd_interpolate(&cmd, cmd.setpoints[i].time)
+                - cmd.setpoints[i].position) > 1e-5)
+        {
+            std::cout << "The reference missed setpoint #" << i << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "Setpoint interpolation passed" << std::endl;
+    return 0;
+}
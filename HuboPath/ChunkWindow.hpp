@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef HUBOPATH_CHUNKWINDOW_HPP
+#define HUBOPATH_CHUNKWINDOW_HPP
+
+extern "C" {
+#include "hubo_path_c.h"
+}
+
+#include <vector>
+#include <stddef.h>
+
+namespace HuboPath {
+
+/*!
+ * \class ChunkWindow
+ * \brief The sending end's bookkeeping for a trajectory transfer: which chunk to put on the
+ * input channel next, and how many frames are still waiting there to be read
+ *
+ * Every frame counts against HUBO_PATH_WINDOW_SIZE until the receiver has read it, whether it
+ * carries a new chunk or a resent one. The receiver reads its frames in order and reports the
+ * last chunk it read, which tells how many of the frames it has gone through. This class does
+ * no IO, so the caller decides how chunks travel and how time passes.
+ */
+class ChunkWindow
+{
+public:
+
+    ChunkWindow(uint32_t total_chunks = 0, double retransmit_timeout = 0.1);
+
+    void reset(uint32_t total_chunks);
+
+    /*!
+     * \fn next(double now, uint32_t& chunk_id)
+     * \brief Pick the next chunk to put on the channel at time now: one that the receiver has
+     * reported missing, or else the next new chunk. Returns false if nothing should be sent
+     * right now, which includes when the window is full.
+     */
+    bool next(double now, uint32_t& chunk_id);
+
+    /*!
+     * \fn timed_out(double now, uint32_t& chunk_id)
+     * \brief Nothing has been heard from the receiver for a while, so either the oldest
+     * unacknowledged chunk or its acknowledgment got lost. Returns false if there is nothing
+     * to resend, or if resending it could overwrite a frame which has not been read yet.
+     */
+    bool timed_out(double now, uint32_t& chunk_id);
+
+    /*!
+     * \fn acknowledge(const hubo_path_rx_t& feedback, double now)
+     * \brief Take in a report from the receiver. Chunks which it skipped over get queued up for
+     * next(). Returns true if the cumulative acknowledgment moved forward.
+     */
+    bool acknowledge(const hubo_path_rx_t& feedback, double now);
+
+    inline uint32_t total_chunks() const { return _total_chunks; }
+    inline uint32_t acked() const { return _acked; }
+    inline uint32_t sent() const { return _next; }
+    inline size_t in_flight() const { return _puts.size() - _read; }
+    inline size_t retransmits() const { return _retransmits; }
+
+protected:
+
+    void _put(uint32_t chunk_id, double now);
+
+    uint32_t _total_chunks;
+    double _retransmit_timeout;
+    uint32_t _acked;
+    uint32_t _next;
+    size_t _retransmits;
+
+    std::vector<double> _sent_time;
+    std::vector<bool> _missing;
+    std::vector<uint32_t> _puts;    // The chunk carried by every frame put so far, in order
+    size_t _read;                   // How many of those frames the receiver has gone through
+};
+
+} // namespace HuboPath
+
+#endif // HUBOPATH_CHUNKWINDOW_HPP
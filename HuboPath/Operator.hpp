@@ -104,7 +104,8 @@ public:
      * \brief Informs the interpolator of your input frequency.
      * \param frequency
      * 
-     * This only needs to be used for an interpolation mode of HUBO_PATH_DENSIFY.
+     * This only needs to be used for an interpolation mode of HUBO_PATH_DENSIFY or
+     * HUBO_PATH_DENSIFY_CUBIC, where each waypoint is 1/frequency seconds after the last.
      */
     void setInputFrequency(double frequency);
     
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef HUBOPATH_PACKEDTRAJECTORY_HPP
+#define HUBOPATH_PACKEDTRAJECTORY_HPP
+
+#include "Trajectory.hpp"
+
+namespace HuboPath {
+
+/*!
+ * \class PackedTrajectory
+ * \brief Compact storage for a Trajectory, holding only the joints in its bitmap
+ *
+ * A hubo_path_element_t always has room for HUBO_PATH_JOINT_MAX_SIZE references, even when the
+ * path only moves a handful of joints. A PackedTrajectory keeps one float per active joint per
+ * step instead, which is also the format that trajectories are sent in. Individual steps can be
+ * expanded back into a hubo_path_element_t as they are needed.
+ */
+class PackedTrajectory
+{
+public:
+
+    PackedTrajectory();
+    PackedTrajectory(const Trajectory& trajectory);
+
+    /*!
+     * \fn pack(const Trajectory& trajectory)
+     * \brief Replace the contents of this PackedTrajectory with a packed copy of trajectory
+     */
+    void pack(const Trajectory& trajectory);
+
+    /*!
+     * \fn unpack(Trajectory& trajectory)
+     * \brief Replace the params and elements of trajectory with the contents of this
+     * PackedTrajectory. Joints which are not in the bitmap will have references of zero.
+     */
+    void unpack(Trajectory& trajectory) const;
+
+    /*!
+     * \fn unpack(Trajectory& trajectory, size_t begin, size_t end)
+     * \brief Same as unpack(Trajectory&), but only for the steps in [begin, end)
+     */
+    void unpack(Trajectory& trajectory, size_t begin, size_t end) const;
+
+    /*!
+     * \fn expand(size_t index, hubo_path_element_t& elem)
+     * \brief Fill in the phase index and active joint references of elem with step index.
+     * The references of inactive joints are left untouched.
+     */
+    bool expand(size_t index, hubo_path_element_t& elem) const;
+
+    inline size_t size() const { return _phase_indices.size(); }
+    inline size_t joint_count() const { return _active.size(); }
+    inline const IndexArray& active_indices() const { return _active; }
+    inline const hubo_path_params_t& params() const { return _params; }
+
+    void clear();
+    void swap(PackedTrajectory& other);
+
+    /*!
+     * \fn operator==(const PackedTrajectory& other)
+     * \brief True if both have the same params and exactly the same steps
+     */
+    bool operator==(const PackedTrajectory& other) const;
+
+    /*!
+     * \fn write(std::ostream& stream)
+     * \brief Save the params and steps in a raw binary form which read() can load back
+     */
+    bool write(std::ostream& stream) const;
+    bool read(std::istream& stream);
+
+    /*!
+     * \fn chunk_capacity()
+     * \brief The number of steps which fit into each chunk of a transmission
+     */
+    uint32_t chunk_capacity() const;
+    uint32_t chunk_count() const;
+
+    /*!
+     * \fn write_chunk(uint32_t chunk_id, hubo_path_chunk_t* chunk)
+     * \brief Fill in chunk with its share of the steps. The chunk must point to a buffer of at
+     * least HUBO_PATH_CHUNK_MAX_BYTES. Returns the number of bytes to transmit, or 0 if chunk_id
+     * is out of range.
+     */
+    size_t write_chunk(uint32_t chunk_id, hubo_path_chunk_t* chunk) const;
+
+    /*!
+     * \fn read_chunk(const hubo_path_chunk_t* chunk)
+     * \brief Put the steps of a received chunk into their place. The first chunk to arrive
+     * sets the params and the size of the whole trajectory, and every later chunk must agree
+     * with it. Chunks may arrive in any order.
+     *
+     * Until finish_reading() is called, size() is rounded up to a whole number of chunks.
+     */
+    HuboCan::error_result_t read_chunk(hubo_path_chunk_t* chunk);
+
+    /*!
+     * \fn finish_reading()
+     * \brief Trim off the unused space after the final chunk once every chunk has been read.
+     * Nothing else changes size while chunks are being read, so another thread may expand()
+     * steps which have already arrived until this gets called.
+     */
+    void finish_reading();
+
+    /*!
+     * \fn incoming_size()
+     * \brief The true size of the trajectory being read, or 0 if the final chunk has not
+     * arrived yet
+     */
+    inline size_t incoming_size() const { return _incoming_size; }
+
+protected:
+
+    void _load_params(const hubo_path_params_t& params);
+
+    hubo_path_params_t _params;
+    uint32_t _incoming_chunks;
+    size_t _incoming_size;
+    IndexArray _active;
+    std::vector<float> _references; // joint_count() references for each step, back to back
+    std::vector<uint64_t> _phase_indices;
+};
+
+} // namespace HuboPath
+
+#endif // HUBOPATH_PACKEDTRAJECTORY_HPP
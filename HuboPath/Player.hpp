@@ -38,14 +38,97 @@
 
 #include "HuboCmd/Commander.hpp"
 #include "hubo_path.hpp"
+#include "TrajectoryReceiver.hpp"
+#include "TrajectoryCache.hpp"
+
+#include <pthread.h>
 
 namespace HuboPath {
 
+typedef enum {
+
+    INCOMING_ARRIVING = 0,
+    INCOMING_READY,
+    INCOMING_FAILED
+
+} incoming_status_t;
+
+/*!
+ * \struct IncomingTrajectory
+ * \brief A trajectory on its way from the Player's worker thread to its real-time loop
+ *
+ * The worker fills one of these in for each load request, and hands it over by swapping a
+ * pointer. Both threads hold onto it until they are done, and whichever lets go last puts it on
+ * a list for the worker to delete, so that the real-time loop never has to free it.
+ */
+struct IncomingTrajectory
+{
+    IncomingTrajectory(unsigned int request_id);
+
+    PackedTrajectory trajectory;
+    hubo_path_element_t first;  // The first step as it was sent, before any interpolation
+    unsigned int request;       // The load request which this answers
+
+    // Accessed atomically
+    int status;                 // An incoming_status_t
+    size_t validated;           // Steps which have passed the limit check (while streaming)
+    int holders;
+
+    IncomingTrajectory* next_retired;
+};
+
+/*!
+ * \struct PathBlend
+ * \brief A cubic Hermite segment for each joint, which carries the references and velocities
+ * that were playing into the first step of a new trajectory
+ *
+ * All of the joints share the shortest duration (in whole steps) which keeps each of them
+ * within its speed, acceleration, and position limits. The blend gets played right before the
+ * new trajectory, and each step is evaluated as it is played, so it needs no storage.
+ */
+struct PathBlend
+{
+    PathBlend();
+    void clear();
+
+    /*!
+     * \fn plan(double rate, double max_duration)
+     * \brief Find the number of steps for the blend, once the start, end, velocities, and
+     * limits of each joint have been filled in, with rate steps per second. Returns false if
+     * no blend of up to max_duration seconds stays within the limits.
+     */
+    bool plan(double rate, double max_duration);
+    bool fits(double duration) const;
+    bool fits_joint(size_t k, double duration) const;
+
+    /*!
+     * \fn expand(size_t index, hubo_path_element_t& elem)
+     * \brief Fill in the references of the blending joints for step index. Step 0 is the
+     * start, and step number steps would be the end, i.e. the first step of the new
+     * trajectory.
+     */
+    void expand(size_t index, hubo_path_element_t& elem) const;
+
+    size_t steps;
+    double frequency;
+    uint64_t phase_index;
+    double tolerance;
+
+    size_t joint_count;
+    size_t joints[HUBO_PATH_JOINT_MAX_SIZE];
+    double start[HUBO_PATH_JOINT_MAX_SIZE];
+    double start_velocity[HUBO_PATH_JOINT_MAX_SIZE];
+    double end[HUBO_PATH_JOINT_MAX_SIZE];
+    double end_velocity[HUBO_PATH_JOINT_MAX_SIZE];
+    hubo_joint_limits_t limits[HUBO_PATH_JOINT_MAX_SIZE];
+};
+
 class Player : public HuboCmd::Commander
 {
 public:
     Player(double timeout=5);
     Player(HuboCan::HuboDescription& description);
+    virtual ~Player();
 
     virtual bool receive_description(double timeout_sec);
     virtual void load_description(const HuboCan::HuboDescription& description);
@@ -58,13 +141,86 @@ public:
     
     void report_state();
 
+    /*!
+     * \fn set_progressive_playback(double prefix_time, hubo_path_underrun_t underrun)
+     * \brief Start playing HUBO_PATH_RAW trajectories before they have finished arriving
+     * \param prefix_time Seconds of the trajectory which must have arrived and passed the limit
+     * check before playback begins. The remainder gets checked as it comes in, and playback
+     * quits if any of it turns out to be invalid. A value of zero (the default) waits for the
+     * whole trajectory.
+     * \param underrun What to do if playback catches up with the incoming trajectory.
+     *
+     * Trajectories which need to be interpolated are always received in full first.
+     * Call this before the first trajectory gets loaded.
+     */
+    void set_progressive_playback(double prefix_time,
+                                  hubo_path_underrun_t underrun = HUBO_PATH_UNDERRUN_SLOW);
+
+    /*!
+     * \fn set_max_blend_time(double max_time)
+     * \brief The longest blend (in seconds) which HUBO_PATH_BLEND may play before a new
+     * trajectory. If it would take longer, the new trajectory gets rejected. The default is 10.
+     *
+     * The blend gets planned by the real-time loop, in the step where the new trajectory
+     * becomes ready. Planning tries every blend length up to this, but a length which does
+     * not fit usually gets ruled out by the first joint it checks, so the worst case (when
+     * nothing fits) stays well under a millisecond for a full body.
+     */
+    void set_max_blend_time(double max_time);
+
+    /*!
+     * \fn set_trajectory_cache(size_t capacity, const std::string& directory)
+     * \brief Keep the results of interpolating and checking the last capacity trajectories, so
+     * that sending any of them again skips straight to playback
+     * \param capacity How many trajectories to hold in memory. The default is 8, and zero
+     * turns off the memory cache.
+     * \param directory If not empty, the trajectories are also saved into this directory,
+     * where they can be found again after a restart.
+     *
+     * Call this before the first trajectory gets loaded.
+     */
+    bool set_trajectory_cache(size_t capacity, const std::string& directory = "");
+    inline const TrajectoryCache& trajectory_cache() const { return _cache; }
+
 protected:
 
     double _last_time;
 
-    bool _receive_incoming_trajectory();
+    // Used by the real-time loop
+    void _request_trajectory(hubo_path_instruction_t instruction, bool blend=false);
+    void _keep_playing();
+    void _cancel_request();
+    void _fail_request();
+    void _abandon_blend();
+    void _take_incoming();
+    bool _check_start_values(const hubo_path_element_t& first, uint64_t bitmap);
+    bool _plan_blend(const PackedTrajectory& next, size_t available);
+    double _frequency(const PackedTrajectory& trajectory) const;
+    size_t _prefix_steps(const PackedTrajectory& trajectory) const;
+    int _available() const;
+    void _expand_step(int index, hubo_path_element_t& elem) const;
     void _send_element_commands(const hubo_path_element_t& elem);
 
+    inline const PackedTrajectory& _source() const
+    {
+        if(_streaming)
+            return _pending->trajectory;
+
+        return _outgoing ? _outgoing->trajectory : _playback;
+    }
+
+    // Used by the worker thread
+    bool _start_worker();
+    void _stop_worker();
+    static void* _worker_thread(void* player);
+    void _worker_loop();
+    bool _prepare_trajectory(IncomingTrajectory& incoming);
+    bool _validate_stream(IncomingTrajectory& incoming, size_t& validated, size_t end);
+    void _publish(IncomingTrajectory* incoming);
+    void _free_retired();
+
+    // Used by both
+    void _release(IncomingTrajectory* incoming);
 
     bool _first_step;
     bool _new_trajectory;
@@ -74,7 +230,44 @@ protected:
     bool _channels_opened;
     void _initialize_player();
 
+    // Trajectories get received, interpolated, and checked in their full form by the worker
+    // thread, and then packed, so that only the joints they actually use take up memory.
+    // Meanwhile, the real-time loop keeps holding the current references.
+    pthread_t _worker;
+    bool _worker_started;
+    int _worker_active;
+    TrajectoryReceiver _receiver;
     Trajectory _trajectory;
+    Trajectory _check_buffer;
+    TrajectoryCache _cache;
+    std::string _signature;
+
+    // Handoffs between the threads, which are only accessed atomically
+    unsigned int _request;              // Written by the real-time loop
+    IncomingTrajectory* _incoming;      // Written by the worker, taken by the real-time loop
+    IncomingTrajectory* _retired;       // Deleted by the worker
+
+    // While a RAW trajectory is being streamed in, playback reads straight out of _pending, but
+    // never past the steps which have passed the limit check
+    PackedTrajectory _playback;
+    IncomingTrajectory* _pending;
+    bool _waiting;
+    bool _streaming;
+    hubo_path_instruction_t _load_instruction;
+    double _prefix_time;
+    hubo_path_underrun_t _underrun;
+    bool _underrun_reported;
+    bool _slow_phase;
+
+    // A HUBO_PATH_BLEND request keeps the current trajectory playing until the next one is
+    // ready. If the current one was still streaming in, it stays in _outgoing and is cut off
+    // at the last step which passed the limit check. The steps of _blend come first in the
+    // playback index, followed by the steps of the trajectory itself.
+    bool _blend_into;
+    bool _carry_on;
+    IncomingTrajectory* _outgoing;
+    PathBlend _blend;
+    double _max_blend_time;
     int _current_index;
     hubo_path_element_t _current_elem;
     hubo_path_element_t _last_elem;
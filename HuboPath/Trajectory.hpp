@@ -97,7 +97,7 @@ public:
 
     inline void claim_joint(size_t joint_index)
     {
-        params.bitmap = params.bitmap | ( 0x01 << joint_index );
+        params.bitmap = params.bitmap | ( (uint64_t)0x01 << joint_index );
     }
 
     inline void claim_joints(const IndexArray& joint_indices)
@@ -111,11 +111,23 @@ public:
     bool interpolate();
     bool interpolate(hubo_path_interp_t type);
     
+    /*!
+     * \fn check_limits(bool enforceAccelerationLimits, bool printWarnings)
+     * \brief Make sure that no active joint goes past its position, speed, or (optionally)
+     * acceleration limits, and print out every violation that is found.
+     */
     bool check_limits(bool enforceAccelerationLimits = false, bool printWarnings = true) const;
+
+    /*!
+     * \fn within_limits(bool enforceAccelerationLimits)
+     * \brief Same verdict as check_limits(), but without printing anything. It stops at the
+     * first violation, which makes it cheap enough for a planner's inner loop.
+     */
+    bool within_limits(bool enforceAccelerationLimits = false) const;
     
     void get_active_indices(std::vector<size_t>& mapping) const;
     std::vector<size_t> get_active_indices() const;
-    bool get_active_joint_limits(std::vector<hubo_joint_limits_t>& limits);
+    bool get_active_joint_limits(std::vector<hubo_joint_limits_t>& limits) const;
 
 protected:
 
@@ -125,7 +137,7 @@ protected:
     bool _spline_interpolation(const Eigen::VectorXd& velocities,
                                const Eigen::VectorXd& accelerations,
                                double frequency);
-    bool _densify();
+    bool _densify(double frequency, bool cubic);
 
     bool _saturate(const Eigen::VectorXd& max_velocities,
                    const Eigen::VectorXd& max_accelerations,
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef HUBOPATH_TRAJECTORYCACHE_HPP
+#define HUBOPATH_TRAJECTORYCACHE_HPP
+
+#include "PackedTrajectory.hpp"
+
+#include <list>
+#include <map>
+
+namespace HuboPath {
+
+/*!
+ * \class TrajectoryCache
+ * \brief Remembers the results of interpolating and checking trajectories, so that sending the
+ * same waypoints again does not have to redo the work
+ *
+ * Each entry is filed under the signature of the trajectory as it was sent: its params, its
+ * waypoints, and the joint limits and frequency which the interpolation used. A hash of the
+ * signature picks the entry, and the full signature must match before the entry gets used.
+ *
+ * The least recently used entries get dropped once there are more than capacity() of them.
+ * If a directory is given, entries are also saved there as files, so they last between runs.
+ * The files are never removed by the cache.
+ */
+class TrajectoryCache
+{
+public:
+
+    TrajectoryCache(size_t capacity=8, const std::string& directory="");
+
+    /*!
+     * \fn signature(const Trajectory& raw, std::string& result)
+     * \brief Describe everything which the interpolation of raw depends on. Returns false if
+     * the trajectory is not worth caching, i.e. it does not get interpolated or its joint limits
+     * are unknown.
+     */
+    bool signature(const Trajectory& raw, std::string& result) const;
+
+    /*!
+     * \fn fetch(const std::string& signature, PackedTrajectory& result)
+     * \brief Look for the trajectory which was stored under signature, first in memory and then
+     * in the directory. Returns false if it has never been stored.
+     */
+    bool fetch(const std::string& signature, PackedTrajectory& result);
+
+    /*!
+     * \fn store(const std::string& signature, const PackedTrajectory& result)
+     * \brief Keep result under signature, replacing whatever was there before
+     */
+    void store(const std::string& signature, const PackedTrajectory& result);
+
+    void set_capacity(size_t capacity);
+    inline size_t capacity() const { return _capacity; }
+    inline size_t size() const { return _entries.size(); }
+
+    /*!
+     * \fn set_directory(const std::string& directory)
+     * \brief Save entries into directory, creating it if needed. An empty string keeps entries
+     * in memory only. Returns false if the directory cannot be used.
+     */
+    bool set_directory(const std::string& directory);
+    inline const std::string& directory() const { return _directory; }
+
+    /*!
+     * \fn clear()
+     * \brief Forget the entries held in memory. Files in the directory are left alone.
+     */
+    void clear();
+
+    static uint64_t hash(const std::string& signature);
+
+protected:
+
+    struct Entry
+    {
+        uint64_t key;
+        std::string signature;
+        PackedTrajectory trajectory;
+    };
+
+    typedef std::list<Entry> EntryList;
+
+    Entry* _find(uint64_t key, const std::string& signature);
+    Entry& _insert(uint64_t key, const std::string& signature);
+    void _trim();
+
+    std::string _file_name(uint64_t key) const;
+    bool _load_file(uint64_t key, const std::string& signature, PackedTrajectory& result) const;
+    void _save_file(uint64_t key, const std::string& signature,
+                    const PackedTrajectory& result) const;
+
+    size_t _capacity;
+    std::string _directory;
+    EntryList _entries;                                 // Most recently used first
+    std::map<uint64_t, EntryList::iterator> _lookup;
+};
+
+} // namespace HuboPath
+
+#endif // HUBOPATH_TRAJECTORYCACHE_HPP
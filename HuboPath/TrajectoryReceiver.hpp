@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef HUBOPATH_TRAJECTORYRECEIVER_HPP
+#define HUBOPATH_TRAJECTORYRECEIVER_HPP
+
+#include "PackedTrajectory.hpp"
+
+namespace HuboPath {
+
+/*!
+ * \class TrajectoryReceiver
+ * \brief The receiving end of a trajectory transfer, which can be advanced a little at a time
+ *
+ * receive_trajectory() blocks until a whole trajectory has arrived. A TrajectoryReceiver does
+ * the same job, but poll() only takes in whatever has arrived so far, so the caller can keep
+ * doing other things (like playing back the beginning of the trajectory) in the meantime.
+ */
+class TrajectoryReceiver
+{
+public:
+
+    TrajectoryReceiver();
+
+    /*!
+     * \fn begin(ach_channel_t& input_channel, ach_channel_t& feedback_channel, double timeout,
+     *           PackedTrajectory* target)
+     * \brief Tell the sender that we are ready for a new trajectory. The transfer gets abandoned
+     * if no chunk arrives for timeout seconds.
+     * \param target Where the trajectory should be put. If this is NULL, the receiver keeps it
+     * itself. Either way, call finish_reading() on it once the transfer has finished.
+     */
+    void begin(ach_channel_t& input_channel, ach_channel_t& feedback_channel, double timeout,
+               PackedTrajectory* target = NULL);
+
+    /*!
+     * \fn poll(double max_wait_time)
+     * \brief Take in every chunk that has arrived, waiting up to max_wait_time seconds for the
+     * first one, and then acknowledge them.
+     * \return PATH_RX_READ_READY or PATH_RX_LISTENING while the transfer is still going,
+     * PATH_RX_FINISHED once the whole trajectory has arrived, or the reason it failed.
+     */
+    hubo_path_rx_state_t poll(double max_wait_time = 0);
+
+    inline hubo_path_rx_state_t state() const { return _feedback.state; }
+
+    /*!
+     * \fn cancel()
+     * \brief Abandon the transfer if it is still going, and let the sender know
+     */
+    void cancel();
+
+    /*!
+     * \fn available()
+     * \brief The number of steps at the start of the trajectory which have arrived without
+     * any gaps. Chunks past a gap are held onto, but are not counted until the gap is filled.
+     */
+    size_t available() const;
+
+    inline PackedTrajectory& trajectory() { return *_target; }
+    inline const PackedTrajectory& trajectory() const { return *_target; }
+
+protected:
+
+    hubo_path_rx_state_t _quit(hubo_path_rx_state_t state);
+    bool _take_chunk();
+
+    ach_channel_t* _input_chan;
+    ach_channel_t* _feedback_chan;
+    double _timeout;
+    double _last_arrival;
+
+    std::vector<uint8_t> _buffer;
+    hubo_path_rx_t _feedback;
+    PackedTrajectory _trajectory;
+    PackedTrajectory* _target;
+    std::vector<bool> _received;
+    uint32_t _total_chunks;
+    uint32_t _chunk_capacity;
+};
+
+} // namespace HuboPath
+
+#endif // HUBOPATH_TRAJECTORYRECEIVER_HPP
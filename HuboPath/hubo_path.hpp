@@ -58,6 +58,9 @@ std::ostream& operator<<(std::ostream& stream, const hubo_path_interp_t& type);
 const char* hubo_path_instruction_to_string(const hubo_path_instruction_t& type);
 std::ostream& operator<<(std::ostream& stream, const hubo_path_instruction_t& type);
 
+const char* hubo_path_underrun_to_string(const hubo_path_underrun_t& type);
+std::ostream& operator<<(std::ostream& stream, const hubo_path_underrun_t& type);
+
 //const char* hubo_path_element_to_string(const hubo_path_element_t& elem);
 //std::ostream& operator<<(std::ostream& stream, const hubo_path_element_t& elem);
 
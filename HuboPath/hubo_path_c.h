@@ -49,7 +49,7 @@
 #define HUBO_PATH_PLAYER_STATE_CHANNEL "hubo_path_player_state"
 
 //                             123456789012345
-#define HUBO_PATH_HEADER_CODE "PATHHEADERv0.01"
+#define HUBO_PATH_HEADER_CODE "PATHHEADERv0.02"
 #define HUBO_PATH_HEADER_CODE_SIZE 16 // including null-terminator \0
 
 // Maximum number of joints supported in HuboPath messages.
@@ -61,9 +61,19 @@
 // on the HuboDescription. For right now, this is more involved than I think
 // it's worth. Also, this fixed-size format makes it easier to dump into files.
 
-// Maximum number of waypoints transmitted in each message over Ach.
-// This value could be adjusted if 100 turns out to not be optimal.
-#define HUBO_PATH_CHUNK_MAX_SIZE 100
+// Maximum number of bytes transmitted in each message over Ach. This must not exceed the
+// frame size of the hubo_path_input channel. The number of waypoints which fit in a chunk
+// depends on how many joints the path uses; see hubo_path_chunk_capacity().
+#define HUBO_PATH_CHUNK_MAX_BYTES 65536
+
+// Number of frames in the hubo_path_input channel, as created by the configs in misc/configs
+#define HUBO_PATH_INPUT_FRAME_COUNT 16
+
+// Maximum number of frames which the sender may have waiting on the hubo_path_input channel,
+// counting resent chunks as well as new ones. This must be kept below
+// HUBO_PATH_INPUT_FRAME_COUNT, otherwise chunks will get overwritten before the receiver has a
+// chance to read them. The frames in between are kept for resending a chunk after a timeout.
+#define HUBO_PATH_WINDOW_SIZE 12
 
 // A stream of const-sized messages are being used for paths, unlike the
 // single-shoot variable-sized messages for state and command data. This
@@ -77,9 +87,13 @@ typedef enum hubo_path_interp {
                             coming to a stop at each waypoint                               */
     HUBO_PATH_OPTIMAL,  /*! Minimize the time spent travelling along the path, but without
                             violating the joints' nominal speed and acceleration settings   */
-    HUBO_PATH_DENSIFY,  /*! NOT YET IMPLEMENTED. Add points based on input frequency        */
+    HUBO_PATH_DENSIFY,  /*! Resample waypoints which were given at the input frequency
+                            (params.frequency) up to the control frequency, with straight
+                            lines between them                                              */
     HUBO_PATH_SATURATE, /*! Upsample the trajectory just enough to respect joint limits     */
-    HUBO_PATH_RAW       /*! Use the waypoints exactly as they are given                     */
+    HUBO_PATH_RAW,      /*! Use the waypoints exactly as they are given                     */
+    HUBO_PATH_DENSIFY_CUBIC /*! Same as HUBO_PATH_DENSIFY, but with cubic Hermite curves
+                            between the waypoints, so the velocity is continuous too        */
     
 } hubo_path_interp_t;
 // Note: No matter which option is chosen, paths will be rejected if they violate maximum
@@ -98,11 +112,26 @@ typedef enum hubo_path_instruction {
     HUBO_PATH_REVERSE,  /*! Run backwards through the current trajectory. If the trajectory runner
                             is not currently in a trajectory, it will behave the same as pause      */
     HUBO_PATH_LOAD,     /*! Quit the current trajectory and attempt to load a new one. Then pause.  */
-    HUBO_PATH_LOAD_N_GO /*! Quit the current trajectory and attempt to load a new one. Then run.    */
+    HUBO_PATH_LOAD_N_GO,/*! Quit the current trajectory and attempt to load a new one. Then run.    */
+    HUBO_PATH_BLEND     /*! Keep playing the current trajectory while a new one loads. Then blend
+                            from the current references and velocities into the new trajectory,
+                            and run it. Its first element does not need to match the current
+                            references, but it must include every joint which the current one is
+                            still moving. If the new trajectory cannot be loaded or blended into,
+                            the current one carries on                                              */
     
     
 } hubo_path_instruction_t;
 
+typedef enum hubo_path_underrun {
+
+    HUBO_PATH_UNDERRUN_HOLD = 0,/*! Play at full speed, and hold the last step that has arrived
+                                    if playback catches up with the incoming trajectory         */
+    HUBO_PATH_UNDERRUN_SLOW     /*! Play at half speed while less than the starting prefix is
+                                    buffered ahead of playback, and hold if that runs out too   */
+
+} hubo_path_underrun_t;
+
 typedef struct hubo_path_command {
 
     hubo_path_instruction_t instruction;
@@ -129,7 +158,7 @@ typedef struct hubo_path_element {
     // TODO: Add controller-related parameters in here
     
     
-}__attribute__((packed)) hubo_path_element_t; // Size estimate: 400 bytes
+}__attribute__((packed)) hubo_path_element_t; // Size estimate: 520 bytes
 
 typedef struct hubo_path_header {
     
@@ -154,22 +183,41 @@ typedef struct hubo_path_params {
     
 }__attribute__((packed)) hubo_path_params_t; // Size estimate: ~24 bytes
 
+// Chunks are packed for transmission: only the joints selected by the bitmap are included,
+// and their references are narrowed to float, which is all the precision that a joint command
+// can carry anyway. The chunk header is followed by:
+//   1. joint_count hubo_joint_limits_t, in bitmap order, if use_custom_limits is set
+//   2. chunk_size packed elements, each being a uint64_t phase_index followed by joint_count
+//      float references in bitmap order
+// An arm-only path therefore takes about 32 bytes per waypoint instead of over 500.
 typedef struct hubo_path_chunk {
 
     hubo_path_header_t header; // Size estimate: 16 bytes
+
+    double frequency;
+    hubo_path_interp_t interp;
+    double tolerance;
+    uint64_t bitmap;
+    uint8_t use_custom_limits;
+    uint8_t joint_count;    /*! Number of joints in the bitmap                      */
+
+    uint32_t chunk_capacity;/*! Number of steps in every chunk except the last one  */
+    uint32_t chunk_size;    /*! Number of relevant steps in this chunk              */
+    int32_t chunk_id;       /*! ID of this chunk                                    */
+    uint32_t total_chunks;  /*! Total number of chunks to be streamed in            */
     
-    hubo_path_params_t params; // Size estimate: 24 bytes
-    hubo_path_element_t elements[HUBO_PATH_CHUNK_MAX_SIZE]; // Size estimate: 40000 bytes
-    
-    uint32_t chunk_size;    /*! Number of relevant steps in this chunk      */
-    int32_t chunk_id;       /*! ID of this chunk                            */
-    uint32_t total_chunks;  /*! Total number of chunks to be streamed in    */
-    
-}__attribute__((packed)) hubo_path_chunk_t; // Size estimate: ~40000 bytes
+}__attribute__((packed)) hubo_path_chunk_t; // Size estimate: 62 bytes
 
 void clear_hubo_path_chunk(hubo_path_chunk_t* chunk);
 int  check_hubo_path_chunk(const hubo_path_chunk_t* chunk);
 
+size_t hubo_path_packed_element_size(uint8_t joint_count);
+uint32_t hubo_path_chunk_capacity(uint8_t joint_count, uint8_t use_custom_limits);
+size_t hubo_path_chunk_size(const hubo_path_chunk_t* chunk); // Including everything that follows the header
+
+hubo_joint_limits_t* hubo_path_chunk_limits(hubo_path_chunk_t* chunk);
+uint8_t* hubo_path_chunk_element(hubo_path_chunk_t* chunk, uint32_t index);
+
 enum {
     PATH_TX_CANCEL = -2
 };
@@ -191,8 +239,12 @@ typedef struct path_reception {
     
     hubo_path_rx_state_t state;
     
-    uint32_t chunk_id;
+    uint32_t chunk_id;      /*! ID of the most recently received chunk                          */
     uint32_t expected_size;
+
+    uint32_t acked;         /*! Every chunk before this ID has been received                    */
+    uint64_t received_mask; /*! Bit i is set if chunk acked+1+i has been received, so the sender
+                                can tell exactly which chunks went missing                      */
     
 }__attribute__((packed)) hubo_path_rx_t;
 
@@ -64,6 +64,12 @@ public:
         return (1.0 - s) * _start + s * _end;
 	}
 
+	void getConfig(double s, Eigen::VectorXd &config) const {
+		s /= length;
+		s = std::max(0.0, std::min(1.0, s));
+		config.noalias() = (1.0 - s) * _start + s * _end;
+	}
+
 	Eigen::VectorXd getTangent(double /* s */) const {
         return (_end - _start) / length;
 	}
@@ -133,6 +139,11 @@ public:
 		return center + radius * (x * cos(angle) + y * sin(angle));
 	}
 
+	void getConfig(double s, Eigen::VectorXd &config) const {
+		const double angle = s / radius;
+		config.noalias() = center + radius * (x * cos(angle) + y * sin(angle));
+	}
+
 	Eigen::VectorXd getTangent(double s) const {
 		const double angle = s / radius;
 		return - x * sin(angle) + y * cos(angle);
@@ -209,8 +220,10 @@ Path::Path(const list<VectorXd> &path, double maxDeviation) :
 
     size_t ps_counter=0, si_counter=0;
 	// create list of switching point candidates, calculate total path length and absolute positions of path segments
-	for(list<PathSegment*>::iterator segment = pathSegments.begin(); segment != pathSegments.end(); segment++) {
+    segmentPositions.reserve(pathSegments.size());
+	for(vector<PathSegment*>::iterator segment = pathSegments.begin(); segment != pathSegments.end(); segment++) {
 		(*segment)->position = length;
+        segmentPositions.push_back(length);
 		list<double> localSwitchingPoints = (*segment)->getSwitchingPoints();
 		for(list<double>::const_iterator point = localSwitchingPoints.begin(); point != localSwitchingPoints.end(); point++) {
 			switchingPoints.push_back(make_pair(length + *point, false));
@@ -238,15 +251,17 @@ Path::Path(const list<VectorXd> &path, double maxDeviation) :
 Path::Path(const Path &path) :
 	length(path.length),
     switchingLengths(path.switchingLengths),
-    switchingPoints(path.switchingPoints)
+    switchingPoints(path.switchingPoints),
+    segmentPositions(path.segmentPositions)
 {
-	for(list<PathSegment*>::const_iterator it = path.pathSegments.begin(); it != path.pathSegments.end(); it++) {
+    pathSegments.reserve(path.pathSegments.size());
+	for(vector<PathSegment*>::const_iterator it = path.pathSegments.begin(); it != path.pathSegments.end(); it++) {
 		pathSegments.push_back((*it)->clone());
     }
 }
 
 Path::~Path() {
-	for(list<PathSegment*>::iterator it = pathSegments.begin(); it != pathSegments.end(); it++) {
+	for(vector<PathSegment*>::iterator it = pathSegments.begin(); it != pathSegments.end(); it++) {
 		delete *it;
 	}
 }
@@ -255,16 +270,16 @@ double Path::getLength() const {
 	return length;
 }
 
+// The last segment which starts at or before s. Segments with no length share their
+// position with the next one, and get skipped over just like the old linear scan did.
 PathSegment* Path::getPathSegment(double &s) const {
-	list<PathSegment*>::const_iterator it = pathSegments.begin();
-	list<PathSegment*>::const_iterator next = it;
-	next++;
-	while(next != pathSegments.end() && s >= (*next)->position) {
-		it = next;
-		next++;
-	}
-	s -= (*it)->position;
-	return *it;
+    size_t index = upper_bound(segmentPositions.begin(), segmentPositions.end(), s)
+                   - segmentPositions.begin();
+    if(index > 0)
+        --index;
+    PathSegment* segment = pathSegments[index];
+    s -= segment->position;
+    return segment;
 }
 
 VectorXd Path::getConfig(double s) const {
@@ -272,6 +287,11 @@ VectorXd Path::getConfig(double s) const {
 	return pathSegment->getConfig(s);
 }
 
+void Path::getConfig(double s, VectorXd &config) const {
+	const PathSegment* pathSegment = getPathSegment(s);
+	pathSegment->getConfig(s, config);
+}
+
 VectorXd Path::getTangent(double s) const {
 	const PathSegment* pathSegment = getPathSegment(s);
 	return pathSegment->getTangent(s);
@@ -282,11 +302,13 @@ VectorXd Path::getCurvature(double s) const {
 	return pathSegment->getCurvature(s);
 }
 
+static bool switchingPointAfter(double s, const pair<double, bool>& point) {
+    return s < point.first;
+}
+
 double Path::getNextSwitchingPoint(double s, bool &discontinuity) const {
-	list<pair<double, bool> >::const_iterator it = switchingPoints.begin();
-	while(it != switchingPoints.end() && it->first <= s) {
-		it++;
-	}
+	vector<pair<double, bool> >::const_iterator it =
+            upper_bound(switchingPoints.begin(), switchingPoints.end(), s, switchingPointAfter);
 	if(it == switchingPoints.end()) {
 		discontinuity = true;
 		return length;
@@ -297,24 +319,22 @@ double Path::getNextSwitchingPoint(double s, bool &discontinuity) const {
 	}
 }
 
-list<pair<double, bool> > Path::getSwitchingPoints() const {
+const vector<pair<double, bool> >& Path::getSwitchingPoints() const {
 	return switchingPoints;
 }
 
-const vector<double> Path::getSwitchingLengths() const
+const vector<double>& Path::getSwitchingLengths() const
 {
     return switchingLengths;
 }
 
 size_t Path::getPathIndex(double s) const
 {
-    for(size_t i=0; i<switchingLengths.size(); ++i)
-    {
-        if( s <= switchingLengths[i] )
-        {
-            return i;
-        }
-    }
+    // The first switching length which is not below s
+    size_t index = lower_bound(switchingLengths.begin(), switchingLengths.end(), s)
+                   - switchingLengths.begin();
+    if( index < switchingLengths.size() )
+        return index;
 
     return switchingLengths.size()-1;
 }
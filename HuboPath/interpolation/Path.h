@@ -62,6 +62,7 @@ public:
 		return length;
 	}
 	virtual Eigen::VectorXd getConfig(double s) const = 0;
+	virtual void getConfig(double s, Eigen::VectorXd &config) const = 0;
 	virtual Eigen::VectorXd getTangent(double s) const = 0;
 	virtual Eigen::VectorXd getCurvature(double s) const = 0;
 	virtual std::list<double> getSwitchingPoints() const = 0;
@@ -80,18 +81,21 @@ public:
 	~Path();
 	double getLength() const;
 	Eigen::VectorXd getConfig(double s) const;
+	void getConfig(double s, Eigen::VectorXd &config) const;
 	Eigen::VectorXd getTangent(double s) const;
 	Eigen::VectorXd getCurvature(double s) const;
     size_t getPathIndex(double s) const;
 	double getNextSwitchingPoint(double s, bool &discontinuity) const;
-    std::list<std::pair<double, bool> > getSwitchingPoints() const;
-    const std::vector<double> getSwitchingLengths() const;
+    const std::vector<std::pair<double, bool> >& getSwitchingPoints() const;
+    const std::vector<double>& getSwitchingLengths() const;
 private:
     PathSegment* getPathSegment(double &s) const;
     double length;
+    // All of these are sorted by path position, so lookups are binary searches
     std::vector<double> switchingLengths;
-    std::list<std::pair<double, bool> > switchingPoints;
-	std::list<PathSegment*> pathSegments;
+    std::vector<std::pair<double, bool> > switchingPoints;
+	std::vector<PathSegment*> pathSegments;
+    std::vector<double> segmentPositions;
 };
 
 } // namespace HuboInterpolation
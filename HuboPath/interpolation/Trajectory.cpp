@@ -42,6 +42,7 @@
 #include <limits>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 
 using namespace Eigen;
 using namespace std;
@@ -60,7 +61,8 @@ Trajectory::Trajectory(const Path &path, const VectorXd &maxVelocity, const Vect
 	maxAcceleration(maxAcceleration),
 	n(maxVelocity.size()),
 	valid(true),
-	cachedTime(numeric_limits<double>::max())
+	cachedTime(numeric_limits<double>::max()),
+	cachedTrajectorySegment(0)
 {
 	trajectory.push_back(TrajectoryStep(0.0, 0.0));
 	double afterAcceleration = getMinMaxPathAcceleration(0.0, 0.0, true);
@@ -76,21 +78,18 @@ Trajectory::Trajectory(const Path &path, const VectorXd &maxVelocity, const Vect
 
 	if(valid) {
 		endTrajectory.clear();
-		endTrajectory.push_front(TrajectoryStep(path.getLength(), 0.0));
+		endTrajectory.push_back(TrajectoryStep(path.getLength(), 0.0));
 		double beforeAcceleration = getMinMaxPathAcceleration(path.getLength(), 0.0, false);
 		integrateBackward(endTrajectory, trajectory, beforeAcceleration);
 	}
 
 	if(valid) {
 		// calculate timing
-		list<TrajectoryStep>::iterator previous = trajectory.begin();
-		list<TrajectoryStep>::iterator it = previous;
-		it->time = 0.0;
-		it++;
-		while(it != trajectory.end()) {
-			it->time = previous->time + (it->pathPos - previous->pathPos) / ((it->pathVel + previous->pathVel) / 2.0);
-			previous = it;
-			it++;
+		trajectory[0].time = 0.0;
+		for(size_t i = 1; i < trajectory.size(); i++) {
+			const TrajectoryStep &previous = trajectory[i-1];
+			TrajectoryStep &step = trajectory[i];
+			step.time = previous.time + (step.pathPos - previous.pathPos) / ((step.pathVel + previous.pathVel) / 2.0);
 		}
 	}
 	else {
@@ -112,10 +111,10 @@ void Trajectory::outputPhasePlaneTrajectory() const {
 	file1.close();
 
 	ofstream file2("trajectory.txt");
-	for(list<TrajectoryStep>::const_iterator it = trajectory.begin(); it != trajectory.end(); it++) {
+	for(vector<TrajectoryStep>::const_iterator it = trajectory.begin(); it != trajectory.end(); it++) {
 		file2 << it->pathPos << "  " << it->pathVel << endl;
 	}
-	for(list<TrajectoryStep>::const_iterator it = endTrajectory.begin(); it != endTrajectory.end(); it++) {
+	for(vector<TrajectoryStep>::const_reverse_iterator it = endTrajectory.rbegin(); it != endTrajectory.rend(); it++) {
 		file2 << it->pathPos << "  " << it->pathVel << endl;
 	}
 	file2.close();
@@ -237,13 +236,13 @@ bool Trajectory::getNextVelocitySwitchingPoint(double pathPos, TrajectoryStep &n
 }
 
 // returns true if end of path is reached
-bool Trajectory::integrateForward(list<TrajectoryStep> &trajectory, double acceleration) {
+bool Trajectory::integrateForward(vector<TrajectoryStep> &trajectory, double acceleration) {
 	
 	double pathPos = trajectory.back().pathPos;
 	double pathVel = trajectory.back().pathVel;
 	
-	list<pair<double, bool> > switchingPoints = path.getSwitchingPoints();
-	list<pair<double, bool> >::iterator nextDiscontinuity = switchingPoints.begin();
+	const vector<pair<double, bool> > &switchingPoints = path.getSwitchingPoints();
+	vector<pair<double, bool> >::const_iterator nextDiscontinuity = switchingPoints.begin();
 
 	while(true)
 	{
@@ -322,10 +321,12 @@ bool Trajectory::integrateForward(list<TrajectoryStep> &trajectory, double accel
 }
 
 
-void Trajectory::integrateBackward(list<TrajectoryStep> &trajectory, list<TrajectoryStep> &startTrajectory, double acceleration) {
-	list<TrajectoryStep>::reverse_iterator before = startTrajectory.rbegin();
-	double pathPos = trajectory.front().pathPos;
-	double pathVel = trajectory.front().pathVel;
+// reversedTrajectory grows backwards from its end, so its front is at the back of the vector
+void Trajectory::integrateBackward(vector<TrajectoryStep> &reversedTrajectory, vector<TrajectoryStep> &startTrajectory, double acceleration) {
+	// Same as a reverse iterator: the step which it refers to is startTrajectory[before-1]
+	size_t before = startTrajectory.size();
+	double pathPos = reversedTrajectory.back().pathPos;
+	double pathVel = reversedTrajectory.back().pathVel;
 
 	while(true)
 	{
@@ -333,7 +334,7 @@ void Trajectory::integrateBackward(list<TrajectoryStep> &trajectory, list<Trajec
 		pathVel -= timeStep * acceleration;
 		pathPos -= timeStep * 0.5 * (oldPathVel + pathVel);
 
-		trajectory.push_front(TrajectoryStep(pathPos, pathVel));
+		reversedTrajectory.push_back(TrajectoryStep(pathPos, pathVel));
 		acceleration = getMinMaxPathAcceleration(pathPos, pathVel, false);
 
 		if(pathVel < 0.0 || pathPos < 0.0) {
@@ -342,31 +343,32 @@ void Trajectory::integrateBackward(list<TrajectoryStep> &trajectory, list<Trajec
 			return;
 		}
 
-		while(before != startTrajectory.rend() && before->pathPos > pathPos) {
-			before++;
+		while(before != 0 && startTrajectory[before-1].pathPos > pathPos) {
+			before--;
 		}
 
-		if(before != startTrajectory.rbegin() && pathVel >= before->pathVel + getSlope(before.base()) * (pathPos - before->pathPos)) {
-			TrajectoryStep overshoot = trajectory.front();
-			trajectory.pop_front();
-			list<TrajectoryStep>::iterator after = before.base();
-			TrajectoryStep intersection = getIntersection(startTrajectory, after, overshoot, trajectory.front());
+		if(before != startTrajectory.size() && pathVel >= startTrajectory[before-1].pathVel + getSlope(startTrajectory, before) * (pathPos - startTrajectory[before-1].pathPos)) {
+			TrajectoryStep overshoot = reversedTrajectory.back();
+			reversedTrajectory.pop_back();
+			size_t after = before;
+			TrajectoryStep intersection = getIntersection(startTrajectory, after, overshoot, reversedTrajectory.back());
 		
-			if(after != startTrajectory.end()) {
-				startTrajectory.erase(after, startTrajectory.end());
+			if(after != startTrajectory.size()) {
+				startTrajectory.erase(startTrajectory.begin() + after, startTrajectory.end());
 				startTrajectory.push_back(intersection);
 			}
-			startTrajectory.splice(startTrajectory.end(), trajectory);
+			startTrajectory.insert(startTrajectory.end(), reversedTrajectory.rbegin(), reversedTrajectory.rend());
+			reversedTrajectory.clear();
 
 			return;
 		}
 		else if(pathVel > getAccelerationMaxPathVelocity(pathPos) + eps || pathVel > getVelocityMaxPathVelocity(pathPos) + eps) {
 			// find more accurate intersection with max-velocity curve using bisection
-			TrajectoryStep overshoot = trajectory.front();
-			trajectory.pop_front();
-			double slope = getSlope(overshoot, trajectory.front());
+			TrajectoryStep overshoot = reversedTrajectory.back();
+			reversedTrajectory.pop_back();
+			double slope = getSlope(overshoot, reversedTrajectory.back());
 			double before = overshoot.pathPos;
-			double after = trajectory.front().pathPos;
+			double after = reversedTrajectory.back().pathPos;
 			while(after - before > 0.00001) {
 				const double midpoint = 0.5 * (before + after);
 				double midpointPathVel = overshoot.pathVel + slope * (midpoint - overshoot.pathPos);
@@ -376,22 +378,22 @@ void Trajectory::integrateBackward(list<TrajectoryStep> &trajectory, list<Trajec
 				else
 					after = midpoint;
 			}
-			trajectory.push_front(TrajectoryStep(after, overshoot.pathVel + slope * (after - overshoot.pathPos)));
+			reversedTrajectory.push_back(TrajectoryStep(after, overshoot.pathVel + slope * (after - overshoot.pathPos)));
 
 			if(getAccelerationMaxPathVelocity(before) < getVelocityMaxPathVelocity(before)) {
-				if(trajectory.front().pathVel > getAccelerationMaxPathVelocity(before) + 0.0001) {
+				if(reversedTrajectory.back().pathVel > getAccelerationMaxPathVelocity(before) + 0.0001) {
 					cout << "error" << endl;
 					valid = false;
 					return;
 				}
-				else if(getMinMaxPhaseSlope(trajectory.front().pathPos, trajectory.front().pathVel, false) < getAccelerationMaxPathVelocityDeriv(trajectory.front().pathPos)) { 
+				else if(getMinMaxPhaseSlope(reversedTrajectory.back().pathPos, reversedTrajectory.back().pathVel, false) < getAccelerationMaxPathVelocityDeriv(reversedTrajectory.back().pathPos)) { 
 					cout << "error" << endl;
 					valid = false;
 					return;
 				}
 			}
 			else {
-				if(getMinMaxPhaseSlope(trajectory.back().pathPos, trajectory.back().pathVel, false) < getVelocityMaxPathVelocityDeriv(trajectory.back().pathPos)) {
+				if(getMinMaxPhaseSlope(reversedTrajectory.front().pathPos, reversedTrajectory.front().pathVel, false) < getVelocityMaxPathVelocityDeriv(reversedTrajectory.front().pathPos)) {
 					cout << "error" << endl;
 					valid = false;
 					return;
@@ -406,32 +408,30 @@ inline double Trajectory::getSlope(const TrajectoryStep &point1, const Trajector
 	return (point2.pathVel - point1.pathVel) / (point2.pathPos - point1.pathPos);
 }
 
-inline double Trajectory::getSlope(list<TrajectoryStep>::const_iterator lineEnd) {
-	list<TrajectoryStep>::const_iterator lineStart = lineEnd;
-	lineStart--;
-	return getSlope(*lineStart, *lineEnd);
+inline double Trajectory::getSlope(const vector<TrajectoryStep> &trajectory, size_t lineEnd) {
+	return getSlope(trajectory[lineEnd-1], trajectory[lineEnd]);
 }
 
-Trajectory::TrajectoryStep Trajectory::getIntersection(const list<TrajectoryStep> &trajectory, list<TrajectoryStep>::iterator &it, const TrajectoryStep &linePoint1, const TrajectoryStep &linePoint2) {
+Trajectory::TrajectoryStep Trajectory::getIntersection(const vector<TrajectoryStep> &trajectory, size_t &it, const TrajectoryStep &linePoint1, const TrajectoryStep &linePoint2) {
 	
 	const double lineSlope = getSlope(linePoint1, linePoint2);
-	it--;
 
 	double factor = 1.0;
-	if(it->pathVel > linePoint1.pathVel + lineSlope * (it->pathPos - linePoint1.pathPos))
+	const TrajectoryStep &previous = trajectory[it-1];
+	if(previous.pathVel > linePoint1.pathVel + lineSlope * (previous.pathPos - linePoint1.pathPos))
 		factor = -1.0;
-	it++;
 	
-	while(it != trajectory.end() && factor * it->pathVel < factor * (linePoint1.pathVel + lineSlope * (it->pathPos - linePoint1.pathPos))) {
+	while(it != trajectory.size() && factor * trajectory[it].pathVel < factor * (linePoint1.pathVel + lineSlope * (trajectory[it].pathPos - linePoint1.pathPos))) {
 		it++;
 	}
 
-	if(it == trajectory.end()) {
+	if(it == trajectory.size()) {
 		return TrajectoryStep(0.0, 0.0);
 	}
 	else {
-		const double trajectorySlope = getSlope(it);
-		const double intersectionPathPos = (it->pathVel - linePoint1.pathVel + lineSlope * linePoint1.pathPos - trajectorySlope * it->pathPos)
+		const TrajectoryStep &step = trajectory[it];
+		const double trajectorySlope = getSlope(trajectory, it);
+		const double intersectionPathPos = (step.pathVel - linePoint1.pathVel + lineSlope * linePoint1.pathPos - trajectorySlope * step.pathPos)
 			/ (lineSlope - trajectorySlope);
 		const double intersectionPathVel = linePoint1.pathVel + lineSlope * (intersectionPathPos - linePoint1.pathPos);
 		return TrajectoryStep(intersectionPathPos, intersectionPathVel);
@@ -518,24 +518,46 @@ double Trajectory::getDuration() const {
 	return trajectory.back().time;
 }
 
-list<Trajectory::TrajectoryStep>::const_iterator Trajectory::getTrajectorySegment(double time) const {
+bool Trajectory::stepAfter(double time, const TrajectoryStep &step) {
+	return time < step.time;
+}
+
+// The first step after time. Lookups which move forward from the hint continue on from it, and
+// anything else is a binary search.
+size_t Trajectory::findTrajectorySegment(double time, size_t hint) const {
+	if(time >= trajectory.back().time) {
+		return trajectory.size()-1;
+	}
+
+	if(hint == 0 || hint >= trajectory.size() || time < trajectory[hint-1].time) {
+		hint = upper_bound(trajectory.begin(), trajectory.end(), time, stepAfter) - trajectory.begin();
+	}
+	while(time >= trajectory[hint].time) {
+		hint++;
+	}
+	return hint;
+}
+
+size_t Trajectory::getTrajectorySegment(double time) const {
 	if(time >= trajectory.back().time) {
-		list<TrajectoryStep>::const_iterator last = trajectory.end();
-		last--;
-		return last;
+		return trajectory.size()-1;
 	}
 	else {
-		if(time < cachedTime) {
-			cachedTrajectorySegment = trajectory.begin();
-		}
-		while(time >= cachedTrajectorySegment->time) {
-			cachedTrajectorySegment++;
-		}
+		cachedTrajectorySegment = findTrajectorySegment(time, time < cachedTime ? 0 : cachedTrajectorySegment);
 		cachedTime = time;
 		return cachedTrajectorySegment;
 	}
 }
 
+// The path position at time, given the step that getTrajectorySegment(time) found
+double Trajectory::getPathPos(const TrajectoryStep &previous, const TrajectoryStep &step, double time) {
+	double timeStep = step.time - previous.time;
+	const double acceleration = (step.pathPos - previous.pathPos - timeStep * previous.pathVel) / (timeStep * timeStep);
+
+	timeStep = time - previous.time;
+	return previous.pathPos + timeStep * previous.pathVel + timeStep * timeStep * acceleration;
+}
+
 VectorXd Trajectory::getPosition(double time) const {
 
     if(time < 0)
@@ -543,48 +565,40 @@ VectorXd Trajectory::getPosition(double time) const {
     else if(time > getDuration())
         time = getDuration();
 
-	list<TrajectoryStep>::const_iterator it = getTrajectorySegment(time);
-	list<TrajectoryStep>::const_iterator previous = it;
-	previous--;
-	
-	double timeStep = it->time - previous->time;
-	const double acceleration = (it->pathPos - previous->pathPos - timeStep * previous->pathVel) / (timeStep * timeStep);
-
-	timeStep = time - previous->time;
-	const double pathPos = previous->pathPos + timeStep * previous->pathVel + timeStep * timeStep * acceleration; 
-
-	return path.getConfig(pathPos);
+    size_t it = getTrajectorySegment(time);
+    return path.getConfig(getPathPos(trajectory[it-1], trajectory[it], time));
 }
 
 VectorXd Trajectory::getVelocity(double time) const {
-	list<TrajectoryStep>::const_iterator it = getTrajectorySegment(time);
-	list<TrajectoryStep>::const_iterator previous = it;
-	previous--;
+	size_t it = getTrajectorySegment(time);
+	const TrajectoryStep &previous = trajectory[it-1];
+	const TrajectoryStep &step = trajectory[it];
 		
-	double timeStep = it->time - previous->time;
-	const double acceleration = (it->pathPos - previous->pathPos - timeStep * previous->pathVel) / (timeStep * timeStep);
+	double timeStep = step.time - previous.time;
+	const double acceleration = (step.pathPos - previous.pathPos - timeStep * previous.pathVel) / (timeStep * timeStep);
 
-	timeStep = time - previous->time;
-	const double pathPos = previous->pathPos + timeStep * previous->pathVel + timeStep * timeStep * acceleration; 
-	const double pathVel = previous->pathVel + timeStep * acceleration;
+	timeStep = time - previous.time;
+	const double pathPos = previous.pathPos + timeStep * previous.pathVel + timeStep * timeStep * acceleration; 
+	const double pathVel = previous.pathVel + timeStep * acceleration;
 	
 	return path.getTangent(pathPos) * pathVel;
 }
 
 size_t Trajectory::getPathSegmentIndex(double time) const
 {
-    list<TrajectoryStep>::const_iterator it = getTrajectorySegment(time);
-    list<TrajectoryStep>::const_iterator previous = it;
-    previous--;
-
-    double timeStep = it->time - previous->time;
-    const double acceleration = (it->pathPos - previous->pathPos - timeStep * previous->pathVel) / (timeStep * timeStep);
-
-    timeStep = time - previous->time;
-    const double pathPos = previous->pathPos + timeStep * previous->pathVel + timeStep * timeStep * acceleration;
-
-    return path.getPathIndex(pathPos);
+    size_t it = getTrajectorySegment(time);
+    return path.getPathIndex(getPathPos(trajectory[it-1], trajectory[it], time));
 }
 
+void Trajectory::sample(double time, size_t &cursor, VectorXd &position, size_t &pathSegmentIndex) const
+{
+    if(time < 0)
+        time = 0;
+    else if(time > getDuration())
+        time = getDuration();
 
-
+    cursor = findTrajectorySegment(time, cursor);
+    const double pathPos = getPathPos(trajectory[cursor-1], trajectory[cursor], time);
+    path.getConfig(pathPos, position);
+    pathSegmentIndex = path.getPathIndex(pathPos);
+}
@@ -68,6 +68,12 @@ public:
 	Eigen::VectorXd getVelocity(double time) const;
     size_t getPathSegmentIndex(double time) const;
 
+	// Does the job of both getPosition() and getPathSegmentIndex() without using the cached lookup,
+	// so several threads may sample the same trajectory at once. Passing the same cursor (starting
+	// from 0) back in each time makes sampling forward in time cheap. position must already have the
+	// right size.
+	void sample(double time, size_t &cursor, Eigen::VectorXd &position, size_t &pathSegmentIndex) const;
+
 	// Outputs the phase trajectory and the velocity limit curve in 2 files for debugging purposes.
 	void outputPhasePlaneTrajectory() const;
 
@@ -86,8 +92,8 @@ private:
 	bool getNextSwitchingPoint(double pathPos, TrajectoryStep &nextSwitchingPoint, double &beforeAcceleration, double &afterAcceleration);
 	bool getNextAccelerationSwitchingPoint(double pathPos, TrajectoryStep &nextSwitchingPoint, double &beforeAcceleration, double &afterAcceleration);
 	bool getNextVelocitySwitchingPoint(double pathPos, TrajectoryStep &nextSwitchingPoint, double &beforeAcceleration, double &afterAcceleration);
-	bool integrateForward(std::list<TrajectoryStep> &trajectory, double acceleration);
-	void integrateBackward(std::list<TrajectoryStep> &trajectory, std::list<TrajectoryStep> &startTrajectory, double acceleration);
+	bool integrateForward(std::vector<TrajectoryStep> &trajectory, double acceleration);
+	void integrateBackward(std::vector<TrajectoryStep> &reversedTrajectory, std::vector<TrajectoryStep> &startTrajectory, double acceleration);
 	double getMinMaxPathAcceleration(double pathPosition, double pathVelocity, bool max);
 	double getMinMaxPhaseSlope(double pathPosition, double pathVelocity, bool max);
 	double getAccelerationMaxPathVelocity(double pathPos) const;
@@ -95,25 +101,30 @@ private:
 	double getAccelerationMaxPathVelocityDeriv(double pathPos);
 	double getVelocityMaxPathVelocityDeriv(double pathPos);
 	
-	TrajectoryStep getIntersection(const std::list<TrajectoryStep> &trajectory, std::list<TrajectoryStep>::iterator &it, const TrajectoryStep &linePoint1, const TrajectoryStep &linePoint2);
+	TrajectoryStep getIntersection(const std::vector<TrajectoryStep> &trajectory, size_t &it, const TrajectoryStep &linePoint1, const TrajectoryStep &linePoint2);
 	inline double getSlope(const TrajectoryStep &point1, const TrajectoryStep &point2);
-	inline double getSlope(std::list<TrajectoryStep>::const_iterator lineEnd);
+	inline double getSlope(const std::vector<TrajectoryStep> &trajectory, size_t lineEnd);
 	
-	std::list<TrajectoryStep>::const_iterator getTrajectorySegment(double time) const;
+	size_t getTrajectorySegment(double time) const;
+	size_t findTrajectorySegment(double time, size_t hint) const;
+	static bool stepAfter(double time, const TrajectoryStep &step);
+	static double getPathPos(const TrajectoryStep &previous, const TrajectoryStep &step, double time);
 	
 	Path path;
 	Eigen::VectorXd maxVelocity;
 	Eigen::VectorXd maxAcceleration;
 	unsigned int n;
 	bool valid;
-	std::list<TrajectoryStep> trajectory;
-	std::list<TrajectoryStep> endTrajectory; // non-empty only if the trajectory generation failed.
+	std::vector<TrajectoryStep> trajectory;
+	// Integrated backwards from its end, so it is stored back to front.
+	// Non-empty only if the trajectory generation failed.
+	std::vector<TrajectoryStep> endTrajectory;
 
     static const double eps;
     static const double timeStep;
 
 	mutable double cachedTime;
-	mutable std::list<TrajectoryStep>::const_iterator cachedTrajectorySegment;
+	mutable size_t cachedTrajectorySegment;
 };
 
 }
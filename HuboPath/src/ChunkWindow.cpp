@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "HuboPath/ChunkWindow.hpp"
+
+namespace HuboPath {
+
+ChunkWindow::ChunkWindow(uint32_t total_chunks, double retransmit_timeout)
+{
+    _retransmit_timeout = retransmit_timeout;
+    reset(total_chunks);
+}
+
+void ChunkWindow::reset(uint32_t total_chunks)
+{
+    _total_chunks = total_chunks;
+    _acked = 0;
+    _next = 0;
+    _retransmits = 0;
+    _sent_time.assign(total_chunks, 0);
+    _missing.assign(total_chunks, false);
+    _puts.clear();
+    _read = 0;
+}
+
+void ChunkWindow::_put(uint32_t chunk_id, double now)
+{
+    _puts.push_back(chunk_id);
+    _sent_time[chunk_id] = now;
+    _missing[chunk_id] = false;
+}
+
+bool ChunkWindow::next(double now, uint32_t& chunk_id)
+{
+    if( in_flight() >= HUBO_PATH_WINDOW_SIZE )
+        return false;
+
+    for(uint32_t id = _acked; id < _next; ++id)
+    {
+        if(_missing[id])
+        {
+            _put(id, now);
+            ++_retransmits;
+            chunk_id = id;
+            return true;
+        }
+    }
+
+    if( _next < _total_chunks && _next < _acked + HUBO_PATH_WINDOW_SIZE )
+    {
+        chunk_id = _next++;
+        _put(chunk_id, now);
+        return true;
+    }
+
+    return false;
+}
+
+bool ChunkWindow::timed_out(double now, uint32_t& chunk_id)
+{
+    // The window leaves a few frames free, so the oldest chunk can still be resent when it is
+    // full, but the channel itself must never overflow
+    if( _acked >= _next || in_flight()+1 >= HUBO_PATH_INPUT_FRAME_COUNT )
+        return false;
+
+    chunk_id = _acked;
+    _put(chunk_id, now);
+    ++_retransmits;
+    return true;
+}
+
+bool ChunkWindow::acknowledge(const hubo_path_rx_t& feedback, double now)
+{
+    // The receiver reads frames in order, so everything up to the first unread frame which
+    // carries the chunk it last read has left the channel
+    for(size_t p = _read; p < _puts.size(); ++p)
+    {
+        if(_puts[p] == feedback.chunk_id)
+        {
+            _read = p+1;
+            break;
+        }
+    }
+
+    bool progress = false;
+    if( feedback.acked > _acked )
+    {
+        _acked = feedback.acked;
+        progress = true;
+    }
+
+    if( 0 == feedback.received_mask || feedback.acked < _acked )
+        return progress;
+
+    // Everything below the newest received chunk should have arrived by now, so whatever is
+    // still missing there was lost, unless it was only just sent again
+    uint32_t newest = _acked + 64 - __builtin_clzll(feedback.received_mask);
+    for(uint32_t id = _acked; id < newest && id < _next; ++id)
+    {
+        if( id > _acked && ((feedback.received_mask >> (id-_acked-1)) & 0x01) == 1 )
+            continue;
+
+        if( now - _sent_time[id] >= _retransmit_timeout )
+            _missing[id] = true;
+    }
+
+    return progress;
+}
+
+} // namespace HuboPath
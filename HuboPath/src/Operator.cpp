@@ -341,6 +341,11 @@ void Operator::setInterpolationMode(hubo_path_interp_t mode)
     params.interp = mode;
 }
 
+void Operator::setInputFrequency(double frequency)
+{
+    params.frequency = frequency;
+}
+
 bool Operator::interpolate()
 {
     _construct_trajectory();
@@ -412,6 +417,8 @@ void Operator::_outgoing_instruction_state_machine(hubo_path_instruction_t &s)
         case HUBO_PATH_REVERSE:
         case HUBO_PATH_LOAD:
             s = HUBO_PATH_LOAD; break;
+        case HUBO_PATH_BLEND:
+            s = HUBO_PATH_BLEND; break;
         case HUBO_PATH_QUIT:
         default:
             s = HUBO_PATH_QUIT;
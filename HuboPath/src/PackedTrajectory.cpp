@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "HuboPath/PackedTrajectory.hpp"
+
+namespace HuboPath {
+
+PackedTrajectory::PackedTrajectory()
+{
+    clear();
+}
+
+PackedTrajectory::PackedTrajectory(const Trajectory& trajectory)
+{
+    pack(trajectory);
+}
+
+void PackedTrajectory::clear()
+{
+    memset(&_params, 0, sizeof(_params));
+    _incoming_chunks = 0;
+    _incoming_size = 0;
+    _active.clear();
+    _references.clear();
+    _phase_indices.clear();
+}
+
+void PackedTrajectory::swap(PackedTrajectory& other)
+{
+    std::swap(_params, other._params);
+    std::swap(_incoming_chunks, other._incoming_chunks);
+    std::swap(_incoming_size, other._incoming_size);
+    _active.swap(other._active);
+    _references.swap(other._references);
+    _phase_indices.swap(other._phase_indices);
+}
+
+void PackedTrajectory::finish_reading()
+{
+    if(0 == _incoming_size)
+        return;
+
+    _phase_indices.resize(_incoming_size);
+    _references.resize(_incoming_size*joint_count());
+    _incoming_size = 0;
+}
+
+bool PackedTrajectory::operator==(const PackedTrajectory& other) const
+{
+    return memcmp(&_params, &other._params, sizeof(_params)) == 0
+            && _incoming_size == other._incoming_size
+            && _phase_indices == other._phase_indices
+            && _references == other._references;
+}
+
+bool PackedTrajectory::write(std::ostream& stream) const
+{
+    uint64_t count = size();
+    stream.write(reinterpret_cast<const char*>(&_params), sizeof(_params));
+    stream.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    if(count > 0)
+    {
+        stream.write(reinterpret_cast<const char*>(&_phase_indices[0]),
+                     count*sizeof(uint64_t));
+        stream.write(reinterpret_cast<const char*>(&_references[0]),
+                     _references.size()*sizeof(float));
+    }
+
+    return stream.good();
+}
+
+bool PackedTrajectory::read(std::istream& stream)
+{
+    clear();
+
+    hubo_path_params_t params;
+    uint64_t count = 0;
+    stream.read(reinterpret_cast<char*>(&params), sizeof(params));
+    stream.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if(!stream.good())
+        return false;
+
+    _load_params(params);
+    _phase_indices.resize(count);
+    _references.resize(count*joint_count());
+    if(count > 0)
+    {
+        stream.read(reinterpret_cast<char*>(&_phase_indices[0]), count*sizeof(uint64_t));
+        stream.read(reinterpret_cast<char*>(&_references[0]),
+                    _references.size()*sizeof(float));
+    }
+
+    if(!stream.good())
+    {
+        clear();
+        return false;
+    }
+
+    return true;
+}
+
+void PackedTrajectory::_load_params(const hubo_path_params_t& params)
+{
+    _params = params;
+    _active.clear();
+    for(size_t i=0; i<HUBO_PATH_JOINT_MAX_SIZE; ++i)
+    {
+        if( ((_params.bitmap >> i) & 0x01) == 1 )
+        {
+            _active.push_back(i);
+        }
+    }
+}
+
+void PackedTrajectory::pack(const Trajectory& trajectory)
+{
+    clear();
+    _load_params(trajectory.params);
+
+    size_t n = joint_count();
+    _references.resize(trajectory.size()*n);
+    _phase_indices.resize(trajectory.size());
+    for(size_t i=0; i<trajectory.size(); ++i)
+    {
+        const hubo_path_element_t& elem = trajectory[i];
+        for(size_t j=0; j<n; ++j)
+        {
+            _references[i*n+j] = elem.references[_active[j]];
+        }
+        _phase_indices[i] = elem.phase_index;
+    }
+}
+
+void PackedTrajectory::unpack(Trajectory& trajectory) const
+{
+    unpack(trajectory, 0, size());
+}
+
+void PackedTrajectory::unpack(Trajectory& trajectory, size_t begin, size_t end) const
+{
+    trajectory.clear();
+    trajectory.params = _params;
+
+    end = std::min(end, size());
+    if(begin >= end)
+        return;
+
+    hubo_path_element_t elem;
+    memset(&elem, 0, sizeof(elem));
+    trajectory.elements.resize(end-begin, elem);
+    for(size_t i=begin; i<end; ++i)
+    {
+        expand(i, trajectory[i-begin]);
+    }
+}
+
+bool PackedTrajectory::expand(size_t index, hubo_path_element_t& elem) const
+{
+    if(index >= size())
+        return false;
+
+    size_t n = joint_count();
+    const float* references = &_references[index*n];
+    for(size_t j=0; j<n; ++j)
+    {
+        elem.references[_active[j]] = references[j];
+    }
+    elem.phase_index = _phase_indices[index];
+
+    return true;
+}
+
+uint32_t PackedTrajectory::chunk_capacity() const
+{
+    return hubo_path_chunk_capacity(joint_count(), _params.use_custom_limits);
+}
+
+uint32_t PackedTrajectory::chunk_count() const
+{
+    uint32_t capacity = chunk_capacity();
+    return (size() + capacity - 1)/capacity;
+}
+
+size_t PackedTrajectory::write_chunk(uint32_t chunk_id, hubo_path_chunk_t* chunk) const
+{
+    uint32_t total_chunks = chunk_count();
+    if(chunk_id >= total_chunks)
+        return 0;
+
+    clear_hubo_path_chunk(chunk);
+    chunk->frequency = _params.frequency;
+    chunk->interp = _params.interp;
+    chunk->tolerance = _params.tolerance;
+    chunk->bitmap = _params.bitmap;
+    chunk->use_custom_limits = _params.use_custom_limits;
+    chunk->joint_count = joint_count();
+    chunk->chunk_capacity = chunk_capacity();
+    chunk->chunk_id = chunk_id;
+    chunk->total_chunks = total_chunks;
+
+    size_t start = (size_t)(chunk_id)*chunk->chunk_capacity;
+    chunk->chunk_size = std::min<size_t>(chunk->chunk_capacity, size()-start);
+
+    if(chunk->use_custom_limits == 1)
+    {
+        hubo_joint_limits_t* limits = hubo_path_chunk_limits(chunk);
+        for(size_t j=0; j<joint_count(); ++j)
+        {
+            limits[j] = _params.limits[_active[j]];
+        }
+    }
+
+    size_t n = joint_count();
+    for(uint32_t i=0; i<chunk->chunk_size; ++i)
+    {
+        uint8_t* elem = hubo_path_chunk_element(chunk, i);
+        memcpy(elem, &_phase_indices[start+i], sizeof(uint64_t));
+        memcpy(elem+sizeof(uint64_t), &_references[(start+i)*n], n*sizeof(float));
+    }
+
+    return hubo_path_chunk_size(chunk);
+}
+
+HuboCan::error_result_t PackedTrajectory::read_chunk(hubo_path_chunk_t* chunk)
+{
+    if(0 == _incoming_chunks)
+    {
+        hubo_path_params_t params;
+        memset(&params, 0, sizeof(params));
+        params.frequency = chunk->frequency;
+        params.interp = chunk->interp;
+        params.tolerance = chunk->tolerance;
+        params.bitmap = chunk->bitmap;
+        params.use_custom_limits = chunk->use_custom_limits;
+        _load_params(params);
+
+        if(chunk->joint_count != joint_count() || chunk->chunk_capacity != chunk_capacity()
+                || 0 == chunk->total_chunks)
+        {
+            std::cout << "Received a chunk with an inconsistent layout: " << chunk->joint_count
+                      << " joints (bitmap has " << joint_count() << "), capacity of "
+                      << chunk->chunk_capacity << " (expected " << chunk_capacity() << ")"
+                      << std::endl;
+            clear();
+            return HuboCan::ARRAY_MISMATCH;
+        }
+
+        if(_params.use_custom_limits == 1)
+        {
+            const hubo_joint_limits_t* limits = hubo_path_chunk_limits(chunk);
+            for(size_t j=0; j<joint_count(); ++j)
+            {
+                _params.limits[_active[j]] = limits[j];
+            }
+        }
+
+        _incoming_chunks = chunk->total_chunks;
+        size_t max_size = (size_t)(_incoming_chunks)*chunk->chunk_capacity;
+        _references.assign(max_size*joint_count(), 0);
+        _phase_indices.assign(max_size, 0);
+    }
+    else if(chunk->bitmap != _params.bitmap || chunk->total_chunks != _incoming_chunks
+            || chunk->chunk_capacity != chunk_capacity())
+    {
+        std::cout << "Received a chunk which does not belong to the incoming trajectory!"
+                  << std::endl;
+        return HuboCan::ARRAY_MISMATCH;
+    }
+
+    if(chunk->chunk_id < 0 || (uint32_t)(chunk->chunk_id) >= _incoming_chunks
+            || chunk->chunk_size > chunk->chunk_capacity
+            || ((uint32_t)(chunk->chunk_id)+1 < _incoming_chunks
+                && chunk->chunk_size != chunk->chunk_capacity))
+    {
+        std::cout << "Received chunk " << chunk->chunk_id << " of " << _incoming_chunks
+                  << " with a size of " << chunk->chunk_size << std::endl;
+        return HuboCan::INDEX_OUT_OF_BOUNDS;
+    }
+
+    size_t n = joint_count();
+    size_t start = (size_t)(chunk->chunk_id)*chunk->chunk_capacity;
+    for(uint32_t i=0; i<chunk->chunk_size; ++i)
+    {
+        const uint8_t* elem = hubo_path_chunk_element(chunk, i);
+        memcpy(&_phase_indices[start+i], elem, sizeof(uint64_t));
+        memcpy(&_references[(start+i)*n], elem+sizeof(uint64_t), n*sizeof(float));
+    }
+
+    // The final chunk decides where the trajectory ends, but the storage only gets trimmed by
+    // finish_reading(), so that the steps before it can be read while the rest arrives
+    if((uint32_t)(chunk->chunk_id)+1 == _incoming_chunks)
+    {
+        _incoming_size = start+chunk->chunk_size;
+    }
+
+    return HuboCan::OKAY;
+}
+
+} // namespace HuboPath
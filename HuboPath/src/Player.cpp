@@ -51,6 +51,24 @@ Player::Player(HuboCan::HuboDescription& description) :
     _initialize_player();
 }
 
+Player::~Player()
+{
+    _stop_worker();
+
+    if(_pending)
+        _release(_pending);
+
+    if(_outgoing)
+        _release(_outgoing);
+
+    IncomingTrajectory* unclaimed = __atomic_exchange_n(&_incoming, (IncomingTrajectory*)NULL,
+                                                        __ATOMIC_ACQ_REL);
+    if(unclaimed)
+        _release(unclaimed);
+
+    _free_retired();
+}
+
 void Player::_initialize_player()
 {
     _channels_opened = false;
@@ -62,10 +80,31 @@ void Player::_initialize_player()
     memset(&_current_elem, 0, sizeof(_current_elem));
     memset(&_last_elem, 0, sizeof(_last_elem));
     _current_index = 0;
+    _worker_started = false;
+    _worker_active = 0;
+    _request = 0;
+    _incoming = NULL;
+    _retired = NULL;
+    _pending = NULL;
+    _waiting = false;
+    _streaming = false;
+    _load_instruction = HUBO_PATH_PAUSE;
+    _prefix_time = 0;
+    _underrun = HUBO_PATH_UNDERRUN_SLOW;
+    _underrun_reported = false;
+    _slow_phase = false;
+    _blend_into = false;
+    _carry_on = false;
+    _outgoing = NULL;
+    _blend.clear();
+    _max_blend_time = 10;
     open_channels();
     
     if(_desc.okay())
+    {
         _trajectory.desc = _desc;
+        _check_buffer.desc = _desc;
+    }
 }
 
 bool Player::receive_description(double timeout_sec)
@@ -73,7 +112,10 @@ bool Player::receive_description(double timeout_sec)
     bool success = HuboState::State::receive_description(timeout_sec);
 
     if(success)
+    {
         _trajectory.desc = _desc;
+        _check_buffer.desc = _desc;
+    }
 
     return success;
 }
@@ -83,6 +125,7 @@ void Player::load_description(const HuboCan::HuboDescription &description)
     HuboState::State::load_description(description);
 
     _trajectory.desc = _desc;
+    _check_buffer.desc = _desc;
 }
 
 bool Player::open_channels()
@@ -142,7 +185,7 @@ void Player::report_state()
     hubo_player_state_t state;
     state.current_index = _current_index;
     state.current_instruction = _current_cmd.instruction;
-    state.trajectory_size = _trajectory.size();
+    state.trajectory_size = _source().size() + _blend.steps;
     ach_put(&_state_chan, &state, sizeof(state));
 }
 
@@ -167,26 +210,671 @@ void Player::_check_for_instructions()
     }
 }
 
-bool Player::_receive_incoming_trajectory()
+void Player::set_progressive_playback(double prefix_time, hubo_path_underrun_t underrun)
 {
-    report_ach_errors(ach_flush(&_input_chan), "Player::_receive_incoming_trajectory",
-                      "ach_flush", HUBO_PATH_INPUT_CHANNEL);
-    HuboCan::error_result_t result = receive_trajectory(_input_chan, _feedback_chan,
-                                                        _trajectory, 10);
-    if(result != HuboCan::OKAY)
+    _prefix_time = prefix_time > 0 ? prefix_time : 0;
+    _underrun = underrun;
+}
+
+void Player::set_max_blend_time(double max_time)
+{
+    _max_blend_time = max_time > 0 ? max_time : 0;
+}
+
+bool Player::set_trajectory_cache(size_t capacity, const std::string& directory)
+{
+    _cache.set_capacity(capacity);
+    return _cache.set_directory(directory);
+}
+
+double Player::_frequency(const PackedTrajectory& trajectory) const
+{
+    double frequency = _desc.okay() ? _desc.params.frequency : trajectory.params().frequency;
+    if( frequency <= 0 )
+        frequency = 200;
+
+    return frequency;
+}
+
+size_t Player::_prefix_steps(const PackedTrajectory& trajectory) const
+{
+    return std::max<size_t>(1, (size_t)ceil(_prefix_time*_frequency(trajectory)));
+}
+
+IncomingTrajectory::IncomingTrajectory(unsigned int request_id)
+{
+    memset(&first, 0, sizeof(first));
+    request = request_id;
+    status = INCOMING_ARRIVING;
+    validated = 0;
+    holders = 1;
+    next_retired = NULL;
+}
+
+PathBlend::PathBlend()
+{
+    clear();
+}
+
+void PathBlend::clear()
+{
+    steps = 0;
+    frequency = 0;
+    phase_index = 0;
+    tolerance = 0;
+    joint_count = 0;
+}
+
+// Position of a cubic Hermite segment at s in [0,1], where the velocities are per second
+static inline double hermite(double p0, double v0, double p1, double v1,
+                             double duration, double s)
+{
+    double s2 = s*s;
+    double s3 = s2*s;
+    return (2*s3 - 3*s2 + 1)*p0 + (s3 - 2*s2 + s)*duration*v0
+            + (3*s2 - 2*s3)*p1 + (s3 - s2)*duration*v1;
+}
+
+bool PathBlend::fits(double duration) const
+{
+    for(size_t k=0; k<joint_count; ++k)
+    {
+        if(!fits_joint(k, duration))
+            return false;
+    }
+
+    return true;
+}
+
+bool PathBlend::fits_joint(size_t k, double duration) const
+{
+    const hubo_joint_limits_t& limit = limits[k];
+    double v0 = start_velocity[k];
+    double v1 = end_velocity[k];
+    double mean = (end[k] - start[k])/duration;
+
+    // The acceleration of a cubic changes linearly, so it is largest at one of the ends
+    double a0 = (6*mean - 4*v0 - 2*v1)/duration;
+    double a1 = (-6*mean + 2*v0 + 4*v1)/duration;
+    if( fabs(a0) > limit.max_accel || fabs(a1) > limit.max_accel )
+        return false;
+
+    // The velocity is A*s^2 + B*s + v0, so it peaks either at an end or at its vertex.
+    // The ends are given, so only the vertex needs checking.
+    double A = -6*mean + 3*v0 + 3*v1;
+    double B = 6*mean - 4*v0 - 2*v1;
+    if( A != 0 )
+    {
+        double s = -B/(2*A);
+        if( 0 < s && s < 1 && fabs((A*s + B)*s + v0) > limit.max_speed )
+            return false;
+    }
+
+    // The position can only overshoot where the velocity passes through zero
+    double roots[2];
+    size_t root_count = 0;
+    if( A == 0 )
+    {
+        if( B != 0 )
+            roots[root_count++] = -v0/B;
+    }
+    else
     {
+        double discriminant = B*B - 4*A*v0;
+        if( discriminant >= 0 )
+        {
+            roots[root_count++] = (-B + sqrt(discriminant))/(2*A);
+            roots[root_count++] = (-B - sqrt(discriminant))/(2*A);
+        }
+    }
+
+    for(size_t r=0; r<root_count; ++r)
+    {
+        if( roots[r] <= 0 || roots[r] >= 1 )
+            continue;
+
+        double p = hermite(start[k], v0, end[k], v1, duration, roots[r]);
+        if( p < limit.min_position - tolerance || limit.max_position + tolerance < p )
+            return false;
+    }
+
+    return true;
+}
+
+bool PathBlend::plan(double rate, double max_duration)
+{
+    frequency = rate;
+    steps = 0;
+
+    // No blend can be quicker than covering the distance at top speed, or than changing the
+    // velocity at full acceleration
+    double shortest = 0;
+    for(size_t k=0; k<joint_count; ++k)
+    {
+        shortest = std::max(shortest, fabs(end[k] - start[k])/limits[k].max_speed);
+        shortest = std::max(shortest, fabs(end_velocity[k] - start_velocity[k])
+                                            /limits[k].max_accel);
+    }
+
+    if( !(shortest <= max_duration) )
         return false;
+
+    // Whether a blend fits does not always improve with its length (a longer blend also
+    // carries the starting velocity further), so every length gets tried, shortest first.
+    // Consecutive lengths tend to be ruled out by the same joint, so the joint which ruled out
+    // the last one gets checked first, and most lengths cost a single joint.
+    size_t longest = (size_t)ceil(max_duration*frequency);
+    size_t blocking = 0;
+    for(size_t n = std::max<size_t>(1, (size_t)floor(shortest*frequency)); n <= longest; ++n)
+    {
+        double duration = n/frequency;
+        if( blocking < joint_count && !fits_joint(blocking, duration) )
+            continue;
+
+        bool fit = true;
+        for(size_t k=0; k<joint_count; ++k)
+        {
+            if( k != blocking && !fits_joint(k, duration) )
+            {
+                blocking = k;
+                fit = false;
+                break;
+            }
+        }
+
+        if(fit)
+        {
+            steps = n;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void PathBlend::expand(size_t index, hubo_path_element_t& elem) const
+{
+    double duration = steps > 0 ? steps/frequency : 0;
+    double s = steps > 0 ? std::min<double>(1, (double)index/steps) : 1;
+    for(size_t k=0; k<joint_count; ++k)
+    {
+        elem.references[joints[k]] = hermite(start[k], start_velocity[k],
+                                              end[k], end_velocity[k], duration, s);
+    }
+    elem.phase_index = phase_index;
+}
+
+// The lowest bit of a request marks it as canceled; the rest counts the load requests
+static const unsigned int request_canceled = 0x01;
+static const unsigned int request_step = 0x02;
+
+// How long the worker naps while it has nothing to receive
+static const long worker_idle_nsec = 10000000L;
+
+// How long the worker waits for each batch of chunks
+static const double worker_poll_time = 0.01;
+
+void Player::_release(IncomingTrajectory* incoming)
+{
+    if(__atomic_sub_fetch(&incoming->holders, 1, __ATOMIC_ACQ_REL) > 0)
+        return;
+
+    IncomingTrajectory* head = __atomic_load_n(&_retired, __ATOMIC_RELAXED);
+    do {
+        incoming->next_retired = head;
+    } while(!__atomic_compare_exchange_n(&_retired, &head, incoming, true,
+                                         __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+void Player::_free_retired()
+{
+    IncomingTrajectory* retired = __atomic_exchange_n(&_retired, (IncomingTrajectory*)NULL,
+                                                      __ATOMIC_ACQUIRE);
+    while(retired)
+    {
+        IncomingTrajectory* next = retired->next_retired;
+        delete retired;
+        retired = next;
+    }
+}
+
+void Player::_publish(IncomingTrajectory* incoming)
+{
+    __atomic_add_fetch(&incoming->holders, 1, __ATOMIC_RELAXED);
+    IncomingTrajectory* unclaimed = __atomic_exchange_n(&_incoming, incoming, __ATOMIC_ACQ_REL);
+
+    // The real-time loop never picked this one up, so let go of it on its behalf
+    if(unclaimed)
+        _release(unclaimed);
+}
+
+bool Player::_start_worker()
+{
+    if(_worker_started)
+        return true;
+
+    __atomic_store_n(&_worker_active, 1, __ATOMIC_RELEASE);
+    int result = pthread_create(&_worker, NULL, &Player::_worker_thread, this);
+    if(result != 0)
+    {
+        std::cerr << "Unable to create the trajectory worker thread, code=" << result << " ("
+                  << strerror(result) << ")" << std::endl;
+        __atomic_store_n(&_worker_active, 0, __ATOMIC_RELEASE);
+        return false;
+    }
+
+    _worker_started = true;
+    return true;
+}
+
+void Player::_stop_worker()
+{
+    if(!_worker_started)
+        return;
+
+    __atomic_store_n(&_worker_active, 0, __ATOMIC_RELEASE);
+    pthread_join(_worker, NULL);
+    _worker_started = false;
+}
+
+void* Player::_worker_thread(void* player)
+{
+    static_cast<Player*>(player)->_worker_loop();
+    return NULL;
+}
+
+void Player::_worker_loop()
+{
+    unsigned int handled = 0;
+    IncomingTrajectory* current = NULL;
+    bool published = false;
+    size_t validated = 0;
+
+    while(__atomic_load_n(&_worker_active, __ATOMIC_ACQUIRE) == 1)
+    {
+        _free_retired();
+
+        unsigned int request = __atomic_load_n(&_request, __ATOMIC_ACQUIRE);
+        if(request != handled)
+        {
+            handled = request;
+            if(current)
+            {
+                // The real-time loop has already let go of anything that was published
+                _receiver.cancel();
+                __atomic_store_n(&current->status, INCOMING_FAILED, __ATOMIC_RELEASE);
+                _release(current);
+                current = NULL;
+            }
+
+            if( (request & request_canceled) == 0 )
+            {
+                current = new IncomingTrajectory(request);
+                published = false;
+                validated = 0;
+                report_ach_errors(ach_flush(&_input_chan), "Player::_worker_loop",
+                                  "ach_flush", HUBO_PATH_INPUT_CHANNEL);
+                _receiver.begin(_input_chan, _feedback_chan, 10, &current->trajectory);
+            }
+        }
+
+        if(NULL == current)
+        {
+            struct timespec nap;
+            nap.tv_sec = 0;
+            nap.tv_nsec = worker_idle_nsec;
+            nanosleep(&nap, NULL);
+            continue;
+        }
+
+        hubo_path_rx_state_t rx_state = _receiver.poll(worker_poll_time);
+        PackedTrajectory& incoming = current->trajectory;
+        bool okay = true;
+
+        if( PATH_RX_READ_READY == rx_state || PATH_RX_LISTENING == rx_state )
+        {
+            size_t available = _receiver.available();
+            if(published)
+            {
+                okay = _validate_stream(*current, validated, available);
+            }
+            else if( _prefix_time > 0 && incoming.size() > 0
+                     && HUBO_PATH_RAW == incoming.params().interp
+                     && available >= _prefix_steps(incoming) )
+            {
+                incoming.expand(0, current->first);
+                okay = _validate_stream(*current, validated, available);
+                if(okay)
+                {
+                    std::cout << "Starting playback with " << available << " of up to "
+                              << incoming.size() << " steps received" << std::endl;
+                    _publish(current);
+                    published = true;
+                }
+            }
+
+            if(okay)
+                continue;
+
+            _receiver.cancel();
+        }
+        else if( PATH_RX_FINISHED == rx_state )
+        {
+            if(published)
+            {
+                // The real-time loop trims the trajectory once it sees that it is ready
+                size_t end = incoming.incoming_size();
+                okay = _validate_stream(*current, validated, end);
+                if(okay)
+                {
+                    std::cout << "Finished streaming in the trajectory (" << end << " steps)"
+                              << std::endl;
+                    __atomic_store_n(&current->status, INCOMING_READY, __ATOMIC_RELEASE);
+                }
+            }
+            else
+            {
+                incoming.finish_reading();
+                okay = _prepare_trajectory(*current);
+                if(okay)
+                    current->status = INCOMING_READY;
+            }
+        }
+        else
+        {
+            okay = false;
+        }
+
+        if(!okay)
+            __atomic_store_n(&current->status, INCOMING_FAILED, __ATOMIC_RELEASE);
+
+        // Failures get published too, so that the real-time loop knows to quit
+        if(!published)
+            _publish(current);
+
+        _release(current);
+        current = NULL;
+    }
+
+    if(current)
+    {
+        _receiver.cancel();
+        __atomic_store_n(&current->status, INCOMING_FAILED, __ATOMIC_RELEASE);
+        _release(current);
+    }
+}
+
+bool Player::_prepare_trajectory(IncomingTrajectory& incoming)
+{
+    incoming.trajectory.unpack(_trajectory);
+    if(_trajectory.size() == 0)
+    {
+        std::cout << "Received an empty trajectory -- we will ignore it!" << std::endl;
+        return false;
+    }
+
+    // The starting values get checked by the real-time loop, since that is where the current
+    // references live
+    incoming.first = _trajectory.elements[0];
+
+    if( _cache.signature(_trajectory, _signature)
+            && _cache.fetch(_signature, incoming.trajectory) )
+    {
+        std::cout << "Found the trajectory in the cache (" << incoming.trajectory.size()
+                  << " steps)" << std::endl;
+        std::vector<hubo_path_element_t>().swap(_trajectory.elements);
+        return true;
     }
 
+    if(!_trajectory.interpolate())
+    {
+        std::cout << "Failed to interpolate the trajectory with the following params: "
+                  << _trajectory.params << std::endl;
+        return false;
+    }
+
+    if(!_trajectory.check_limits())
+    {
+        std::cerr << "The trajectory was outside of its limits -- we will ignore it!" << std::endl;
+        return false;
+    }
+
+    incoming.trajectory.pack(_trajectory);
+    std::vector<hubo_path_element_t>().swap(_trajectory.elements);
+    _cache.store(_signature, incoming.trajectory);
+    return true;
+}
+
+bool Player::_validate_stream(IncomingTrajectory& incoming, size_t& validated, size_t end)
+{
+    if( end <= validated )
+        return true;
+
+    // Back up two steps, so that the speed and acceleration across the seam get checked too
+    size_t begin = validated >= 2 ? validated-2 : 0;
+    incoming.trajectory.unpack(_check_buffer, begin, end);
+    if(!_check_buffer.check_limits())
+    {
+        std::cerr << "Steps " << begin << " to " << end << " of the incoming trajectory were "
+                  << "outside of its limits -- we will stop playing it!" << std::endl;
+        return false;
+    }
+
+    validated = end;
+    __atomic_store_n(&incoming.validated, validated, __ATOMIC_RELEASE);
+    return true;
+}
+
+void Player::_request_trajectory(hubo_path_instruction_t instruction, bool blend)
+{
+    if(blend)
+        _keep_playing();
+    else
+        _cancel_request();
+
+    if(!_start_worker())
+    {
+        _fail_request();
+        return;
+    }
+
+    _load_instruction = instruction;
+    _blend_into = blend;
+    _waiting = true;
+    __atomic_store_n(&_request, (_request & ~request_canceled) + request_step,
+                     __ATOMIC_RELEASE);
+}
+
+void Player::_keep_playing()
+{
+    bool playing = HUBO_PATH_QUIT != _current_cmd.instruction && (!_waiting || _carry_on)
+                    && !_new_trajectory && _available() > 0;
+    if(!playing)
+    {
+        // There is nothing to carry on with, so this is just like a regular load
+        _cancel_request();
+        return;
+    }
+
+    if(_streaming)
+    {
+        // The worker is about to stop receiving it, so play only what has been checked so far
+        if(_outgoing)
+            _release(_outgoing);
+        _outgoing = _pending;
+        _pending = NULL;
+        _streaming = false;
+    }
+    else if(_pending)
+    {
+        _release(_pending);
+        _pending = NULL;
+    }
+
+    _carry_on = true;
+
+    // The instruction which asked for the blend would otherwise stop the playback
+    _incoming_cmd.instruction = _current_cmd.instruction;
+}
+
+void Player::_cancel_request()
+{
+    if(_waiting || _streaming)
+        __atomic_store_n(&_request, _request | request_canceled, __ATOMIC_RELEASE);
+
+    if(_pending)
+    {
+        _release(_pending);
+        _pending = NULL;
+    }
+
+    if(_outgoing)
+    {
+        _release(_outgoing);
+        _outgoing = NULL;
+    }
+
+    _waiting = false;
+    _streaming = false;
+    _blend_into = false;
+    _carry_on = false;
+    _blend.clear();
+    _playback.clear();
+}
+
+void Player::_fail_request()
+{
+    _cancel_request();
+    _current_cmd.instruction = HUBO_PATH_QUIT;
+    _incoming_cmd.instruction = HUBO_PATH_QUIT;
+}
+
+void Player::_abandon_blend()
+{
+    std::cout << "Carrying on with the current trajectory instead" << std::endl;
+
+    // Make sure the worker stops on the new trajectory, in case it is still arriving
+    __atomic_store_n(&_request, _request | request_canceled, __ATOMIC_RELEASE);
+
+    if(_pending)
+    {
+        _release(_pending);
+        _pending = NULL;
+    }
+
+    _waiting = false;
+    _blend_into = false;
+    _carry_on = false;
+}
+
+void Player::_take_incoming()
+{
+    IncomingTrajectory* incoming = __atomic_exchange_n(&_incoming, (IncomingTrajectory*)NULL,
+                                                       __ATOMIC_ACQ_REL);
+    if(incoming)
+    {
+        if(_waiting && NULL == _pending && incoming->request == _request)
+            _pending = incoming;
+        else
+            _release(incoming); // Left over from a request that has since been replaced
+    }
+
+    if(NULL == _pending)
+        return;
+
+    int status = __atomic_load_n(&_pending->status, __ATOMIC_ACQUIRE);
+    if(INCOMING_FAILED == status)
+    {
+        if(_carry_on)
+            _abandon_blend();
+        else
+            _fail_request();
+        return;
+    }
+
+    if(_waiting)
+    {
+        const PackedTrajectory& next = _pending->trajectory;
+        if(_blend_into)
+        {
+            size_t available = next.size();
+            if(INCOMING_ARRIVING == status)
+                available = __atomic_load_n(&_pending->validated, __ATOMIC_ACQUIRE);
+            else if(next.incoming_size() > 0)
+                available = next.incoming_size(); // Streamed in, but not trimmed yet
+            if(!_plan_blend(next, available))
+            {
+                if(_carry_on)
+                    _abandon_blend();
+                else
+                    _fail_request();
+                return;
+            }
+
+            for(size_t i=0; i<_desc.joints.size(); ++i)
+            {
+                if( ((next.params().bitmap >> i) & 0x01) == 0x01 )
+                    claim_joint(i);
+            }
+        }
+        else
+        {
+            if(!_check_start_values(_pending->first, next.params().bitmap))
+            {
+                _fail_request();
+                return;
+            }
+
+            _blend.clear();
+        }
+
+        // Whatever was playing until now is done with
+        if(_outgoing)
+        {
+            _release(_outgoing);
+            _outgoing = NULL;
+        }
+        _blend_into = false;
+        _carry_on = false;
+
+        send_commands();
+        _waiting = false;
+        _current_index = 0;
+        _new_trajectory = true;
+        _current_cmd.instruction = _load_instruction;
+        _incoming_cmd.instruction = _load_instruction;
+
+        if(INCOMING_ARRIVING == status)
+        {
+            _streaming = true;
+            return;
+        }
+    }
+
+    if(INCOMING_READY == status)
+    {
+        // The worker is done with it, so trimming the storage is safe now. This only shrinks
+        // the vectors, so nothing gets freed here.
+        _pending->trajectory.finish_reading();
+        _playback.swap(_pending->trajectory);
+        _release(_pending);
+        _pending = NULL;
+        _streaming = false;
+    }
+}
+
+bool Player::_check_start_values(const hubo_path_element_t& first, uint64_t bitmap)
+{
     // TODO: Should the trajectory be passed through the controller before evaluating the refs?
     // Almost certainly.
 
     std::vector<size_t> invalid_joints;
     for(size_t i=0; i<_desc.joints.size(); ++i)
     {
-        if( ((_trajectory.params.bitmap >> i) & 0x01) == 0x01 )
+        if( ((bitmap >> i) & 0x01) == 0x01 )
         {
-            if(_trajectory.elements[0].references[i] != joints[i].reference)
+            // References travel as floats, which is also all the precision a command has
+            if((float)first.references[i] != (float)joints[i].reference)
             {
                 invalid_joints.push_back(i);
             }
@@ -197,7 +885,7 @@ bool Player::_receive_incoming_trajectory()
     {
         for(size_t i=0; i<_desc.joints.size(); ++i)
         {
-            if( ((_trajectory.params.bitmap >> i) & 0x01) == 0x01 )
+            if( ((bitmap >> i) & 0x01) == 0x01 )
             {
                 claim_joint(i);
             }
@@ -210,7 +898,7 @@ bool Player::_receive_incoming_trajectory()
         {
             size_t invalid = invalid_joints[i];
             std::cout << _desc.getJointName(invalid) << " ("
-                      << _trajectory.elements[0].references[invalid]
+                      << first.references[invalid]
                       << ":" << joints[invalid].reference << ")";
             if(i+1 < invalid_joints.size())
                 std::cout << ", ";
@@ -218,28 +906,115 @@ bool Player::_receive_incoming_trajectory()
         std::cout << std::endl;
         return false;
     }
-    
-    if(!_trajectory.interpolate())
+
+    return true;
+}
+
+bool Player::_plan_blend(const PackedTrajectory& next, size_t available)
+{
+    const hubo_path_params_t& params = next.params();
+    if(!_desc.okay() && params.use_custom_limits != 1)
     {
-        std::cout << "Failed to interpolate the trajectory with the following params: "
-                  << _trajectory.params << std::endl;
+        std::cout << "Cannot blend into the new trajectory without knowing its joint limits!"
+                  << std::endl;
         return false;
     }
-    
-    if(!_trajectory.check_limits())
+
+    double frequency = _frequency(next);
+    uint64_t moving = _carry_on ? _source().params().bitmap : 0;
+
+    // Joints which only the current trajectory drives stop getting commanded once the new one
+    // starts, so they would freeze wherever the switch catches them
+    bool dropping_motion = false;
+    for(size_t i=0; i<_desc.joints.size(); ++i)
     {
-        std::cerr << "The trajectory was outside of its limits -- we will ignore it!" << std::endl;
+        if( ((moving >> i) & 0x01) == 0 || ((params.bitmap >> i) & 0x01) == 0x01 )
+            continue;
+
+        if((float)_current_elem.references[i] == (float)_last_elem.references[i])
+            continue;
+
+        if(!dropping_motion)
+            std::cerr << "Cannot blend into a trajectory which leaves out these moving joints: ";
+        else
+            std::cerr << ", ";
+        std::cerr << _desc.getJointName(i);
+        dropping_motion = true;
+    }
+
+    if(dropping_motion)
+    {
+        std::cerr << std::endl;
         return false;
     }
 
-    send_commands();
-    _current_index = 0;
+    hubo_path_element_t first;
+    hubo_path_element_t second;
+    memset(&first, 0, sizeof(first));
+    memset(&second, 0, sizeof(second));
+    next.expand(0, first);
+    bool has_second = available >= 2 && next.expand(1, second);
+
+    PathBlend blend;
+    blend.phase_index = first.phase_index;
+    blend.tolerance = params.tolerance;
+    for(size_t i=0; i<_desc.joints.size(); ++i)
+    {
+        if( ((params.bitmap >> i) & 0x01) == 0 )
+            continue;
 
-//    std::cout << _trajectory << std::endl;
-    _new_trajectory = true;
+        // Joints which the current trajectory was moving keep their velocity, while any
+        // others start from rest at their current reference
+        size_t k = blend.joint_count++;
+        bool was_moving = ((moving >> i) & 0x01) == 0x01;
+        blend.joints[k] = i;
+        blend.start[k] = was_moving ? _current_elem.references[i] : joints[i].reference;
+        blend.start_velocity[k] = was_moving ?
+                (_current_elem.references[i] - _last_elem.references[i])*frequency : 0;
+        blend.end[k] = first.references[i];
+        blend.end_velocity[k] = has_second ?
+                (second.references[i] - first.references[i])*frequency : 0;
+        blend.limits[k] = params.use_custom_limits == 1 ?
+                params.limits[i] : _desc.joints[i]->info.limits;
+    }
+
+    if(!blend.plan(frequency, _max_blend_time))
+    {
+        std::cerr << "Could not find a blend into the new trajectory which stays within the "
+                  << "joint limits!" << std::endl;
+        return false;
+    }
+
+    _blend = blend;
+    std::cout << "Blending into the new trajectory over " << _blend.steps << " steps ("
+              << _blend.steps/frequency << "s)" << std::endl;
     return true;
 }
 
+int Player::_available() const
+{
+    size_t available = 0;
+    if(_streaming)
+        available = __atomic_load_n(&_pending->validated, __ATOMIC_ACQUIRE);
+    else if(_outgoing)
+        available = __atomic_load_n(&_outgoing->validated, __ATOMIC_ACQUIRE);
+    else
+        available = _playback.size();
+
+    if(available == 0)
+        return 0;
+
+    return (int)(_blend.steps + available);
+}
+
+void Player::_expand_step(int index, hubo_path_element_t& elem) const
+{
+    if( (size_t)index < _blend.steps )
+        _blend.expand(index, elem);
+    else
+        _source().expand(index - _blend.steps, elem);
+}
+
 bool Player::step()
 {
     HuboCan::error_result_t update_result = update();
@@ -268,56 +1043,41 @@ bool Player::step()
         std::cout << "Received new instruction: " << _incoming_cmd.instruction << std::endl;
     }
 
-    if( HUBO_PATH_LOAD == _incoming_cmd.instruction
-            || HUBO_PATH_LOAD_N_GO == _incoming_cmd.instruction )
+    if( (HUBO_PATH_LOAD == _incoming_cmd.instruction
+            || HUBO_PATH_LOAD_N_GO == _incoming_cmd.instruction
+            || HUBO_PATH_BLEND == _incoming_cmd.instruction) && _new_instruction )
     {
-        if( _new_instruction )
-        {
-            if(_receive_incoming_trajectory())
-            {
-                if(HUBO_PATH_LOAD_N_GO == _incoming_cmd.instruction)
-                {
-                    _current_cmd.instruction = HUBO_PATH_RUN;
-                    _incoming_cmd.instruction = HUBO_PATH_RUN;
-                }
-                else
-                {
-                    _current_cmd.instruction = HUBO_PATH_PAUSE;
-                    _incoming_cmd.instruction = HUBO_PATH_PAUSE;
-                }
-            }
-            else
-            {
-                _trajectory.clear();
-                _current_cmd.instruction = HUBO_PATH_QUIT;
-                _incoming_cmd.instruction = HUBO_PATH_QUIT;
-            }
-        }
-        return true;
+        _request_trajectory(HUBO_PATH_LOAD == _incoming_cmd.instruction ?
+                                HUBO_PATH_PAUSE : HUBO_PATH_RUN,
+                            HUBO_PATH_BLEND == _incoming_cmd.instruction);
     }
 
     if( HUBO_PATH_QUIT == _incoming_cmd.instruction
-            && HUBO_PATH_QUIT != _current_cmd.instruction )
+            && (HUBO_PATH_QUIT != _current_cmd.instruction || _waiting || _streaming) )
     {
+        _cancel_request();
         release_joints();
-        _trajectory.clear();
         _current_cmd = _incoming_cmd;
 
         return true;
     }
 
-    if( HUBO_PATH_QUIT == _current_cmd.instruction )
+    if( _waiting || _streaming )
+    {
+        // Keep holding the current references (or playing the current trajectory, when
+        // blending) until the worker has something new to play
+        _take_incoming();
+        if( _waiting && !_carry_on )
+        {
+            send_commands();
+            return true;
+        }
+    }
+    else if( HUBO_PATH_QUIT == _current_cmd.instruction )
     {
         if( HUBO_PATH_QUIT != _incoming_cmd.instruction )
         {
-            if(_receive_incoming_trajectory())
-            {
-                _current_cmd = _incoming_cmd;
-            }
-            else
-            {
-                _trajectory.clear();
-            }
+            _request_trajectory(_incoming_cmd.instruction);
         }
         else if( _new_instruction )
         {
@@ -329,24 +1089,45 @@ bool Player::step()
 
     _current_cmd = _incoming_cmd;
 
-    if(_trajectory.size() == 0)
+    const PackedTrajectory& source = _source();
+    int available = _available();
+    if(available == 0)
     {
         return true;
     }
 
     if(_new_trajectory)
     {
-        _last_elem = _trajectory[0];
-        _current_elem = _trajectory[0];
+        _expand_step(0, _current_elem);
+        _last_elem = _current_elem;
         _current_index = 0;
         _new_trajectory = false;
+        _underrun_reported = false;
     }
 
     if( HUBO_PATH_RUN == _current_cmd.instruction )
     {
-        ++_current_index;
-        if(_current_index >= (int)_trajectory.size())
-            _current_index = (int)(_trajectory.size())-1;
+        bool advance = true;
+        if( _streaming && HUBO_PATH_UNDERRUN_SLOW == _underrun
+                && available - _current_index < (int)_prefix_steps(source) )
+        {
+            _slow_phase = !_slow_phase;
+            advance = _slow_phase;
+        }
+
+        if(advance)
+            ++_current_index;
+
+        if(_current_index >= available)
+        {
+            _current_index = available-1;
+            if( _streaming && !_underrun_reported )
+            {
+                std::cout << "Playback has caught up with the incoming trajectory at step "
+                          << _current_index << " -- holding until more arrives" << std::endl;
+                _underrun_reported = true;
+            }
+        }
     }
     else if( HUBO_PATH_PAUSE == _current_cmd.instruction )
     {
@@ -359,13 +1140,13 @@ bool Player::step()
             _current_index = 0;
     }
 
-    _current_elem = _trajectory[_current_index];
+    _last_elem = _current_elem;
+    _expand_step(_current_index, _current_elem);
 
     // TODO: Write a controller base class and use a controller class instance here
 
     _send_element_commands(_current_elem);
 
-    _last_elem = _current_elem;
     return true;
 }
 
@@ -373,7 +1154,7 @@ void Player::_send_element_commands(const hubo_path_element_t& elem)
 {
     for(size_t i=0; i<_desc.joints.size(); ++i)
     {
-        if( ((_trajectory.params.bitmap >> i) & 0x01) == 0x01 )
+        if( ((_source().params().bitmap >> i) & 0x01) == 0x01 )
         {
             // TODO: Use different command modes based on the element's control parameters
             // (but those do not exist yet)
@@ -37,6 +37,13 @@
 #include "HuboPath/interpolation/Trajectory.h"
 #include "HuboPath/interpolation/Spline.hpp"
 
+#include <pthread.h>
+#include <unistd.h>
+#include <string.h>
+
+// Slack for floating point error when deciding whether a sample lands on the final waypoint
+static const double eps_densify = 1e-9;
+
 bool HuboPath::Trajectory::interpolate(hubo_path_interp_t type)
 {
     params.interp = type;
@@ -93,7 +100,11 @@ bool HuboPath::Trajectory::interpolate()
     }
     else if( HUBO_PATH_DENSIFY == params.interp )
     {
-        return _densify();
+        return _densify(frequency, false);
+    }
+    else if( HUBO_PATH_DENSIFY_CUBIC == params.interp )
+    {
+        return _densify(frequency, true);
     }
     else if( HUBO_PATH_SATURATE == params.interp )
     {
@@ -115,36 +126,213 @@ static void print_limit_violation(const std::string& type,
 }
 
 const double eps = 1e-6;
-bool HuboPath::Trajectory::check_limits(bool enforceAccelerationLimits, bool printWarnings) const
+
+typedef Eigen::Array<double, Eigen::Dynamic, 1, 0, HUBO_PATH_JOINT_MAX_SIZE, 1> JointArray;
+
+// The limits of every joint side by side, with the tolerance already added in, so that each
+// element can be checked against all of them at once. Inactive joints get infinite limits, and
+// only the stretch of joints from the first active one to the last is looked at. These never
+// exceed HUBO_PATH_JOINT_MAX_SIZE, so they live on the stack.
+struct LimitTable
 {
+    size_t joint_count;
+    size_t first_active;
+    size_t active_span;
+    uint64_t bitmap;
+    double frequency;
+    JointArray max_position;
+    JointArray min_position;
+    JointArray max_speed;
+    JointArray max_accel;
+
+    inline bool active(size_t j) const { return ((bitmap >> j) & 0x01) == 0x01; }
+};
+
+static bool load_limit_table(const HuboPath::Trajectory& traj, LimitTable& table, bool verbose)
+{
+    const HuboCan::HuboDescription& desc = traj.desc;
+    const hubo_path_params_t& params = traj.params;
+
     if(!desc.okay() && (params.use_custom_limits != 1))
     {
-        std::cout << "Could not properly check trajectory limit violations!\n"
-                  << " -- Need either a valid description to be loaded or to have custom limits set!"
-                  << std::endl;
+        if(verbose)
+            std::cout << "Could not properly check trajectory limit violations!\n"
+                      << " -- Need either a valid description to be loaded or to have custom limits set!"
+                      << std::endl;
         return false;
     }
-    
-    size_t joint_count = 0;
+
     if(params.use_custom_limits == 1)
     {
-        joint_count = HUBO_PATH_JOINT_MAX_SIZE;
+        table.joint_count = HUBO_PATH_JOINT_MAX_SIZE;
     }
     else
     {
-        joint_count = desc.joints.size();
+        table.joint_count = desc.joints.size();
     }
-    
-    double frequency = desc.okay()? desc.params.frequency : params.frequency;
+
+    table.frequency = desc.okay()? desc.params.frequency : params.frequency;
     // TODO: Should I handle things differently if this is not a raw trajectory?
-    if(frequency == 0)
+    if(table.frequency == 0)
     {
-        std::cout << "No frequency is given for this trajectory. Defaulting to 200!" << std::endl;
-        frequency = 200;
+        if(verbose)
+            std::cout << "No frequency is given for this trajectory. Defaulting to 200!" << std::endl;
+        table.frequency = 200;
     }
-    
-    bool limits_okay = true;
+
+    const double inf = std::numeric_limits<double>::infinity();
+    const size_t count = table.joint_count;
+    table.bitmap = params.bitmap;
+    table.max_position.setConstant(count, inf);
+    table.min_position.setConstant(count, -inf);
+    table.max_speed.setConstant(count, inf);
+    table.max_accel.setConstant(count, inf);
+    table.first_active = count;
+    size_t last_active = 0;
+    for(size_t j=0; j<count; ++j)
+    {
+        if(!table.active(j))
+            continue;
+
+        const hubo_joint_limits_t& limits = (params.use_custom_limits==1) ?
+                                    params.limits[j] : desc.joints[j]->info.limits;
+
+        // A NaN limit can never be violated, which is the same as having no limit at all
+        table.max_position[j] = limits.max_position+eps;
+        table.min_position[j] = limits.min_position-eps;
+        table.max_speed[j] = limits.max_speed + eps;
+        table.max_accel[j] = limits.max_accel + eps;
+        if(table.max_position[j] != table.max_position[j])
+            table.max_position[j] = inf;
+        if(table.min_position[j] != table.min_position[j])
+            table.min_position[j] = -inf;
+        if(table.max_speed[j] != table.max_speed[j])
+            table.max_speed[j] = inf;
+        if(table.max_accel[j] != table.max_accel[j])
+            table.max_accel[j] = inf;
+
+        table.first_active = std::min(table.first_active, j);
+        last_active = j;
+    }
+    table.active_span = table.first_active < count ? last_active+1 - table.first_active : 0;
+
+    return true;
+}
+
+// Copies the active stretch of references into q, so nothing needs to be assumed about where
+// the references sit inside the element
+static void active_references(const hubo_path_element_t& elem, const LimitTable& table,
+                              JointArray& q)
+{
+    q.resize(table.active_span);
+    memcpy(q.data(), elem.references + table.first_active, table.active_span*sizeof(double));
+}
+
+// The exact per-joint checks which check_limits() reports on, for a single element
+static bool element_violates(const std::vector<hubo_path_element_t>& elements, size_t i,
+                             const LimitTable& table, bool check_accel)
+{
+    const double frequency = table.frequency;
+    for(size_t j=table.first_active; j<table.first_active+table.active_span; ++j)
+    {
+        if(!table.active(j))
+            continue;
+
+        double q = elements[i].references[j];
+        if( !(q == q) || table.max_position[j] < q || table.min_position[j] > q )
+            return true;
+
+        if( i == 0 )
+            continue;
+
+        double q_last = elements[i-1].references[j];
+        if( fabs(q - q_last) * frequency > table.max_speed[j] )
+            return true;
+
+        if( !check_accel || i == elements.size()-1 )
+            continue;
+
+        double q_next = elements[i+1].references[j];
+        if( fabs(q_next - 2*q + q_last) * frequency * frequency > table.max_accel[j] )
+            return true;
+    }
+
+    return false;
+}
+
+// The index of the first element which breaks any limit, or elements.size() if none do. Each
+// element gets screened with a few whole-array operations, and anything which the screen cannot
+// rule out gets the exact check before it counts.
+static size_t find_limit_violation(const std::vector<hubo_path_element_t>& elements,
+                                   const LimitTable& table, bool check_accel)
+{
+    const size_t begin = table.first_active;
+    const size_t span = table.active_span;
+    if(0 == span)
+        return elements.size();
+
+    const double frequency = table.frequency;
+    const JointArray::ConstSegmentReturnType max_position = table.max_position.segment(begin, span);
+    const JointArray::ConstSegmentReturnType min_position = table.min_position.segment(begin, span);
+    const JointArray::ConstSegmentReturnType max_speed = table.max_speed.segment(begin, span);
+    const JointArray::ConstSegmentReturnType max_accel = table.max_accel.segment(begin, span);
+
+    JointArray q, q_last, q_next;
     for(size_t i=0; i<elements.size(); ++i)
+    {
+        // Anything which is not finite goes straight to the exact check, which keeps NaNs out
+        // of the reductions
+        active_references(elements[i], table, q);
+        bool suspect = !q.allFinite()
+                || (q - max_position).max(min_position - q).maxCoeff() > 0;
+
+        if( !suspect && i > 0 )
+        {
+            active_references(elements[i-1], table, q_last);
+            suspect = !q_last.allFinite()
+                    || ((q - q_last).abs() * frequency - max_speed).maxCoeff() > 0;
+
+            if( !suspect && check_accel && i+1 < elements.size() )
+            {
+                active_references(elements[i+1], table, q_next);
+                suspect = !q_next.allFinite()
+                        || ((q_next - 2*q + q_last).abs() * frequency * frequency
+                            - max_accel).maxCoeff() > 0;
+            }
+        }
+
+        if( suspect && element_violates(elements, i, table, check_accel) )
+            return i;
+    }
+
+    return elements.size();
+}
+
+bool HuboPath::Trajectory::within_limits(bool enforceAccelerationLimits) const
+{
+    LimitTable table;
+    if(!load_limit_table(*this, table, false))
+        return false;
+
+    return find_limit_violation(elements, table, enforceAccelerationLimits) == elements.size();
+}
+
+bool HuboPath::Trajectory::check_limits(bool enforceAccelerationLimits, bool printWarnings) const
+{
+    LimitTable table;
+    if(!load_limit_table(*this, table, true))
+        return false;
+
+    size_t first = find_limit_violation(elements, table,
+                                        enforceAccelerationLimits || printWarnings);
+    if(first == elements.size())
+        return true;
+
+    // Something is off, so go through the rest one joint at a time to report all of it
+    const size_t joint_count = table.joint_count;
+    const double frequency = table.frequency;
+    bool limits_okay = true;
+    for(size_t i=first; i<elements.size(); ++i)
     {
         const hubo_path_element_t& elem = elements[i];
         const hubo_path_element_t& last_elem = ( i==0 ) ?
@@ -155,16 +343,16 @@ bool HuboPath::Trajectory::check_limits(bool enforceAccelerationLimits, bool pri
         
         for(size_t j=0; j<joint_count; ++j)
         {
-            const hubo_joint_limits_t& limits = (params.use_custom_limits==1) ?
-                                        params.limits[j] : desc.joints[j]->info.limits;
-            std::string name = desc.okay() ?
-                                   desc.joints[j]->info.name : "";
-            
-            if( ((params.bitmap >> j) & 0x01) != 0x01 )
+            if( !table.active(j) )
             {
                 continue;
             }
 
+            const hubo_joint_limits_t& limits = (params.use_custom_limits==1) ?
+                                        params.limits[j] : desc.joints[j]->info.limits;
+            const std::string& name = desc.okay() ?
+                                   desc.joints[j]->info.name : std::string();
+
             if( !(elem.references[j] == elem.references[j]) )
             {
                 print_limit_violation("NaN detection", name, j,
@@ -172,13 +360,13 @@ bool HuboPath::Trajectory::check_limits(bool enforceAccelerationLimits, bool pri
                 limits_okay = false;
             }
 
-            if( limits.max_position+eps < elem.references[j] )
+            if( table.max_position[j] < elem.references[j] )
             {
                 print_limit_violation("max position", name, j,
                                       limits.max_position, elem.references[j], i);
                 limits_okay = false;
             }
-            else if( limits.min_position-eps > elem.references[j] )
+            else if( table.min_position[j] > elem.references[j] )
             {
                 print_limit_violation("min position", name, j,
                                       limits.min_position, elem.references[j], i);
@@ -193,7 +381,7 @@ bool HuboPath::Trajectory::check_limits(bool enforceAccelerationLimits, bool pri
             
             double speed = fabs(elem.references[j] - last_elem.references[j])
                            * frequency;
-            if( speed > limits.max_speed + eps )
+            if( speed > table.max_speed[j] )
             {
                 print_limit_violation("max speed", name, j,
                                       limits.max_speed, speed, i);
@@ -211,7 +399,7 @@ bool HuboPath::Trajectory::check_limits(bool enforceAccelerationLimits, bool pri
                                 + last_elem.references[j])
                            * frequency * frequency;
 
-            if( accel > limits.max_accel + eps )
+            if( accel > table.max_accel[j] )
             {
                 if(printWarnings)
                     print_limit_violation("max acceleration", name, j,
@@ -245,7 +433,7 @@ std::vector<size_t> HuboPath::Trajectory::get_active_indices() const
   return mapping;
 }
 
-bool HuboPath::Trajectory::get_active_joint_limits(std::vector<hubo_joint_limits_t> &limits)
+bool HuboPath::Trajectory::get_active_joint_limits(std::vector<hubo_joint_limits_t> &limits) const
 {
     if(!desc.okay() && (params.use_custom_limits != 1))
     {
@@ -270,6 +458,44 @@ bool HuboPath::Trajectory::get_active_joint_limits(std::vector<hubo_joint_limits
     return true;
 }
 
+// Below this many samples per thread, starting threads costs more than it saves
+static const size_t min_samples_per_thread = 10000;
+static const size_t max_sampling_threads = 16;
+
+struct SamplingJob
+{
+    const optimal_interpolation::Trajectory* trajectory;
+    const std::vector<hubo_path_element_t>* saved;
+    std::vector<hubo_path_element_t>* output;
+    const IndexArray* mapping;
+    double dt;
+    size_t begin;
+    size_t end;
+};
+
+static void* sample_optimal_trajectory(void* data)
+{
+    const SamplingJob& job = *static_cast<SamplingJob*>(data);
+    const IndexArray& mapping = *job.mapping;
+
+    Eigen::VectorXd point(mapping.size());
+    size_t cursor = 0;
+    size_t segment = 0;
+    for(size_t i=job.begin; i<job.end; ++i)
+    {
+        job.trajectory->sample(i*job.dt, cursor, point, segment);
+
+        hubo_path_element_t& elem = (*job.output)[i];
+        elem = (*job.saved)[segment];
+        for(size_t j=0; j<mapping.size(); ++j)
+        {
+            elem.references[mapping[j]] = point[j];
+        }
+    }
+
+    return NULL;
+}
+
 bool HuboPath::Trajectory::_optimal_interpolation(const Eigen::VectorXd& velocities,
                                                   const Eigen::VectorXd& accelerations,
                                                   double frequency)
@@ -310,18 +536,45 @@ bool HuboPath::Trajectory::_optimal_interpolation(const Eigen::VectorXd& velocit
 
     double dt = 1.0/frequency;
     size_t traj_count = optimal_traj.getDuration()*frequency;
-    std::vector<hubo_path_element_t> savedElements = elements;
-    elements.clear();
+    std::vector<hubo_path_element_t> savedElements;
+    savedElements.swap(elements);
     elements.resize(traj_count);
-    for(size_t i=0; i<traj_count; ++i)
+
+    // Each thread fills in its own stretch of the elements, with the calling thread taking the
+    // first one
+    size_t thread_count = std::min<size_t>(std::max<long>(1, sysconf(_SC_NPROCESSORS_ONLN)),
+                                           traj_count/min_samples_per_thread);
+    thread_count = std::max<size_t>(1, std::min(thread_count, max_sampling_threads));
+
+    std::vector<SamplingJob> jobs(thread_count);
+    std::vector<pthread_t> threads(thread_count);
+    std::vector<bool> launched(thread_count, false);
+    for(size_t t=0; t<thread_count; ++t)
+    {
+        SamplingJob& job = jobs[t];
+        job.trajectory = &optimal_traj;
+        job.saved = &savedElements;
+        job.output = &elements;
+        job.mapping = &joint_mapping;
+        job.dt = dt;
+        job.begin = traj_count*t/thread_count;
+        job.end = traj_count*(t+1)/thread_count;
+
+        if(t > 0)
+            launched[t] = pthread_create(&threads[t], NULL, &sample_optimal_trajectory, &job) == 0;
+    }
+
+    // Anything which could not get a thread of its own gets done here
+    for(size_t t=0; t<thread_count; ++t)
     {
-        next_point = optimal_traj.getPosition(i*dt);
-        elements[i] = savedElements[optimal_traj.getPathSegmentIndex(i*dt)];
+        if(!launched[t])
+            sample_optimal_trajectory(&jobs[t]);
+    }
 
-        for(size_t j=0; j<joint_mapping.size(); ++j)
-        {
-            elements[i].references[joint_mapping[j]] = next_point[j];
-        }
+    for(size_t t=1; t<thread_count; ++t)
+    {
+        if(launched[t])
+            pthread_join(threads[t], NULL);
     }
 
     params.interp = HUBO_PATH_RAW;
@@ -376,10 +629,92 @@ bool HuboPath::Trajectory::_spline_interpolation(const Eigen::VectorXd& velociti
     return true;
 }
 
-bool HuboPath::Trajectory::_densify()
+bool HuboPath::Trajectory::_densify(double frequency, bool cubic)
 {
-    // FIXME TODO
-    return false;
+    double input_frequency = params.frequency;
+    if( input_frequency <= 0 )
+    {
+        std::cout << "Cannot densify a trajectory without knowing its input frequency!\n"
+                     " -- Use Operator::setInputFrequency(~) to provide it" << std::endl;
+        return false;
+    }
+
+    IndexArray joint_mapping;
+    get_active_indices(joint_mapping);
+
+    // Each column holds the active joints of one waypoint, so every sample below is a
+    // handful of column operations over all the joints at once
+    const size_t count = elements.size();
+    Eigen::MatrixXd points(joint_mapping.size(), count);
+    for(size_t i=0; i<count; ++i)
+    {
+        for(size_t j=0; j<joint_mapping.size(); ++j)
+        {
+            points(j,i) = elements[i].references[joint_mapping[j]];
+        }
+    }
+
+    // Catmull-Rom tangents, measured per waypoint interval. The path starts and ends at rest.
+    Eigen::MatrixXd tangents = Eigen::MatrixXd::Zero(joint_mapping.size(), count);
+    if(cubic)
+    {
+        for(size_t i=1; i+1<count; ++i)
+        {
+            tangents.col(i) = 0.5*(points.col(i+1) - points.col(i-1));
+        }
+    }
+
+    const double ratio = input_frequency/frequency;
+    const size_t segments = count-1;
+    const size_t traj_count = (size_t)floor(segments/ratio + eps_densify) + 1;
+
+    // The final waypoint is always kept, even when the durations do not divide evenly
+    const bool append_end = (traj_count-1)*ratio < segments - eps_densify;
+
+    std::vector<hubo_path_element_t> savedElements;
+    savedElements.swap(elements);
+    elements.resize(append_end ? traj_count+1 : traj_count);
+
+    Eigen::VectorXd next_point(joint_mapping.size());
+    for(size_t i=0; i<traj_count; ++i)
+    {
+        double t = std::min(i*ratio, (double)segments);
+        size_t k = std::min((size_t)t, segments-1);
+        double u = t - k;
+
+        if(cubic)
+        {
+            double u2 = u*u;
+            double u3 = u2*u;
+            next_point.noalias() = (2*u3 - 3*u2 + 1)*points.col(k)
+                                 + (u3 - 2*u2 + u)*tangents.col(k)
+                                 + (-2*u3 + 3*u2)*points.col(k+1)
+                                 + (u3 - u2)*tangents.col(k+1);
+        }
+        else
+        {
+            next_point.noalias() = (1-u)*points.col(k) + u*points.col(k+1);
+        }
+
+        elements[i] = savedElements[u < 1 ? k : k+1];
+        for(size_t j=0; j<joint_mapping.size(); ++j)
+        {
+            elements[i].references[joint_mapping[j]] = next_point[j];
+        }
+    }
+
+    if(append_end)
+    {
+        elements.back() = savedElements.back();
+    }
+
+    params.interp = HUBO_PATH_RAW;
+    params.frequency = frequency;
+
+    std::cout << "Successfully densified " << count << " waypoints into " << elements.size()
+              << " steps" << std::endl;
+
+    return true;
 }
 
 static std::vector<hubo_path_element_t> saturate(
@@ -455,10 +790,10 @@ static std::vector<hubo_path_element_t> saturate(
       for(size_t i=0; i < mapping.size(); ++i)
       {
         size_t index = mapping[i];
-        double& q = target.references[index];
+        double q = target.references[index];
         double q_last = lastElement.references[index];
 
-        q = s*(q-q_last) + q_last;
+        target.references[index] = s*(q-q_last) + q_last;
       }
     }
 
@@ -521,10 +856,10 @@ static std::vector<hubo_path_element_t> saturate(
         size_t index = mapping[i];
         double q_last = lastElement.references[index];
         double q = target.references[index];
-        double& q_next = potentialNext.references[index];
         double q_next_saved = nextElement.references[index];
 
-        q_next = a * (q_next - 2*q + q_last) + 2*q - q_last;
+        double q_next = a * (q_next_saved - 2*q + q_last) + 2*q - q_last;
+        potentialNext.references[index] = q_next;
 
         double min = std::min(q_next_saved, q);
         double max = std::max(q_next_saved, q);
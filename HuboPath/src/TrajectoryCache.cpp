@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "HuboPath/TrajectoryCache.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <sys/stat.h>
+
+namespace HuboPath {
+
+// Marks the start of each cache file, including the version of its layout
+static const char cache_file_tag[8] = {'H','P','C','A','C','H','E','1'};
+
+TrajectoryCache::TrajectoryCache(size_t capacity, const std::string& directory)
+{
+    _capacity = capacity;
+    set_directory(directory);
+}
+
+bool TrajectoryCache::signature(const Trajectory& raw, std::string& result) const
+{
+    result.clear();
+    if( HUBO_PATH_RAW == raw.params.interp || raw.size() < 2 )
+        return false;
+
+    if(!raw.desc.okay() && (raw.params.use_custom_limits != 1))
+        return false;
+
+    std::vector<hubo_joint_limits_t> limits;
+    if(!raw.get_active_joint_limits(limits))
+        return false;
+
+    double frequency = raw.desc.okay() ? raw.desc.params.frequency : raw.params.frequency;
+
+    std::ostringstream stream;
+    PackedTrajectory(raw).write(stream);
+    stream.write(reinterpret_cast<const char*>(&frequency), sizeof(frequency));
+    if(!limits.empty())
+        stream.write(reinterpret_cast<const char*>(&limits[0]),
+                     limits.size()*sizeof(hubo_joint_limits_t));
+
+    result = stream.str();
+    return true;
+}
+
+uint64_t TrajectoryCache::hash(const std::string& signature)
+{
+    // 64-bit FNV-1a
+    uint64_t h = 14695981039346656037ULL;
+    for(size_t i=0; i<signature.size(); ++i)
+    {
+        h ^= (unsigned char)signature[i];
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+bool TrajectoryCache::fetch(const std::string& signature, PackedTrajectory& result)
+{
+    if(signature.empty())
+        return false;
+
+    uint64_t key = hash(signature);
+    Entry* entry = _find(key, signature);
+    if(entry)
+    {
+        result = entry->trajectory;
+        return true;
+    }
+
+    if(_directory.empty())
+        return false;
+
+    if(!_load_file(key, signature, result))
+        return false;
+
+    if(_capacity > 0)
+        _insert(key, signature).trajectory = result;
+
+    return true;
+}
+
+void TrajectoryCache::store(const std::string& signature, const PackedTrajectory& result)
+{
+    if(signature.empty())
+        return;
+
+    uint64_t key = hash(signature);
+    if(_capacity > 0)
+        _insert(key, signature).trajectory = result;
+
+    if(!_directory.empty())
+        _save_file(key, signature, result);
+}
+
+void TrajectoryCache::set_capacity(size_t capacity)
+{
+    _capacity = capacity;
+    _trim();
+}
+
+bool TrajectoryCache::set_directory(const std::string& directory)
+{
+    _directory.clear();
+    if(directory.empty())
+        return true;
+
+    if( mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST )
+    {
+        std::cerr << "Could not create the trajectory cache directory '" << directory << "': "
+                  << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    if( stat(directory.c_str(), &info) != 0 || !S_ISDIR(info.st_mode) )
+    {
+        std::cerr << "The trajectory cache path '" << directory << "' is not a directory!"
+                  << std::endl;
+        return false;
+    }
+
+    _directory = directory;
+    return true;
+}
+
+void TrajectoryCache::clear()
+{
+    _entries.clear();
+    _lookup.clear();
+}
+
+TrajectoryCache::Entry* TrajectoryCache::_find(uint64_t key, const std::string& signature)
+{
+    std::map<uint64_t, EntryList::iterator>::iterator it = _lookup.find(key);
+    if( it == _lookup.end() || it->second->signature != signature )
+        return NULL;
+
+    // Move it to the front, since it was just used
+    _entries.splice(_entries.begin(), _entries, it->second);
+    return &_entries.front();
+}
+
+TrajectoryCache::Entry& TrajectoryCache::_insert(uint64_t key, const std::string& signature)
+{
+    std::map<uint64_t, EntryList::iterator>::iterator it = _lookup.find(key);
+    if( it != _lookup.end() )
+    {
+        // Either the same signature, or a hash collision; either way the newer one wins
+        _entries.splice(_entries.begin(), _entries, it->second);
+    }
+    else
+    {
+        _entries.push_front(Entry());
+        _entries.front().key = key;
+        _lookup[key] = _entries.begin();
+    }
+
+    Entry& entry = _entries.front();
+    entry.signature = signature;
+    _trim();
+    return entry;
+}
+
+void TrajectoryCache::_trim()
+{
+    while(_entries.size() > _capacity)
+    {
+        _lookup.erase(_entries.back().key);
+        _entries.pop_back();
+    }
+}
+
+std::string TrajectoryCache::_file_name(uint64_t key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.traj", (unsigned long long)key);
+    return _directory + "/" + name;
+}
+
+bool TrajectoryCache::_load_file(uint64_t key, const std::string& signature,
+                                 PackedTrajectory& result) const
+{
+    std::ifstream file(_file_name(key).c_str(), std::ios::in | std::ios::binary);
+    if(!file.is_open())
+        return false;
+
+    char tag[sizeof(cache_file_tag)];
+    uint64_t length = 0;
+    file.read(tag, sizeof(tag));
+    file.read(reinterpret_cast<char*>(&length), sizeof(length));
+    if( !file.good() || memcmp(tag, cache_file_tag, sizeof(tag)) != 0
+            || length != signature.size() )
+        return false;
+
+    std::string stored(length, '\0');
+    if(length > 0)
+        file.read(&stored[0], length);
+    if( !file.good() || stored != signature )
+        return false;
+
+    PackedTrajectory loaded;
+    if(!loaded.read(file))
+    {
+        std::cerr << "The trajectory cache file " << _file_name(key) << " is damaged"
+                  << std::endl;
+        return false;
+    }
+
+    result.swap(loaded);
+    return true;
+}
+
+void TrajectoryCache::_save_file(uint64_t key, const std::string& signature,
+                                 const PackedTrajectory& result) const
+{
+    // Write to a temporary file first, so that a crash never leaves a partial file behind
+    std::string name = _file_name(key);
+    std::string temporary = name + ".tmp";
+    std::ofstream file(temporary.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file.is_open())
+    {
+        std::cerr << "Could not open " << temporary << " to save a cached trajectory"
+                  << std::endl;
+        return;
+    }
+
+    uint64_t length = signature.size();
+    file.write(cache_file_tag, sizeof(cache_file_tag));
+    file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    file.write(signature.data(), length);
+    bool okay = result.write(file);
+    file.close();
+
+    if( !okay || file.fail() || rename(temporary.c_str(), name.c_str()) != 0 )
+    {
+        std::cerr << "Failed to save a cached trajectory to " << name << std::endl;
+        remove(temporary.c_str());
+    }
+}
+
+} // namespace HuboPath
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "HuboPath/TrajectoryReceiver.hpp"
+
+extern "C" {
+#include "HuboCmd/hubo_cmd_c.h"
+}
+
+namespace HuboPath {
+
+TrajectoryReceiver::TrajectoryReceiver()
+{
+    _input_chan = NULL;
+    _feedback_chan = NULL;
+    _target = &_trajectory;
+    _timeout = 0;
+    _last_arrival = 0;
+    _total_chunks = 0;
+    _chunk_capacity = 0;
+    memset(&_feedback, 0, sizeof(_feedback));
+    _feedback.state = PATH_RX_IGNORING;
+}
+
+void TrajectoryReceiver::begin(ach_channel_t& input_channel, ach_channel_t& feedback_channel,
+                               double timeout, PackedTrajectory* target)
+{
+    _target = target ? target : &_trajectory;
+    _input_chan = &input_channel;
+    _feedback_chan = &feedback_channel;
+    _timeout = timeout;
+    _last_arrival = hubo_cmd_time_now();
+
+    _buffer.resize(HUBO_PATH_CHUNK_MAX_BYTES);
+    _target->clear();
+    _received.clear();
+    _total_chunks = 0;
+    _chunk_capacity = 0;
+
+    memset(&_feedback, 0, sizeof(_feedback));
+    _feedback.state = PATH_RX_READ_READY;
+    ach_put(_feedback_chan, &_feedback, sizeof(_feedback));
+}
+
+hubo_path_rx_state_t TrajectoryReceiver::_quit(hubo_path_rx_state_t state)
+{
+    _feedback.state = state;
+    ach_put(_feedback_chan, &_feedback, sizeof(_feedback));
+    return state;
+}
+
+void TrajectoryReceiver::cancel()
+{
+    if(PATH_RX_READ_READY == _feedback.state || PATH_RX_LISTENING == _feedback.state)
+        _quit(PATH_RX_CANCELED);
+}
+
+hubo_path_rx_state_t TrajectoryReceiver::poll(double max_wait_time)
+{
+    if(PATH_RX_READ_READY != _feedback.state && PATH_RX_LISTENING != _feedback.state)
+        return _feedback.state;
+
+    struct timespec t;
+    clock_gettime(ACH_DEFAULT_CLOCK, &t);
+    long nano = t.tv_nsec + (long)(max_wait_time*1E9);
+    t.tv_sec += nano/1000000000L;
+    t.tv_nsec = nano%1000000000L;
+    int flags = max_wait_time > 0 ? ACH_O_WAIT : 0;
+
+    hubo_path_chunk_t* chunk = (hubo_path_chunk_t*)&_buffer[0];
+    bool took_chunks = false;
+    while(PATH_RX_FINISHED != _feedback.state)
+    {
+        size_t fs;
+        ach_status_t result = ach_get(_input_chan, chunk, _buffer.size(), &fs, &t, flags);
+
+        if( ACH_STALE_FRAMES == result || ACH_TIMEOUT == result )
+        {
+            break;
+        }
+        else if( ACH_OK != result && ACH_MISSED_FRAME != result )
+        {
+            // A missed frame only means the sender got ahead of us; it will resend whatever
+            // we report as missing
+            std::cout << "Unexpected Ach result: " << ach_result_to_string(result)
+                      << " -- We are giving up on this trajectory!" << std::endl;
+            return _quit(PATH_RX_ACH_ERROR);
+        }
+
+        // Take in anything else which has already arrived before acknowledging
+        flags = 0;
+
+        if( fs < sizeof(hubo_path_chunk_t) || check_hubo_path_chunk(chunk) != 0 )
+        {
+            std::cout << "Invalid header code in received chunk: "
+                      << std::string(chunk->header.code, HUBO_PATH_HEADER_CODE_SIZE-1) << "\n"
+                      << " -- We are ignoring this chunk!" << std::endl;
+            continue;
+        }
+
+        if( chunk->chunk_id == PATH_TX_CANCEL )
+        {
+            std::cout << "Received a request to cancel the trajectory transfer\n"
+                      << " -- We are giving up on this trajectory!" << std::endl;
+            return _quit(PATH_RX_CANCELED);
+        }
+
+        if( hubo_path_chunk_size(chunk) != fs )
+        {
+            std::cout << "Data size error in chunk " << chunk->chunk_id << "! Expected size:"
+                      << hubo_path_chunk_size(chunk) << ", Frame size:" << fs << "\n"
+                      << " -- We are ignoring this chunk!" << std::endl;
+            continue;
+        }
+
+        if( !_take_chunk() )
+        {
+            std::cout << " -- We are giving up on this trajectory!" << std::endl;
+            return _quit(PATH_RX_DISCONTINUITY);
+        }
+
+        took_chunks = true;
+    }
+
+    double now = hubo_cmd_time_now();
+    if(took_chunks)
+    {
+        _last_arrival = now;
+        ach_put(_feedback_chan, &_feedback, sizeof(_feedback));
+    }
+    else if(now - _last_arrival > _timeout)
+    {
+        std::cout << "Did not receive next chunk from the sender in "
+                  << _timeout << " seconds\n"
+                  << " -- We are giving up on this trajectory!" << std::endl;
+        return _quit(PATH_RX_TIMEOUT);
+    }
+
+    return _feedback.state;
+}
+
+bool TrajectoryReceiver::_take_chunk()
+{
+    hubo_path_chunk_t* chunk = (hubo_path_chunk_t*)&_buffer[0];
+
+    uint32_t id = chunk->chunk_id;
+    if( 0 == _total_chunks || id >= _total_chunks || !_received[id] )
+    {
+        if( _target->read_chunk(chunk) != HuboCan::OKAY )
+        {
+            _feedback.chunk_id = chunk->chunk_id;
+            return false;
+        }
+
+        if( 0 == _total_chunks )
+        {
+            _total_chunks = chunk->total_chunks;
+            _chunk_capacity = chunk->chunk_capacity;
+            _received.assign(_total_chunks, false);
+            _feedback.expected_size = _total_chunks;
+        }
+
+        _received[id] = true;
+    }
+
+    _feedback.chunk_id = id;
+    while( _feedback.acked < _total_chunks && _received[_feedback.acked] )
+        ++_feedback.acked;
+
+    _feedback.received_mask = 0;
+    for(uint32_t i=0; i<64 && _feedback.acked+1+i < _total_chunks; ++i)
+    {
+        if( _received[_feedback.acked+1+i] )
+            _feedback.received_mask |= (uint64_t)(0x01) << i;
+    }
+
+    _feedback.state = _feedback.acked < _total_chunks ? PATH_RX_LISTENING : PATH_RX_FINISHED;
+    return true;
+}
+
+size_t TrajectoryReceiver::available() const
+{
+    if( 0 == _total_chunks )
+        return 0;
+
+    if( _feedback.acked == _total_chunks )
+        return _target->incoming_size();
+
+    return (size_t)(_feedback.acked)*_chunk_capacity;
+}
+
+} // namespace HuboPath
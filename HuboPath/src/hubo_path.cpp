@@ -36,6 +36,39 @@
 #include <sstream>
 
 #include "HuboPath/hubo_path.hpp"
+#include "HuboPath/TrajectoryReceiver.hpp"
+#include "HuboPath/ChunkWindow.hpp"
+
+// How long the sender waits to hear about a chunk before it assumes the chunk was lost
+static const double retransmit_timeout = 0.1;
+
+// How often the sender checks whether the receiver has become ready
+static const double handshake_step = 0.02;
+
+static double path_clock_now()
+{
+    struct timespec t;
+    clock_gettime(ACH_DEFAULT_CLOCK, &t);
+    return (double)(t.tv_sec) + (double)(t.tv_nsec)/1E9;
+}
+
+static struct timespec path_clock_after(double seconds)
+{
+    struct timespec t;
+    clock_gettime(ACH_DEFAULT_CLOCK, &t);
+    long nano = t.tv_nsec + (long)(seconds*1E9);
+    t.tv_sec += nano/1000000000L;
+    t.tv_nsec = nano%1000000000L;
+    return t;
+}
+
+static void send_path_chunk(ach_channel_t& output_channel, hubo_path_chunk_t* chunk,
+                            const HuboPath::PackedTrajectory& trajectory, uint32_t chunk_id)
+{
+    size_t size = trajectory.write_chunk(chunk_id, chunk);
+    if(size > 0)
+        ach_put(&output_channel, chunk, size);
+}
 
 HuboCan::error_result_t HuboPath::send_trajectory(ach_channel_t &output_channel,
                                             ach_channel_t &feedback_channel,
@@ -50,12 +83,11 @@ HuboCan::error_result_t HuboPath::send_trajectory(ach_channel_t &output_channel,
     ach_status_t result;
     struct timespec t;
     size_t fs;
-    int attempts = 0;
+    double deadline = path_clock_now() + max_wait_time;
 
     do {
 
-        clock_gettime(ACH_DEFAULT_CLOCK, &t);
-        t.tv_sec += 1; ++attempts;
+        t = path_clock_after(handshake_step);
         result = ach_get( &feedback_channel, &feedback, sizeof(feedback), &fs, &t,
                          ACH_O_WAIT | ACH_O_LAST );
 
@@ -66,76 +98,99 @@ HuboCan::error_result_t HuboPath::send_trajectory(ach_channel_t &output_channel,
             return HuboCan::ACH_ERROR;
         }
 
-    } while( feedback.state != PATH_RX_READ_READY && attempts <= max_wait_time );
+    } while( feedback.state != PATH_RX_READ_READY && path_clock_now() < deadline );
 
-    if(attempts > max_wait_time)
+    if(feedback.state != PATH_RX_READ_READY)
     {
         std::cout << "We did not receive readiness acknowledgment from listener\n"
                   << " -- " << feedback << "\n"
                   << " -- We will NOT send off the trajectory!" << std::endl;
+        return HuboCan::TIMEOUT;
+    }
+
+    PackedTrajectory packed(trajectory);
+    uint32_t total_chunks = packed.chunk_count();
+    if(0 == total_chunks)
+    {
+        std::cout << "Cannot send an empty trajectory!" << std::endl;
+        return HuboCan::UNINITIALIZED;
     }
 
-    uint32_t total_chunks = ceil((double)(trajectory.size())/(double)(HUBO_PATH_CHUNK_MAX_SIZE));
+    // Sliding window: up to HUBO_PATH_WINDOW_SIZE frames wait on the input channel at a time,
+    // resent chunks included. Chunks which the receiver reports as skipped get resent
+    // individually, and if the receiver goes quiet, the oldest unacknowledged chunk gets resent.
+    std::vector<uint8_t> buffer(HUBO_PATH_CHUNK_MAX_BYTES);
+    hubo_path_chunk_t* chunk = (hubo_path_chunk_t*)&buffer[0];
+    ChunkWindow window(total_chunks, retransmit_timeout);
+    uint32_t chunk_id;
+    double last_progress = path_clock_now();
 
-    hubo_path_chunk_t chunk;
-    size_t counter = 0;
-    for(uint32_t i=0; i<total_chunks; ++i)
+    while(true)
     {
-        clear_hubo_path_chunk(&chunk);
-        chunk.chunk_id = i;
-        chunk.total_chunks = total_chunks;
-        chunk.params = trajectory.params;
-        
-        size_t c = 0;
-        while( c < HUBO_PATH_CHUNK_MAX_SIZE && counter < trajectory.size() )
-        {
-            chunk.elements[c] = trajectory[counter];
-            ++c; ++counter;
-        }
-        chunk.chunk_size = c;
-        
-        ach_put(&output_channel, &chunk, sizeof(chunk));
-        
-        clock_gettime( ACH_DEFAULT_CLOCK, &t );
-        t.tv_sec += max_wait_time;
+        while( window.next(path_clock_now(), chunk_id) )
+            send_path_chunk(output_channel, chunk, packed, chunk_id);
+
+        t = path_clock_after(retransmit_timeout);
         result = ach_get( &feedback_channel, &feedback, sizeof(feedback), &fs,
                           &t, ACH_O_WAIT | ACH_O_LAST );
-        
+        double now = path_clock_now();
+
         if( ACH_TIMEOUT == result )
         {
-            std::cout << "We did not receive acknowledgment from the listener at chunk "
-                      << i << " of the trajectory\n"
-                      << " -- Last received acknowledgment: " << feedback << "\n"
-                      << " -- We will STOP sending off the trajectory!" << std::endl;
-            return HuboCan::TIMEOUT;
+            if( now - last_progress > max_wait_time )
+            {
+                std::cout << "We did not receive acknowledgment from the listener at chunk "
+                          << window.acked() << " of the trajectory\n"
+                          << " -- Last received acknowledgment: " << feedback << "\n"
+                          << " -- We will STOP sending off the trajectory!" << std::endl;
+                return HuboCan::TIMEOUT;
+            }
+
+            if( window.timed_out(now, chunk_id) )
+                send_path_chunk(output_channel, chunk, packed, chunk_id);
+            continue;
         }
-        
-        if( feedback.chunk_id != i )
+        else if( ACH_OK != result && ACH_MISSED_FRAME != result )
         {
-            std::cout << "Inconsistent Chunk ID in acknowledgment from listener!\n"
-                      << " -- Received:" << feedback.chunk_id << ", Expected:" << i << "\n"
-                      << " -- Status: " << feedback << std::endl;
-            return HuboCan::SYNCH_ERROR;
+            std::cout << "Unexpected ach result while sending trajectory: "
+                      << ach_result_to_string(result) << std::endl;
+            return HuboCan::ACH_ERROR;
         }
-        
-        if( PATH_RX_FINISHED == feedback.state && feedback.chunk_id == total_chunks-1 )
+
+        if( PATH_RX_READ_READY == feedback.state )
+            continue; // Nothing has arrived at the receiver yet
+
+        if( PATH_RX_FINISHED == feedback.state && feedback.acked == total_chunks )
         {
             std::cout << "Finished sending trajectory!" << std::endl;
             return HuboCan::OKAY;
         }
-        else if( PATH_RX_FINISHED == feedback.state && feedback.chunk_id != total_chunks-1 )
+        else if( PATH_RX_FINISHED == feedback.state )
         {
             std::cout << "Received inappropriate report of being finished!\n"
-                      << " -- Current chunk:" << i << ", Final chunk:" << total_chunks-1 << "\n"
+                      << " -- Acknowledged chunks:" << feedback.acked
+                      << ", Total chunks:" << total_chunks << "\n"
                       << " -- Status: " << feedback << std::endl;
             return HuboCan::SYNCH_ERROR;
         }
-        
+
         if( PATH_RX_LISTENING != feedback.state )
         {
             std::cout << "Error reported by trajectory receiver: " << feedback << std::endl;
             return HuboCan::INTERRUPTED;
         }
+
+        if( feedback.expected_size != total_chunks || feedback.acked > window.sent() )
+        {
+            std::cout << "Inconsistent acknowledgment from listener!\n"
+                      << " -- Acknowledged:" << feedback.acked << ", Sent:" << window.sent()
+                      << ", Total chunks:" << total_chunks << "\n"
+                      << " -- Status: " << feedback << std::endl;
+            return HuboCan::SYNCH_ERROR;
+        }
+
+        if( window.acknowledge(feedback, now) )
+            last_progress = now;
     }
 
     return HuboCan::UNDEFINED_ERROR;
@@ -150,92 +205,28 @@ HuboCan::error_result_t HuboPath::receive_trajectory(ach_channel_t &input_channe
     
     new_trajectory.clear();
     
-    hubo_path_rx_t feedback;
-    memset(&feedback, 0, sizeof(feedback));
-    feedback.state = PATH_RX_READ_READY;
-    ach_put(&feedback_channel, &feedback, sizeof(feedback));
+    TrajectoryReceiver receiver;
+    receiver.begin(input_channel, feedback_channel, max_wait_time);
     
-    hubo_path_chunk_t chunk;
-    int chunk_id=-1, total_chunks=1;
-    struct timespec t;
-    size_t fs;
-    ach_status_t result;
+    hubo_path_rx_state_t state;
+    do {
+        state = receiver.poll(max_wait_time);
+    } while( PATH_RX_READ_READY == state || PATH_RX_LISTENING == state );
     
-    while(chunk_id < total_chunks-1)
+    switch(state)
     {
-        clock_gettime(ACH_DEFAULT_CLOCK, &t);
-        t.tv_sec += max_wait_time;
-        result = ach_get(&input_channel, &chunk, sizeof(chunk), &fs, &t, ACH_O_WAIT);
-        
-        feedback.chunk_id = chunk.chunk_id;
-        feedback.expected_size = chunk.total_chunks;
-        
-        if( ACH_TIMEOUT == result )
-        {
-            std::cout << "Did not receive next chunk from the sender in "
-                      << max_wait_time << " seconds\n"
-                      << " -- We are giving up on this trajectory!" << std::endl;
-            feedback.state = PATH_RX_TIMEOUT;
-            ach_put(&feedback_channel, &feedback, sizeof(feedback));
-            return HuboCan::TIMEOUT;
-        }
-        else if( ACH_OK != result )
-        {
-            std::cout << "Unexpected Ach result: " << ach_result_to_string(result)
-                      << " -- We are giving up on this trajectory!" << std::endl;
-            feedback.state = PATH_RX_ACH_ERROR;
-            ach_put(&feedback_channel, &feedback, sizeof(feedback));
-            return HuboCan::ACH_ERROR;
-        }
-        
-        if( check_hubo_path_chunk(&chunk) != 0 )
-        {
-            std::cout << "Invalid header code in received chunk: " << chunk.header.code << "\n"
-                      << " -- We are giving up on this trajectory!" << std::endl;
-            
-        }
-        
-        if( chunk.chunk_id == PATH_TX_CANCEL )
-        {
-            std::cout << "Received a request to cancel the trajectory transfer\n"
-                      << " -- We are giving up on this trajectory!" << std::endl;
-            feedback.state = PATH_RX_CANCELED;
-            ach_put(&feedback_channel, &feedback, sizeof(feedback));
-            return HuboCan::INTERRUPTED;
-        }
-        
-        if(chunk.chunk_id == chunk_id+1)
-        {
-            for(uint32_t i=0; i<chunk.chunk_size; ++i)
-            {
-                new_trajectory.push_back(chunk.elements[i]);
-            }
-            
-            new_trajectory.params = chunk.params;
-        }
-        else
-        {
-            std::cout << "Received discontinuous Chunk ID: "
-                      << chunk_id << " -> " << chunk.chunk_id
-                      << " -- We are giving up on this trajectory!" << std::endl;
-            feedback.state = PATH_RX_DISCONTINUITY;
-            ach_put(&feedback_channel, &feedback, sizeof(feedback));
-            return HuboCan::SYNCH_ERROR;
-        }
-        
-        chunk_id = chunk.chunk_id;
-        total_chunks = chunk.total_chunks;
-        
-        if(chunk_id < total_chunks-1)
-            feedback.state = PATH_RX_LISTENING;
-        else if(chunk_id == total_chunks-1)
-            feedback.state = PATH_RX_FINISHED;
-        
-        ach_put(&feedback_channel, &feedback, sizeof(feedback));
+        case PATH_RX_FINISHED:
+            receiver.trajectory().finish_reading();
+            receiver.trajectory().unpack(new_trajectory);
+            std::cout << "Finished receiving trajectory!" << std::endl;
+            return HuboCan::OKAY;
+        case PATH_RX_TIMEOUT:       return HuboCan::TIMEOUT;
+        case PATH_RX_CANCELED:      return HuboCan::INTERRUPTED;
+        case PATH_RX_DISCONTINUITY: return HuboCan::SYNCH_ERROR;
+        default:                    return HuboCan::ACH_ERROR;
     }
     
-    std::cout << "Finished receiving trajectory!" << std::endl;
-    return HuboCan::OKAY;
+    return HuboCan::UNDEFINED_ERROR;
 }
 
 const char* hubo_path_interp_to_string(const hubo_path_interp_t& type)
@@ -245,7 +236,9 @@ const char* hubo_path_interp_to_string(const hubo_path_interp_t& type)
         case HUBO_PATH_SPLINE:      return "HUBO_PATH_SPLINE";  break;
         case HUBO_PATH_OPTIMAL:    return "HUBO_PATH_OPTIMIZE";break;
         case HUBO_PATH_DENSIFY:     return "HUBO_PATH_DENSIFY"; break;
+        case HUBO_PATH_SATURATE:    return "HUBO_PATH_SATURATE";break;
         case HUBO_PATH_RAW:         return "HUBO_PATH_RAW";     break;
+        case HUBO_PATH_DENSIFY_CUBIC: return "HUBO_PATH_DENSIFY_CUBIC"; break;
         default:                    return "HUBO_PATH_UNKNOWN"; break;
     }
 
@@ -267,6 +260,7 @@ const char* hubo_path_instruction_to_string(const hubo_path_instruction_t& type)
         case HUBO_PATH_REVERSE:     return "HUBO_PATH_REVERSE";     break;
         case HUBO_PATH_LOAD:        return "HUBO_PATH_LOAD";        break;
         case HUBO_PATH_LOAD_N_GO:   return "HUBO_PATH_LOAD_N_GO";   break;
+        case HUBO_PATH_BLEND:       return "HUBO_PATH_BLEND";       break;
         default:                    return "HUBO_PATH_UNKNOWN";     break;
     }
 
@@ -278,6 +272,23 @@ std::ostream& operator<<(std::ostream& stream, const hubo_path_instruction_t& ty
     return (stream << hubo_path_instruction_to_string(type));
 }
 
+const char* hubo_path_underrun_to_string(const hubo_path_underrun_t& type)
+{
+    switch(type)
+    {
+        case HUBO_PATH_UNDERRUN_HOLD:   return "HUBO_PATH_UNDERRUN_HOLD";   break;
+        case HUBO_PATH_UNDERRUN_SLOW:   return "HUBO_PATH_UNDERRUN_SLOW";   break;
+        default:                        return "HUBO_PATH_UNDERRUN_UNKNOWN";break;
+    }
+
+    return "HUBO_PATH_UNDERRUN_IMPOSSIBLE";
+}
+
+std::ostream& operator<<(std::ostream& stream, const hubo_path_underrun_t& type)
+{
+    return (stream << hubo_path_underrun_to_string(type));
+}
+
 const char* hubo_path_rx_state_to_string(const hubo_path_rx_state_t& state)
 {
     switch(state)
@@ -45,3 +45,39 @@ int check_hubo_path_chunk(const hubo_path_chunk_t *chunk)
 {
     return strncmp(chunk->header.code, HUBO_PATH_HEADER_CODE, HUBO_PATH_HEADER_CODE_SIZE);
 }
+
+size_t hubo_path_packed_element_size(uint8_t joint_count)
+{
+    return sizeof(uint64_t) + joint_count*sizeof(float);
+}
+
+static size_t hubo_path_chunk_limits_size(uint8_t joint_count, uint8_t use_custom_limits)
+{
+    return use_custom_limits == 1 ? joint_count*sizeof(hubo_joint_limits_t) : 0;
+}
+
+uint32_t hubo_path_chunk_capacity(uint8_t joint_count, uint8_t use_custom_limits)
+{
+    return (HUBO_PATH_CHUNK_MAX_BYTES - sizeof(hubo_path_chunk_t)
+            - hubo_path_chunk_limits_size(joint_count, use_custom_limits))
+            / hubo_path_packed_element_size(joint_count);
+}
+
+size_t hubo_path_chunk_size(const hubo_path_chunk_t* chunk)
+{
+    return sizeof(hubo_path_chunk_t)
+            + hubo_path_chunk_limits_size(chunk->joint_count, chunk->use_custom_limits)
+            + chunk->chunk_size*hubo_path_packed_element_size(chunk->joint_count);
+}
+
+hubo_joint_limits_t* hubo_path_chunk_limits(hubo_path_chunk_t* chunk)
+{
+    return (hubo_joint_limits_t*)((uint8_t*)chunk + sizeof(hubo_path_chunk_t));
+}
+
+uint8_t* hubo_path_chunk_element(hubo_path_chunk_t* chunk, uint32_t index)
+{
+    return (uint8_t*)chunk + sizeof(hubo_path_chunk_t)
+            + hubo_path_chunk_limits_size(chunk->joint_count, chunk->use_custom_limits)
+            + index*hubo_path_packed_element_size(chunk->joint_count);
+}
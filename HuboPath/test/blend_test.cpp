@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "HuboPath/Player.hpp"
+
+#include <cstdlib>
+
+int main(int, char* [])
+{
+    const double frequency = 200;
+    srand48(7);
+
+    size_t planned = 0;
+    for(size_t trial=0; trial<1000; ++trial)
+    {
+        HuboPath::PathBlend blend;
+        blend.joint_count = 4;
+        for(size_t k=0; k<blend.joint_count; ++k)
+        {
+            hubo_joint_limits_t& limits = blend.limits[k];
+            limits.min_position = -2;
+            limits.max_position = 2;
+            limits.max_speed = 1 + k;
+            limits.max_accel = 2 + k;
+
+            blend.joints[k] = k;
+            blend.start[k] = -1 + 2*drand48();
+            blend.end[k] = -1.5 + 3*drand48();
+            blend.start_velocity[k] = (2*drand48() - 1)*0.9*limits.max_speed;
+            blend.end_velocity[k] = (2*drand48() - 1)*0.9*limits.max_speed;
+        }
+
+        // Whatever plan() settles on has to be the shortest blend that an exhaustive search
+        // can find, and it must not give up while any length up to the limit fits
+        size_t shortest = 0;
+        for(size_t n=1; n <= (size_t)(10*frequency) && shortest == 0; ++n)
+        {
+            if(blend.fits(n/frequency))
+                shortest = n;
+        }
+
+        bool found = blend.plan(frequency, 10);
+        if( found != (shortest > 0) || (found && blend.steps != shortest) )
+        {
+            std::cout << "Trial " << trial << " planned " << (found ? blend.steps : 0)
+                      << " steps, but the shortest blend has " << shortest << std::endl;
+            return 1;
+        }
+
+        if(!found)
+            continue;
+
+        ++planned;
+
+        hubo_path_element_t previous, current, next;
+        memset(&previous, 0, sizeof(previous));
+        memset(&current, 0, sizeof(current));
+        memset(&next, 0, sizeof(next));
+        blend.expand(0, current);
+        blend.expand(blend.steps, next);
+        for(size_t k=0; k<blend.joint_count; ++k)
+        {
+            if( fabs(current.references[k] - blend.start[k]) > 1e-12
+                    || fabs(next.references[k] - blend.end[k]) > 1e-12 )
+            {
+                std::cout << "Trial " << trial << " does not meet its ends" << std::endl;
+                return 2;
+            }
+        }
+
+        for(size_t i=1; i<blend.steps; ++i)
+        {
+            blend.expand(i-1, previous);
+            blend.expand(i, current);
+            blend.expand(i+1, next);
+            for(size_t k=0; k<blend.joint_count; ++k)
+            {
+                const hubo_joint_limits_t& limits = blend.limits[k];
+                double p = current.references[k];
+                double v = (next.references[k] - previous.references[k])*frequency/2;
+                double a = (next.references[k] - 2*p + previous.references[k])
+                                *frequency*frequency;
+                if( p < limits.min_position || limits.max_position < p
+                        || fabs(v) > 1.001*limits.max_speed
+                        || fabs(a) > 1.01*limits.max_accel + 1e-6 )
+                {
+                    std::cout << "Trial " << trial << " broke the limits of joint " << k
+                              << " at step " << i << " (position " << p << ", speed " << v
+                              << ", acceleration " << a << ")" << std::endl;
+                    return 3;
+                }
+            }
+        }
+    }
+
+    std::cout << "Planned " << planned << " of 1000 blends" << std::endl;
+    if(planned < 700)
+        return 4;
+
+    return 0;
+}
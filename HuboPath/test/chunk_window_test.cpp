@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "HuboPath/ChunkWindow.hpp"
+#include "HuboPath/TrajectoryReceiver.hpp"
+
+#include <deque>
+#include <map>
+
+using namespace HuboPath;
+
+static const double retransmit_timeout = 0.1;
+
+// A receiver which takes its chunks straight from the test instead of from a channel
+class LocalReceiver : public TrajectoryReceiver
+{
+public:
+    LocalReceiver()
+    {
+        _buffer.resize(HUBO_PATH_CHUNK_MAX_BYTES);
+        _feedback.state = PATH_RX_READ_READY;
+    }
+
+    const hubo_path_rx_t& take(const std::vector<uint8_t>& frame)
+    {
+        memcpy(&_buffer[0], &frame[0], frame.size());
+        if(!_take_chunk())
+            _feedback.state = PATH_RX_DISCONTINUITY;
+        return _feedback;
+    }
+};
+
+struct TransferResult
+{
+    bool finished;
+    size_t retransmits;
+    size_t most_frames;
+};
+
+// Plays out a transfer through a channel of HUBO_PATH_INPUT_FRAME_COUNT frames, where the
+// receiver reads up to reads_per_cycle frames every 10ms and drops[id] copies of chunk id get
+// lost on the way. Returns false if the sender ever lost track of what the channel holds.
+static bool transfer(const PackedTrajectory& packed, std::map<uint32_t, size_t> drops,
+                     size_t reads_per_cycle, TransferResult& result,
+                     double timeout = retransmit_timeout)
+{
+    ChunkWindow window(packed.chunk_count(), timeout);
+    LocalReceiver receiver;
+    std::deque< std::vector<uint8_t> > channel;
+    std::vector<uint8_t> frame(HUBO_PATH_CHUNK_MAX_BYTES);
+
+    result.finished = false;
+    result.most_frames = 0;
+    double now = 0;
+    double last_heard = 0;
+    for(size_t cycle=0; cycle<100000 && !result.finished; ++cycle, now += 0.01)
+    {
+        uint32_t id;
+        bool timed_out = false;
+        while( window.next(now, id) || (timed_out = (now - last_heard >= timeout
+                                                     && window.timed_out(now, id))) )
+        {
+            if(timed_out)
+                last_heard = now;
+
+            if( drops[id] > 0 )
+            {
+                --drops[id];
+            }
+            else
+            {
+                size_t size = packed.write_chunk(id, (hubo_path_chunk_t*)&frame[0]);
+                channel.push_back(std::vector<uint8_t>(frame.begin(), frame.begin()+size));
+            }
+
+            result.most_frames = std::max(result.most_frames, channel.size());
+            // Only a timeout may reach into the frames kept free beyond the window
+            size_t limit = timed_out ? HUBO_PATH_INPUT_FRAME_COUNT-1 : HUBO_PATH_WINDOW_SIZE;
+            if( channel.size() > limit || channel.size() > window.in_flight() )
+            {
+                std::cout << "The channel holds " << channel.size() << " frames, with "
+                          << window.in_flight() << " counted in flight" << std::endl;
+                return false;
+            }
+
+            if(timed_out)
+                break;
+        }
+
+        const hubo_path_rx_t* feedback = NULL;
+        for(size_t r=0; r<reads_per_cycle && !channel.empty(); ++r)
+        {
+            feedback = &receiver.take(channel.front());
+            channel.pop_front();
+        }
+
+        if(NULL == feedback)
+            continue;
+
+        last_heard = now;
+        if( PATH_RX_FINISHED == feedback->state )
+            result.finished = true;
+        else if( PATH_RX_LISTENING == feedback->state )
+            window.acknowledge(*feedback, now);
+        else
+            return false;
+    }
+
+    result.retransmits = window.retransmits();
+    receiver.trajectory().finish_reading();
+    if( !result.finished || !(receiver.trajectory() == packed) )
+    {
+        std::cout << "The trajectory did not arrive intact" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+int main(int, char* [])
+{
+    Trajectory traj;
+    traj.params.frequency = 200;
+    for(size_t j=0; j<40; ++j)
+        traj.claim_joint(j);
+
+    hubo_path_element_t elem;
+    memset(&elem, 0, sizeof(elem));
+    for(size_t i=0; i<20000; ++i)
+    {
+        for(size_t j=0; j<40; ++j)
+            elem.references[j] = sin(0.001*i + j);
+        elem.phase_index = i;
+        traj.push_back(elem);
+    }
+
+    PackedTrajectory packed(traj);
+    uint32_t total = packed.chunk_count();
+    if( total < 3*HUBO_PATH_WINDOW_SIZE )
+    {
+        std::cout << "The trajectory only packs into " << total << " chunks" << std::endl;
+        return 1;
+    }
+
+    // The receiver reports its cumulative acknowledgment along with the chunks past it; only
+    // the gaps below the newest received chunk get resent, once they are old enough
+    ChunkWindow window(total, retransmit_timeout);
+    uint32_t id;
+    for(uint32_t expected=0; expected<HUBO_PATH_WINDOW_SIZE; ++expected)
+    {
+        if( !window.next(0, id) || id != expected )
+        {
+            std::cout << "The window did not open with chunk " << expected << std::endl;
+            return 2;
+        }
+    }
+
+    if( window.next(0, id) )
+    {
+        std::cout << "The window let more than " << HUBO_PATH_WINDOW_SIZE << " frames out"
+                  << std::endl;
+        return 2;
+    }
+
+    hubo_path_rx_t feedback;
+    memset(&feedback, 0, sizeof(feedback));
+    feedback.state = PATH_RX_LISTENING;
+    feedback.expected_size = total;
+    feedback.acked = 2;                                     // 0 and 1 arrived
+    feedback.chunk_id = 7;
+    feedback.received_mask = (0x01 << (4-3)) | (0x01 << (5-3)) | (0x01 << (7-3));
+    if( !window.acknowledge(feedback, retransmit_timeout/2) || window.next(0.05, id) != true
+            || id != 12 )
+    {
+        std::cout << "Gaps were resent before they could have arrived" << std::endl;
+        return 3;
+    }
+
+    // The next report is the same, but by now the gaps at 2, 3, and 6 count as lost. The
+    // receiver has read the frames up to chunk 7, and chunk 12 since, which leaves room for
+    // the three gaps and one new chunk before the window is full.
+    feedback.chunk_id = 12;
+    window.acknowledge(feedback, retransmit_timeout);
+    const uint32_t resend[] = { 2, 3, 6, 13 };
+    for(size_t i=0; i<4; ++i)
+    {
+        if( !window.next(retransmit_timeout, id) || id != resend[i] )
+        {
+            std::cout << "Expected chunk " << resend[i] << " to be sent next, but got "
+                      << id << std::endl;
+            return 3;
+        }
+    }
+
+    if( window.next(retransmit_timeout, id) || window.retransmits() != 3 )
+    {
+        std::cout << "The window sent too much after the gaps were filled" << std::endl;
+        return 3;
+    }
+
+    // A stale report which acknowledges less than before does not bring back any gaps
+    feedback.acked = 1;
+    window.acknowledge(feedback, 1);
+    if( window.next(1, id) && id < 13 )
+    {
+        std::cout << "A stale report made chunk " << id << " get resent" << std::endl;
+        return 3;
+    }
+
+    // After a timeout, the oldest chunk gets resent into the frames kept free, but no further
+    ChunkWindow stalled(total, retransmit_timeout);
+    while( stalled.next(0, id) ) { }
+    size_t resent = 0;
+    while( stalled.timed_out(1, id) )
+    {
+        if( id != 0 )
+            return 4;
+        ++resent;
+    }
+
+    if( resent != HUBO_PATH_INPUT_FRAME_COUNT - 1 - HUBO_PATH_WINDOW_SIZE )
+    {
+        std::cout << "Timeouts resent chunk 0 " << resent << " times" << std::endl;
+        return 4;
+    }
+
+    TransferResult result;
+    if( !transfer(packed, std::map<uint32_t, size_t>(), 100, result) || result.retransmits != 0 )
+    {
+        std::cout << "A clean transfer went wrong" << std::endl;
+        return 5;
+    }
+
+    // Chunks lost in the middle get resent exactly once each, as soon as they are missed
+    std::map<uint32_t, size_t> drops;
+    drops[3] = 1;
+    drops[4] = 1;
+    drops[17] = 1;
+    drops[30] = 1;
+    if( !transfer(packed, drops, 100, result) || result.retransmits != drops.size() )
+    {
+        std::cout << "Losing " << drops.size() << " chunks took " << result.retransmits
+                  << " retransmits" << std::endl;
+        return 6;
+    }
+
+    // Losing the last chunk, and a chunk whose resend gets lost too, needs the timeouts
+    drops[5] = 2;
+    drops[total-1] = 1;
+    if( !transfer(packed, drops, 100, result) )
+        return 7;
+
+    // A receiver which falls behind must never have its frames overwritten
+    if( !transfer(packed, drops, 1, result)
+            || result.most_frames >= HUBO_PATH_INPUT_FRAME_COUNT )
+        return 8;
+
+    // When the receiver is slower than the timeout, a resent chunk is still waiting on the
+    // channel when the next report calls it missing again, so the resends pile up and only
+    // the window keeps them from filling the channel
+    if( !transfer(packed, drops, 1, result, 0.03) || result.retransmits <= 7 )
+    {
+        std::cout << "A receiver slower than the timeout needed " << result.retransmits
+                  << " retransmits" << std::endl;
+        return 9;
+    }
+
+    std::cout << "Transferred " << total << " chunks, with at most " << result.most_frames
+              << " frames on the channel and " << result.retransmits << " retransmits"
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "HuboPath/Trajectory.hpp"
+
+#include <cmath>
+
+using namespace HuboPath;
+
+// Densifies without needing a description to tell the control frequency apart from the input
+class DensifyProbe : public Trajectory
+{
+public:
+    bool densify(double frequency, bool cubic) { return _densify(frequency, cubic); }
+};
+
+static const size_t joints[] = { 2, 9 };
+
+static double waypoint(size_t i, size_t k)
+{
+    return sin(0.7*i + k) + 0.1*i*i;
+}
+
+static void make_waypoints(DensifyProbe& traj, size_t count, double input_frequency)
+{
+    traj.clear();
+    traj.params.frequency = input_frequency;
+    traj.claim_joint(joints[0]);
+    traj.claim_joint(joints[1]);
+
+    hubo_path_element_t elem;
+    memset(&elem, 0, sizeof(elem));
+    for(size_t i=0; i<count; ++i)
+    {
+        elem.references[joints[0]] = waypoint(i, 0);
+        elem.references[joints[1]] = waypoint(i, 1);
+        elem.phase_index = i;
+        traj.push_back(elem);
+    }
+}
+
+static bool same_as_waypoint(const DensifyProbe& traj, size_t step, size_t i)
+{
+    for(size_t k=0; k<2; ++k)
+    {
+        if( fabs(traj[step].references[joints[k]] - waypoint(i, k)) > 1e-12 )
+            return false;
+    }
+    return true;
+}
+
+int main(int, char* [])
+{
+    DensifyProbe traj;
+    for(size_t cubic=0; cubic<2; ++cubic)
+    {
+        // 10Hz up to 200Hz divides evenly: each of the 4 intervals gets 20 steps, plus the end
+        make_waypoints(traj, 5, 10);
+        if( !traj.densify(200, cubic == 1) || traj.size() != 81
+                || traj.params.frequency != 200 || traj.params.interp != HUBO_PATH_RAW )
+        {
+            std::cout << "Densifying 5 waypoints from 10Hz to 200Hz gave " << traj.size()
+                      << " steps instead of 81" << std::endl;
+            return 1;
+        }
+
+        // Both modes pass through every waypoint, and the steps keep the rest of the element
+        for(size_t i=0; i<5; ++i)
+        {
+            if( !same_as_waypoint(traj, 20*i, i) || traj[20*i].phase_index != i )
+            {
+                std::cout << "Step " << 20*i << " missed waypoint " << i
+                          << (cubic == 1 ? " with" : " without") << " cubic curves" << std::endl;
+                return 2;
+            }
+        }
+
+        if(cubic == 0)
+        {
+            // Halfway between two waypoints lies halfway along the straight line
+            double expected = 0.5*(waypoint(1, 0) + waypoint(2, 0));
+            if( fabs(traj[30].references[joints[0]] - expected) > 1e-12 )
+            {
+                std::cout << "Linear densification left the straight line" << std::endl;
+                return 3;
+            }
+        }
+        else
+        {
+            // The velocity is continuous through the waypoints, so the steps on either side of
+            // one are about as far from it as each other
+            double before = traj[39].references[joints[0]] - traj[40].references[joints[0]];
+            double after = traj[41].references[joints[0]] - traj[40].references[joints[0]];
+            if( fabs(before + after) > 1e-3 )
+            {
+                std::cout << "Cubic densification has a kink at a waypoint" << std::endl;
+                return 3;
+            }
+        }
+
+        // 30Hz up to 200Hz does not divide evenly: 4 intervals last 2/15s, so steps land at
+        // 0 through 26 of 200Hz, and the final waypoint gets appended as step 27
+        make_waypoints(traj, 5, 30);
+        if( !traj.densify(200, cubic == 1) || traj.size() != 28 )
+        {
+            std::cout << "Densifying 5 waypoints from 30Hz to 200Hz gave " << traj.size()
+                      << " steps instead of 28" << std::endl;
+            return 4;
+        }
+
+        if( !same_as_waypoint(traj, 0, 0) || !same_as_waypoint(traj, 27, 4)
+                || traj[27].phase_index != 4 )
+        {
+            std::cout << "The uneven densification lost an end waypoint" << std::endl;
+            return 5;
+        }
+
+        // Step 20 sits exactly on waypoint 3, since 20 steps of 0.15 intervals make 3
+        if(!same_as_waypoint(traj, 20, 3))
+        {
+            std::cout << "The uneven densification missed waypoint 3" << std::endl;
+            return 5;
+        }
+    }
+
+    std::cout << "Densification keeps its waypoints in both modes" << std::endl;
+    return 0;
+}
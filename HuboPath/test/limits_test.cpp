@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "HuboPath/Trajectory.hpp"
+
+#include <cstdlib>
+
+static const double frequency = 100;
+
+// The joints are spread out, so the checks have to skip the inactive ones in the middle
+static const size_t active[] = { 3, 4, 7, 12 };
+static const size_t active_count = sizeof(active)/sizeof(active[0]);
+static const size_t idle_joint = 5;
+
+// Trajectories cannot be copied (their descriptions own their joints), so each case gets
+// built from scratch
+static void make_trajectory(HuboPath::Trajectory& traj, size_t steps)
+{
+    traj.clear();
+    traj.params.frequency = frequency;
+    traj.params.use_custom_limits = 1;
+    for(size_t k=0; k<active_count; ++k)
+    {
+        hubo_joint_limits_t& limits = traj.params.limits[active[k]];
+        limits.min_position = -1;
+        limits.max_position = 1;
+        limits.max_speed = 1;
+        limits.max_accel = 10;
+        traj.claim_joint(active[k]);
+    }
+
+    hubo_path_element_t elem;
+    memset(&elem, 0, sizeof(elem));
+    for(size_t i=0; i<steps; ++i)
+    {
+        for(size_t k=0; k<active_count; ++k)
+            elem.references[active[k]] = 0.5*sin(0.5*i/frequency + k);
+        elem.references[idle_joint] = 100; // Far outside of any limit, but not active
+        traj.push_back(elem);
+    }
+}
+
+// Shifts a joint so that its farthest reference in the direction of peak lands on peak
+static void offset_peak(HuboPath::Trajectory& traj, size_t joint, double peak)
+{
+    double farthest = 0;
+    for(size_t i=0; i<traj.size(); ++i)
+    {
+        double q = traj.elements[i].references[joint];
+        if( peak > 0 ? q > farthest : q < farthest )
+            farthest = q;
+    }
+
+    for(size_t i=0; i<traj.size(); ++i)
+        traj.elements[i].references[joint] += peak - farthest;
+}
+
+// Checks every joint of every element the slow way
+static bool naive_within_limits(const HuboPath::Trajectory& traj, bool check_accel)
+{
+    const double eps = 1e-6;
+    for(size_t i=0; i<traj.size(); ++i)
+    {
+        for(size_t k=0; k<active_count; ++k)
+        {
+            size_t j = active[k];
+            const hubo_joint_limits_t& limits = traj.params.limits[j];
+            double q = traj.elements[i].references[j];
+            if( !(q == q) || q > limits.max_position + eps || q < limits.min_position - eps )
+                return false;
+
+            if( i == 0 )
+                continue;
+
+            double q_last = traj.elements[i-1].references[j];
+            if( fabs(q - q_last)*frequency > limits.max_speed + eps )
+                return false;
+
+            if( !check_accel || i+1 == traj.size() )
+                continue;
+
+            double q_next = traj.elements[i+1].references[j];
+            if( fabs(q_next - 2*q + q_last)*frequency*frequency > limits.max_accel + eps )
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static bool expect(const HuboPath::Trajectory& traj, bool check_accel, bool verdict,
+                   const std::string& description)
+{
+    if( traj.within_limits(check_accel) != verdict
+            || traj.check_limits(check_accel, false) != verdict )
+    {
+        std::cout << "Expected " << description << " to be "
+                  << (verdict ? "within" : "outside of") << " the limits" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+int main(int, char* [])
+{
+    HuboPath::Trajectory traj;
+    make_trajectory(traj, 500);
+    if(!expect(traj, true, true, "a smooth trajectory"))
+        return 1;
+
+    // Offsets which only break the position limits, right around the peaks
+    make_trajectory(traj, 500);
+    offset_peak(traj, active[2], 1.0001);
+    if(!expect(traj, false, false, "a position past its maximum"))
+        return 2;
+
+    make_trajectory(traj, 500);
+    offset_peak(traj, active[3], -1.0001);
+    if(!expect(traj, false, false, "a position past its minimum"))
+        return 3;
+
+    make_trajectory(traj, 500);
+    traj.elements[0].references[active[0]] = std::numeric_limits<double>::quiet_NaN();
+    if(!expect(traj, false, false, "a NaN in the first element"))
+        return 4;
+
+    // A jump which only breaks the speed limit in the last element
+    make_trajectory(traj, 500);
+    traj.elements[499].references[active[1]] += 0.02;
+    if(!expect(traj, false, false, "a jump in speed"))
+        return 5;
+
+    // A kink of 0.002 per step changes the speed by 0.2, which stays under the speed limit,
+    // but it accelerates at 20
+    make_trajectory(traj, 500);
+    for(size_t i=300; i<500; ++i)
+        traj.elements[i].references[active[0]] += 0.002*(i-299);
+    if(!expect(traj, false, true, "a kink when acceleration is not enforced")
+            || !expect(traj, true, false, "a kink when acceleration is enforced"))
+        return 6;
+
+    make_trajectory(traj, 500);
+    traj.elements[250].references[idle_joint] = std::numeric_limits<double>::quiet_NaN();
+    if(!expect(traj, true, true, "a NaN in an inactive joint"))
+        return 7;
+
+    // The screen and the exact check must come to the same verdict as checking everything
+    srand48(11);
+    for(size_t trial=0; trial<2000; ++trial)
+    {
+        make_trajectory(traj, 50);
+        size_t i = lrand48() % traj.size();
+        size_t j = active[lrand48() % active_count];
+        traj.elements[i].references[j] += (2*drand48() - 1)*0.04;
+        for(size_t check_accel=0; check_accel<2; ++check_accel)
+        {
+            bool expected = naive_within_limits(traj, check_accel == 1);
+            if( traj.within_limits(check_accel == 1) != expected )
+            {
+                std::cout << "Trial " << trial << " should have been "
+                          << (expected ? "within" : "outside of") << " the limits" << std::endl;
+                return 8;
+            }
+        }
+    }
+
+    std::cout << "The limit checks agree with the naive check" << std::endl;
+    return 0;
+}
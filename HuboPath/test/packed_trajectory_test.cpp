@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "HuboPath/PackedTrajectory.hpp"
+
+#include <sstream>
+
+int main(int, char* [])
+{
+    HuboPath::Trajectory traj;
+    traj.params.frequency = 1000;
+    traj.params.use_custom_limits = 1;
+
+    for(size_t j=0; j<6; ++j)
+    {
+        traj.claim_joint(j+2);
+        traj.params.limits[j+2].max_speed = j+1;
+    }
+
+    hubo_path_element_t elem;
+    memset(&elem, 0, sizeof(elem));
+    for(size_t i=0; i<60000; ++i)
+    {
+        for(size_t j=0; j<6; ++j)
+            elem.references[j+2] = sin(0.001*i + j);
+        elem.phase_index = i/1000;
+        traj.push_back(elem);
+    }
+
+    HuboPath::PackedTrajectory packed(traj);
+    std::cout << "Packed " << traj.size() << " steps of " << packed.joint_count() << " joints into "
+              << packed.chunk_count() << " chunks of up to " << packed.chunk_capacity()
+              << " steps" << std::endl;
+
+    // Send the chunks in reverse, to make sure the order does not matter
+    std::vector<uint8_t> buffer(HUBO_PATH_CHUNK_MAX_BYTES);
+    hubo_path_chunk_t* chunk = (hubo_path_chunk_t*)&buffer[0];
+    HuboPath::PackedTrajectory received;
+    size_t bytes = 0;
+    for(uint32_t i=packed.chunk_count(); i > 0; --i)
+    {
+        bytes += packed.write_chunk(i-1, chunk);
+        HuboCan::error_result_t result = received.read_chunk(chunk);
+        if(result != HuboCan::OKAY)
+        {
+            std::cout << "Failed to read chunk " << i-1 << ": " << result << std::endl;
+            return 1;
+        }
+    }
+    received.finish_reading();
+
+    std::cout << "Transmitted " << bytes << " bytes instead of "
+              << traj.size()*sizeof(hubo_path_element_t) << std::endl;
+
+    HuboPath::Trajectory unpacked;
+    received.unpack(unpacked);
+    if(unpacked.size() != traj.size() || unpacked.params.bitmap != traj.params.bitmap)
+    {
+        std::cout << "Size mismatch! " << unpacked.size() << " : " << traj.size() << std::endl;
+        return 2;
+    }
+
+    for(size_t j=0; j<6; ++j)
+    {
+        if(unpacked.params.limits[j+2].max_speed != traj.params.limits[j+2].max_speed)
+        {
+            std::cout << "Limits of joint " << j+2 << " did not survive!" << std::endl;
+            return 3;
+        }
+    }
+
+    double max_error = 0;
+    for(size_t i=0; i<traj.size(); ++i)
+    {
+        if(unpacked[i].phase_index != traj[i].phase_index)
+        {
+            std::cout << "Phase index mismatch at step " << i << std::endl;
+            return 4;
+        }
+
+        for(size_t j=0; j<HUBO_PATH_JOINT_MAX_SIZE; ++j)
+            max_error = std::max(max_error, fabs(unpacked[i].references[j] - traj[i].references[j]));
+    }
+
+    std::cout << "Largest reference error: " << max_error << std::endl;
+    if(max_error > 1e-6)
+        return 5;
+
+    // Saving and loading (as the trajectory cache does) must give back exactly the same thing
+    std::stringstream saved;
+    HuboPath::PackedTrajectory loaded;
+    if(!received.write(saved) || !loaded.read(saved) || !(loaded == received))
+    {
+        std::cout << "The trajectory did not survive being saved and loaded!" << std::endl;
+        return 6;
+    }
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "HuboPath/TrajectoryCache.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace HuboPath;
+
+// Gives access to the entries by key, so that hash collisions can be made on purpose
+class KeyedCache : public TrajectoryCache
+{
+public:
+    KeyedCache(size_t capacity=8, const std::string& directory="")
+        : TrajectoryCache(capacity, directory) { }
+
+    void store_under(uint64_t key, const std::string& signature, const PackedTrajectory& result)
+    {
+        _insert(key, signature).trajectory = result;
+        _save_file(key, signature, result);
+    }
+
+    bool in_memory(uint64_t key, const std::string& signature)
+    {
+        return _find(key, signature) != NULL;
+    }
+
+    bool on_disk(uint64_t key, const std::string& signature)
+    {
+        PackedTrajectory loaded;
+        return _load_file(key, signature, loaded);
+    }
+
+    std::string file_name(uint64_t key) const { return _file_name(key); }
+};
+
+static PackedTrajectory make_trajectory(double offset)
+{
+    Trajectory traj;
+    traj.params.frequency = 200;
+    traj.claim_joint(1);
+    traj.claim_joint(4);
+
+    hubo_path_element_t elem;
+    memset(&elem, 0, sizeof(elem));
+    for(size_t i=0; i<100; ++i)
+    {
+        elem.references[1] = offset + 0.01*i;
+        elem.references[4] = offset - 0.01*i;
+        traj.push_back(elem);
+    }
+
+    return PackedTrajectory(traj);
+}
+
+int main(int, char* [])
+{
+    std::vector<PackedTrajectory> trajectories;
+    std::vector<std::string> signatures;
+    for(size_t i=0; i<4; ++i)
+    {
+        trajectories.push_back(make_trajectory(i));
+        signatures.push_back(std::string("signature ") + (char)('A' + i));
+    }
+
+    // The least recently used entry is the one which makes room, and fetching counts as a use
+    TrajectoryCache cache(3);
+    for(size_t i=0; i<3; ++i)
+        cache.store(signatures[i], trajectories[i]);
+
+    PackedTrajectory fetched;
+    if( !cache.fetch(signatures[0], fetched) || !(fetched == trajectories[0]) )
+    {
+        std::cout << "The first entry could not be fetched" << std::endl;
+        return 1;
+    }
+
+    cache.store(signatures[3], trajectories[3]);
+    if( cache.size() != 3 || cache.fetch(signatures[1], fetched) )
+    {
+        std::cout << "The least recently used entry was not the one evicted" << std::endl;
+        return 1;
+    }
+
+    for(size_t i=0; i<4; ++i)
+    {
+        if( i != 1 && (!cache.fetch(signatures[i], fetched) || !(fetched == trajectories[i])) )
+        {
+            std::cout << "Entry " << i << " should have stayed in the cache" << std::endl;
+            return 1;
+        }
+    }
+
+    // The last fetch made entry 3 the most recent, so it alone survives a smaller capacity
+    cache.set_capacity(1);
+    if( cache.size() != 1 || !cache.fetch(signatures[3], fetched)
+            || cache.fetch(signatures[0], fetched) )
+    {
+        std::cout << "Shrinking the cache kept the wrong entry" << std::endl;
+        return 1;
+    }
+
+    char directory_template[] = "/tmp/trajectory_cache_testXXXXXX";
+    if(NULL == mkdtemp(directory_template))
+    {
+        std::cout << "Could not make a directory for the cache" << std::endl;
+        return 2;
+    }
+    const std::string directory = directory_template;
+
+    // An entry must never be handed out for a different signature which shares its hash,
+    // whether it is held in memory or on disk
+    const uint64_t shared_key = 42;
+    KeyedCache keyed(4, directory);
+    keyed.store_under(shared_key, signatures[0], trajectories[0]);
+    if( keyed.in_memory(shared_key, signatures[1]) || keyed.on_disk(shared_key, signatures[1]) )
+    {
+        std::cout << "An entry was used for a signature which only shares its hash" << std::endl;
+        return 3;
+    }
+
+    if( !keyed.in_memory(shared_key, signatures[0]) || !keyed.on_disk(shared_key, signatures[0]) )
+    {
+        std::cout << "The colliding lookup lost the original entry" << std::endl;
+        return 3;
+    }
+
+    // The newer of two colliding signatures replaces the older one
+    keyed.store_under(shared_key, signatures[1], trajectories[1]);
+    if( keyed.size() != 1 || keyed.in_memory(shared_key, signatures[0])
+            || !keyed.in_memory(shared_key, signatures[1]) )
+    {
+        std::cout << "The newer colliding entry did not replace the older one" << std::endl;
+        return 3;
+    }
+
+    // A fresh cache finds whatever an earlier one saved in the same directory
+    {
+        TrajectoryCache saving(4, directory);
+        saving.store(signatures[2], trajectories[2]);
+        saving.store(signatures[3], trajectories[3]);
+    }
+
+    TrajectoryCache reloaded(4, directory);
+    if( reloaded.size() != 0 || !reloaded.fetch(signatures[2], fetched)
+            || !(fetched == trajectories[2]) || reloaded.size() != 1 )
+    {
+        std::cout << "A fresh cache could not reload an entry from the directory" << std::endl;
+        return 4;
+    }
+
+    TrajectoryCache disk_only(0, directory);
+    if( !disk_only.fetch(signatures[3], fetched) || !(fetched == trajectories[3])
+            || disk_only.size() != 0 || disk_only.fetch(signatures[0], fetched) )
+    {
+        std::cout << "A cache without any memory did not read through to the directory"
+                  << std::endl;
+        return 4;
+    }
+
+    remove(keyed.file_name(shared_key).c_str());
+    for(size_t i=2; i<4; ++i)
+        remove(keyed.file_name(TrajectoryCache::hash(signatures[i])).c_str());
+    rmdir(directory.c_str());
+
+    std::cout << "The trajectory cache evicts, rejects, and reloads its entries correctly"
+              << std::endl;
+    return 0;
+}
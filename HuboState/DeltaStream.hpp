@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HUBOSTATE_DELTASTREAM_HPP
+#define HUBOSTATE_DELTASTREAM_HPP
+
+extern "C" {
+#include "hubo_delta_c.h"
+}
+
+#include "State.hpp"
+
+#include <vector>
+
+namespace HuboState {
+
+typedef std::vector<uint8_t> ByteArray;
+
+/*!
+ * \brief Quantized copy of one kind of sensor data, used as the reference for differences
+ */
+typedef struct delta_reference {
+    size_t count;
+    std::vector<int64_t> values;
+    ByteArray blobs;
+} delta_reference_t;
+
+/*!
+ * \class DeltaEncoder
+ * \brief Compresses State messages into keyframes and quantized differences
+ *
+ * See hubo_delta_c.h for the message format. A keyframe is sent every keyframe_interval frames,
+ * or whenever a difference frame would be no smaller than a keyframe.
+ */
+class DeltaEncoder
+{
+public:
+
+    DeltaEncoder(size_t keyframe_interval = 100);
+
+    /*!
+     * \fn encode(const State& state, ByteArray& message)
+     * \brief Encode the current contents of state into message
+     * \return The number of bytes in the message
+     *
+     * message is only ever grown, so reusing the same ByteArray for every cycle avoids any
+     * allocation after the first few cycles.
+     */
+    size_t encode(const State& state, ByteArray& message);
+
+    /*!
+     * \fn request_keyframe()
+     * \brief Make the next message a keyframe
+     */
+    inline void request_keyframe() { _force_keyframe = true; }
+
+    size_t keyframe_interval;
+
+protected:
+
+    size_t _encode(const State& state, ByteArray& message, bool keyframe);
+
+    uint32_t _sequence;
+    uint32_t _keyframe;
+    size_t _since_keyframe;
+    size_t _keyframe_size;
+    bool _force_keyframe;
+
+    delta_reference_t _joints;
+    delta_reference_t _imus;
+    delta_reference_t _fts;
+    ByteArray _scratch;
+};
+
+/*!
+ * \class DeltaDecoder
+ * \brief Reconstructs State messages from a DeltaEncoder
+ */
+class DeltaDecoder
+{
+public:
+
+    DeltaDecoder();
+
+    /*!
+     * \fn decode(const uint8_t* message, size_t size, State& state)
+     * \brief Decode a message into the sensor data of state
+     * \return HuboCan::OKAY if state now contains the data of the message.
+     *
+     * Difference frames cannot be decoded until the keyframe that they refer to has arrived. In
+     * that case, HuboCan::SYNCH_ERROR is returned and state is left untouched.
+     */
+    HuboCan::error_result_t decode(const uint8_t* message, size_t size, State& state);
+
+    /*!
+     * \fn get_time()
+     * \brief Timestamp of the last successfully decoded message
+     */
+    inline double get_time() const { return _time; }
+
+    inline bool synchronized() const { return _synchronized; }
+
+protected:
+
+    bool _synchronized;
+    uint32_t _keyframe;
+    double _time;
+
+    delta_reference_t _joints;
+    delta_reference_t _imus;
+    delta_reference_t _fts;
+};
+
+} // namespace HuboState
+
+#endif // HUBOSTATE_DELTASTREAM_HPP
@@ -323,6 +323,12 @@ public:
         }
         _names = names;
 
+        if(_double_buffered)
+        {
+            free(_front_data);
+            _front_data = initialize_data<DataClass>(names.size());
+        }
+
         _channel_name = channel_name;
         ach_status_t r = ach_open(&_channel, channel_name.c_str(), NULL);
         if( ACH_OK == r )
@@ -395,6 +401,12 @@ public:
     {
         if(!_check_initialized("send_data"))
             return false;
+
+        if(_double_buffered)
+        {
+            swap_buffers(timestamp);
+            return send_front();
+        }
         
         set_data_timestamp(_raw_data, timestamp);
         
@@ -409,6 +421,86 @@ public:
         return false;
     }
 
+    /*!
+     * \fn set_double_buffered(bool enable)
+     * \brief Give this HuboData a separate front buffer for publishing
+     *
+     * When double buffering is enabled, all access through operator[] goes to the back buffer,
+     * while send_front() only ever sends the front buffer. swap_buffers() turns the back buffer
+     * into the new front buffer, so a publication can never contain a mix of two cycles, even
+     * if the back buffer gets modified while the front buffer is being sent.
+     *
+     * This is meant for the process which publishes the data. Processes which only receive data
+     * have no use for it.
+     */
+    void set_double_buffered(bool enable)
+    {
+        if(enable == _double_buffered)
+            return;
+
+        _double_buffered = enable;
+        free(_front_data);
+        _front_data = NULL;
+
+        if(_double_buffered && _raw_data != NULL)
+        {
+            _front_data = initialize_data<DataClass>(size());
+            memcpy(_front_data, _raw_data, get_data_size<DataClass>(_raw_data));
+        }
+    }
+
+    bool is_double_buffered() const { return _double_buffered; }
+
+    /*!
+     * \fn swap_buffers(double timestamp)
+     * \brief Stamp the back buffer and make it the front buffer
+     * \return False if double buffering is not enabled
+     *
+     * The contents of the new front buffer are carried over into the new back buffer, so entries
+     * which do not get refreshed every cycle keep their latest values.
+     */
+    bool swap_buffers(double timestamp)
+    {
+        if(!_double_buffered || NULL == _front_data || NULL == _raw_data)
+            return false;
+
+        set_data_timestamp(_raw_data, timestamp);
+
+        hubo_data* front = _raw_data;
+        _raw_data = _front_data;
+        _front_data = front;
+
+        memcpy(_raw_data, _front_data, get_data_size<DataClass>(_front_data));
+        return true;
+    }
+
+    /*!
+     * \fn send_front()
+     * \brief Publish the front buffer as it was at the last swap_buffers()
+     */
+    bool send_front()
+    {
+        if(!_check_initialized("send_front"))
+            return false;
+
+        if(!_double_buffered || NULL == _front_data)
+        {
+            std::cout << "[HuboData::send_front] Double buffering is not enabled for channel '"
+                      << _channel_name << "'!" << std::endl;
+            return false;
+        }
+
+        ach_status_t r = ach_put(&_channel, _front_data, get_data_size<DataClass>(_front_data));
+
+        if(ACH_OK == r)
+            return true;
+
+        std::cout << "[HuboData::send_front] Unexpected ach_put result for channel '"
+                  << _channel_name << "'. Check error log for more info" << std::endl;
+        report_ach_errors(r, "HuboData::send_front", "ach_put", _channel_name.c_str());
+        return false;
+    }
+
     std::vector<DataClass> get_data(bool refresh = false)
     {
         if(!_check_initialized("get_data"))
@@ -460,6 +552,7 @@ public:
     ~HuboData()
     {
         free(_raw_data);
+        free(_front_data);
     }
 
     std::string get_channel_name() const { return _channel_name; }
@@ -478,6 +571,8 @@ protected:
     void _construction()
     {
         _raw_data = NULL;
+        _front_data = NULL;
+        _double_buffered = false;
         memset(&_channel, 0, sizeof(ach_channel_t));
         _initialized = false;
         verbose = false;
@@ -505,6 +600,8 @@ protected:
     }
 
     bool _initialized;
+    bool _double_buffered;
+    hubo_data* _front_data;
     StringMap _mapping;
     std::vector<std::string> _names;
     std::string _channel_name;
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HUBOSTATE_IMUESTIMATOR_HPP
+#define HUBOSTATE_IMUESTIMATOR_HPP
+
+extern "C" {
+#include "hubo_sensor_c.h"
+}
+
+#include <vector>
+#include <stddef.h>
+
+namespace HuboState {
+
+/*!
+ * \class ImuEstimator
+ * \brief Complementary filter which fuses IMU angular rates with the absolute angle readings
+ *
+ * Every time a new IMU reading arrives, the previous estimate is propagated forward by the
+ * measured angular velocity over the real time since the last reading, and is then pulled
+ * toward the measured (accelerometer-based) angle with a weight determined by the time constant.
+ * Short time constants trust the angle measurement more; long time constants trust the rate
+ * measurement more.
+ *
+ * A time constant of zero disables the fusion, so the estimate simply follows the measured angle.
+ */
+class ImuEstimator
+{
+public:
+
+    ImuEstimator(size_t imu_count = 0, double time_constant = 0.5);
+
+    void resize(size_t imu_count);
+    void reset();
+
+    void set_time_constant(double seconds);
+    inline double get_time_constant() const { return _time_constant; }
+
+    /*!
+     * \fn update(size_t imu_index, hubo_imu_state_t& imu, double sample_time)
+     * \brief Fuse a new reading into the estimate and write it into imu.estimated_position
+     * \param imu_index
+     * \param imu Raw reading, whose estimated_position gets filled in
+     * \param sample_time Time (in seconds, CLOCK_MONOTONIC) at which the reading arrived
+     * \return False if the imu_index is out of bounds
+     */
+    bool update(size_t imu_index, hubo_imu_state_t& imu, double sample_time);
+
+    inline size_t size() const { return _imus.size(); }
+
+protected:
+
+    typedef struct imu_estimate {
+        double angle[3];
+        double time;
+        bool initialized;
+    } imu_estimate_t;
+
+    std::vector<imu_estimate_t> _imus;
+    double _time_constant;
+};
+
+} // namespace HuboState
+
+#endif // HUBOSTATE_IMUESTIMATOR_HPP
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HUBOSTATE_JOINTESTIMATOR_HPP
+#define HUBOSTATE_JOINTESTIMATOR_HPP
+
+#include <vector>
+#include <stddef.h>
+
+namespace HuboState {
+
+/*!
+ * \class JointEstimator
+ * \brief Estimates joint velocities and accelerations from timestamped encoder readings
+ *
+ * Each new reading is differentiated against the previous reading of the same joint using the
+ * actual time between the two samples (not the nominal control period), and the result is passed
+ * through a first-order low-pass filter whose smoothing factor is also computed from that time
+ * difference. Acceleration is estimated the same way from the filtered velocity.
+ *
+ * A cutoff frequency of zero disables the corresponding filter, leaving the raw finite
+ * difference.
+ */
+class JointEstimator
+{
+public:
+
+    JointEstimator(size_t joint_count = 0,
+                   double velocity_cutoff_hz = 20,
+                   double acceleration_cutoff_hz = 10);
+
+    /*!
+     * \fn resize(size_t joint_count)
+     * \brief Change the number of joints being estimated. This also resets every estimate.
+     */
+    void resize(size_t joint_count);
+
+    /*!
+     * \fn reset()
+     * \brief Forget all previous readings, e.g. after a joint gets homed
+     */
+    void reset();
+    void reset(size_t joint_index);
+
+    void set_velocity_cutoff(double cutoff_hz);
+    void set_acceleration_cutoff(double cutoff_hz);
+    inline double get_velocity_cutoff() const { return _velocity_cutoff; }
+    inline double get_acceleration_cutoff() const { return _acceleration_cutoff; }
+
+    /*!
+     * \fn update(size_t joint_index, double position, double sample_time,
+     *            double& velocity, double& acceleration)
+     * \brief Feed in a new encoder reading
+     * \param joint_index
+     * \param position
+     * \param sample_time Time (in seconds, CLOCK_MONOTONIC) at which the reading arrived
+     * \param velocity Filled with the new velocity estimate
+     * \param acceleration Filled with the new acceleration estimate
+     * \return False if the joint_index is out of bounds
+     *
+     * Readings whose sample_time is not newer than the previous reading are ignored, and the
+     * previous estimates are returned instead.
+     */
+    bool update(size_t joint_index, double position, double sample_time,
+                double& velocity, double& acceleration);
+
+    inline size_t size() const { return _joints.size(); }
+
+protected:
+
+    typedef struct joint_estimate {
+        double position;
+        double velocity;
+        double acceleration;
+        double time;
+        unsigned int samples;
+    } joint_estimate_t;
+
+    static double _smoothing(double cutoff_hz, double dt);
+
+    std::vector<joint_estimate_t> _joints;
+    double _velocity_cutoff;
+    double _acceleration_cutoff;
+};
+
+} // namespace HuboState
+
+#endif // HUBOSTATE_JOINTESTIMATOR_HPP
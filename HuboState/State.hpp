@@ -44,6 +44,8 @@ extern "C" {
 #include "HuboCan/HuboDescription.hpp"
 
 #include "HuboData.hpp"
+#include "JointEstimator.hpp"
+#include "ImuEstimator.hpp"
 
 namespace HuboState {
 
@@ -145,10 +147,70 @@ public:
      */
     virtual HuboCan::error_result_t publish();
 
+    /*!
+     * \fn set_double_buffered(bool enable)
+     * \brief Have the device decoders write into a back buffer which only gets published at
+     * the end of each cycle
+     *
+     * With double buffering, publish() first calls swap_buffers() and then publish_front(). The
+     * two can also be called separately, e.g. to let another thread publish the front buffers
+     * while the next cycle is already being decoded into the back buffers.
+     */
+    void set_double_buffered(bool enable);
+    inline bool is_double_buffered() const { return _double_buffered; }
+
+    /*!
+     * \fn swap_buffers()
+     * \brief Stamp every back buffer with the current time and turn them into front buffers
+     * \return The timestamp that was used
+     */
+    double swap_buffers();
+
+    /*!
+     * \fn publish_front()
+     * \brief Broadcast the front buffers from the last swap_buffers()
+     */
+    HuboCan::error_result_t publish_front();
+
     HuboData<hubo_joint_state_t>    joints;
     HuboData<hubo_imu_state_t>      imus;
     HuboData<hubo_ft_state_t>       force_torques;
 
+    /*!
+     * \fn set_joint_position(size_t joint_index, double position, double sample_time)
+     * \brief Record a new encoder reading for a joint
+     * \param joint_index
+     * \param position
+     * \param sample_time Time (in seconds, CLOCK_MONOTONIC) at which the reading arrived
+     *
+     * This sets the position of the joint and updates its velocity and acceleration estimates
+     * using joint_estimator. It is meant to be used by the device decoders in the pump process.
+     */
+    void set_joint_position(size_t joint_index, double position, double sample_time);
+
+    /*!
+     * \brief Filter used to estimate the velocity and acceleration of each joint. Its cutoff
+     * frequencies can be adjusted by the pump process.
+     */
+    JointEstimator joint_estimator;
+
+    /*!
+     * \fn estimate_imu(size_t imu_index, double sample_time)
+     * \brief Fuse the latest raw reading of an IMU into its estimated_position
+     * \param imu_index
+     * \param sample_time Time (in seconds, CLOCK_MONOTONIC) at which the reading arrived
+     *
+     * This is meant to be called by the IMU decoders in the pump process right after they
+     * fill in imus[imu_index].
+     */
+    void estimate_imu(size_t imu_index, double sample_time);
+
+    /*!
+     * \brief Complementary filter for the IMUs. Its time constant can be adjusted (or set to
+     * zero to disable fusion) by the pump process.
+     */
+    ImuEstimator imu_estimator;
+
     /*!
      * \fn get_time()
      * \brief Returns the timestamp of the latest joint data
@@ -172,6 +234,7 @@ public:
 protected:
 
     bool _initialized;
+    bool _double_buffered;
 //    bool _channels_opened;
 
     virtual void _initialize();
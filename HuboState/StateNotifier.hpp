@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HUBOSTATE_STATENOTIFIER_HPP
+#define HUBOSTATE_STATENOTIFIER_HPP
+
+extern "C" {
+#include <poll.h>
+#include "hubo_sensor_c.h"
+}
+
+#include "HuboCan/InfoTypes.hpp"
+
+#include <vector>
+#include <string>
+
+namespace HuboState {
+
+/*!
+ * \class StateNotifier
+ * \brief Wakes up every StateListener once per control cycle.
+ *
+ * The process which publishes the State (the CAN interface or the virtual interface) owns one
+ * StateNotifier and calls notify() immediately after State::publish(). Each StateListener hands
+ * the notifier an eventfd over a local socket, and notify() bumps every registered eventfd, so
+ * listeners can put the eventfd into their own epoll/select loop (or a QSocketNotifier) instead
+ * of parking a thread inside ach_get.
+ *
+ * notify() never blocks: new listeners are accepted and dead listeners are dropped on the fly
+ * with non-blocking calls, so it is safe to use inside the real-time loop.
+ */
+class StateNotifier
+{
+public:
+
+    StateNotifier(const std::string& socket_name = HUBO_STATE_NOTIFY_SOCKET);
+    ~StateNotifier();
+
+    /*!
+     * \fn open()
+     * \brief Start accepting listeners
+     * \return True if the notification socket could be bound
+     */
+    bool open();
+
+    /*!
+     * \fn notify()
+     * \brief Signal every listener that a new State has been published
+     * \return Number of listeners which were signaled
+     */
+    size_t notify();
+
+    inline bool is_open() const { return _socket >= 0; }
+    inline size_t listener_count() const { return _listeners.size(); }
+
+protected:
+
+    typedef struct listener {
+        int connection;
+        int event;
+    } listener_t;
+
+    void _accept_listeners();
+    void _check_listeners();
+    void _drop_listener(size_t index);
+    void _close();
+
+    int _socket;
+    std::string _socket_name;
+    std::vector<listener_t> _listeners;
+    std::vector<struct pollfd> _polls;
+
+    StateNotifier(const StateNotifier& doNotCopy);
+    StateNotifier& operator=(const StateNotifier& doNotCopy);
+};
+
+/*!
+ * \class StateListener
+ * \brief Receives one wake-up per published State from a StateNotifier.
+ *
+ * Put fd() into any poll/select/epoll set (or a QSocketNotifier). When it becomes readable, call
+ * acknowledge() to clear it, and then State::update(0) to grab the new data without waiting.
+ */
+class StateListener
+{
+public:
+
+    StateListener(bool connect_now = true,
+                  const std::string& socket_name = HUBO_STATE_NOTIFY_SOCKET);
+    ~StateListener();
+
+    /*!
+     * \fn connect(bool verbose)
+     * \brief Register with the StateNotifier of the interface process
+     * \param verbose Print the reason if the registration fails
+     * \return True if the registration was sent
+     *
+     * If the interface restarts, the registration is lost. You can check for this with
+     * connected() and call connect() again.
+     */
+    bool connect(bool verbose = true);
+
+    /*!
+     * \fn connected()
+     * \brief Indicates whether the notifier is still holding our registration
+     */
+    bool connected();
+
+    /*!
+     * \fn fd()
+     * \brief The eventfd which becomes readable whenever a new State is published
+     * \return -1 if this listener could not allocate an eventfd
+     */
+    inline int fd() const { return _event; }
+
+    /*!
+     * \fn acknowledge()
+     * \brief Clear the pending notification
+     * \return The number of cycles which were published since the last acknowledgement. If this
+     * is greater than 1, you have missed cycles.
+     */
+    uint64_t acknowledge();
+
+    /*!
+     * \fn wait(double timeout_sec)
+     * \brief Block until the next State is published
+     * \param timeout_sec
+     * \return HuboCan::TIMEOUT if nothing was published in time
+     *
+     * This is a convenience for programs that do not have their own event loop. The number of
+     * cycles since the last call can be found with last_count().
+     */
+    HuboCan::error_result_t wait(double timeout_sec = 1);
+
+    inline uint64_t last_count() const { return _last_count; }
+
+protected:
+
+    void _disconnect();
+
+    int _connection;
+    int _event;
+    uint64_t _last_count;
+    std::string _socket_name;
+
+    StateListener(const StateListener& doNotCopy);
+    StateListener& operator=(const StateListener& doNotCopy);
+};
+
+} // namespace HuboState
+
+#endif // HUBOSTATE_STATENOTIFIER_HPP
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HUBOSTATE_HUBO_DELTA_C_H
+#define HUBOSTATE_HUBO_DELTA_C_H
+
+#include <stdint.h>
+
+#include "hubo_sensor_c.h"
+
+#define HUBO_DELTA_CHANNEL "hubo_state_delta"
+
+/*                              123456789012345                       */
+#define HUBO_DELTA_HEADER_CODE "DELTAHEADR_0.01"
+#define HUBO_DELTA_HEADER_CODE_SIZE 16 /* including null-terminator \0 */
+
+typedef enum hubo_delta_frame {
+
+    HUBO_DELTA_KEYFRAME = 0,
+    HUBO_DELTA_DIFFERENCE
+
+} hubo_delta_frame_t;
+
+/*
+ * A delta message consists of this header followed by payload_size bytes of payload. The
+ * payload contains one section for the joints, then one for the IMUs, then one for the
+ * force-torque sensors. Each section starts with the number of entries that it contains, and
+ * each entry consists of:
+ *   - the index of the entry
+ *   - a bitmask of which fields are included
+ *   - for each included field, the zigzag-encoded difference between the quantized value and
+ *     the quantized value of the reference keyframe
+ *   - for joints, the raw mode and status bytes if they are included
+ * All integers are written as variable-length (LEB128) integers.
+ *
+ * Every difference frame is relative to the keyframe whose sequence number is given by
+ * 'keyframe', so a receiver which misses frames can still decode every frame that comes after
+ * the latest keyframe it has seen. Keyframes are relative to all zeros.
+ */
+typedef struct hubo_delta_header {
+
+    char code[HUBO_DELTA_HEADER_CODE_SIZE];
+    uint8_t frame_type;
+    uint32_t sequence;
+    uint32_t keyframe;
+    double time;
+
+    uint8_t joint_count;
+    uint8_t imu_count;
+    uint8_t ft_count;
+
+    uint32_t payload_size;
+
+}__attribute__((packed)) hubo_delta_header_t;
+
+#endif /* HUBOSTATE_HUBO_DELTA_C_H */
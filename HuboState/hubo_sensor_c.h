@@ -48,7 +48,9 @@
 #define HUBO_IMU_SENSOR_CHANNEL     "hubo_imu_sensors"
 #define HUBO_FT_SENSOR_CHANNEL      "hubo_ft_sensors"
 
-#define HUBO_DATA_HEADER_CODE "DATAHEADER_0.01"
+#define HUBO_STATE_NOTIFY_SOCKET    "hubo_state_notify"
+
+#define HUBO_DATA_HEADER_CODE "DATAHEADER_0.03"
 #define HUBO_DATA_HEADER_CODE_SIZE 16 /* including null-terminator \0 */
 
 typedef uint8_t hubo_data;
@@ -95,6 +97,8 @@ typedef struct hubo_joint_status {
 typedef struct hubo_joint_state {
 
     double position;
+    double velocity;        /* Filtered estimate, computed by the pump */
+    double acceleration;    /* Filtered estimate, computed by the pump */
     double duty;
     double current;
     double temperature;
@@ -113,6 +117,8 @@ typedef struct hubo_imu_state {
     double angular_position[3];
     double angular_velocity[3];
 
+    double estimated_position[3];   /* Fused by the pump; equals angular_position if disabled */
+
 }__attribute__((packed)) hubo_imu_state_t;
 
 typedef struct hubo_ft_state {
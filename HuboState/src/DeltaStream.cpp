@@ -0,0 +1,437 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+extern "C" {
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+}
+
+#include "HuboState/DeltaStream.hpp"
+
+namespace HuboState {
+
+typedef struct delta_field {
+    size_t offset;
+    double resolution;
+} delta_field_t;
+
+typedef struct delta_layout {
+    size_t stride;
+    std::vector<delta_field_t> fields;
+    size_t blob_offset;
+    size_t blob_size;
+} delta_layout_t;
+
+static const size_t max_delta_fields = 15;
+
+static void add_field(delta_layout_t& layout, size_t offset, double resolution)
+{
+    delta_field_t field;
+    field.offset = offset;
+    field.resolution = resolution;
+    layout.fields.push_back(field);
+}
+
+static void add_vector_field(delta_layout_t& layout, size_t offset, double resolution)
+{
+    for(size_t i=0; i<3; ++i)
+        add_field(layout, offset + i*sizeof(double), resolution);
+}
+
+// The resolutions are chosen to be well below the noise level of the sensors
+static const delta_layout_t& joint_layout()
+{
+    static delta_layout_t layout;
+    if(layout.fields.empty())
+    {
+        layout.stride = sizeof(hubo_joint_state_t);
+        add_field(layout, offsetof(hubo_joint_state_t, position),     1e-6);
+        add_field(layout, offsetof(hubo_joint_state_t, velocity),     1e-5);
+        add_field(layout, offsetof(hubo_joint_state_t, acceleration), 1e-4);
+        add_field(layout, offsetof(hubo_joint_state_t, duty),         1e-4);
+        add_field(layout, offsetof(hubo_joint_state_t, current),      1e-4);
+        add_field(layout, offsetof(hubo_joint_state_t, temperature),  1e-2);
+        add_field(layout, offsetof(hubo_joint_state_t, reference),    1e-6);
+        layout.blob_offset = offsetof(hubo_joint_state_t, mode);
+        layout.blob_size = sizeof(hubo_cmd_mode_t) + sizeof(hubo_joint_status_t);
+    }
+    return layout;
+}
+
+static const delta_layout_t& imu_layout()
+{
+    static delta_layout_t layout;
+    if(layout.fields.empty())
+    {
+        layout.stride = sizeof(hubo_imu_state_t);
+        add_vector_field(layout, offsetof(hubo_imu_state_t, angular_position),   1e-6);
+        add_vector_field(layout, offsetof(hubo_imu_state_t, angular_velocity),   1e-5);
+        add_vector_field(layout, offsetof(hubo_imu_state_t, estimated_position), 1e-6);
+        layout.blob_offset = 0;
+        layout.blob_size = 0;
+    }
+    return layout;
+}
+
+static const delta_layout_t& ft_layout()
+{
+    static delta_layout_t layout;
+    if(layout.fields.empty())
+    {
+        layout.stride = sizeof(hubo_ft_state_t);
+        add_vector_field(layout, offsetof(hubo_ft_state_t, force),  1e-3);
+        add_vector_field(layout, offsetof(hubo_ft_state_t, torque), 1e-4);
+        layout.blob_offset = 0;
+        layout.blob_size = 0;
+    }
+    return layout;
+}
+
+static inline void put_varint(ByteArray& out, uint64_t value)
+{
+    while(value >= 0x80)
+    {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+static inline bool get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& value)
+{
+    value = 0;
+    for(size_t shift=0; shift < 64 && p < end; shift += 7)
+    {
+        uint8_t byte = *(p++);
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if(!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static inline uint64_t zigzag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 0x01);
+}
+
+static inline int64_t quantize(const uint8_t* entry, const delta_field_t& field)
+{
+    double value;
+    memcpy(&value, entry + field.offset, sizeof(double));
+    if(!isfinite(value))
+        return 0;
+    return llround(value/field.resolution);
+}
+
+static inline void dequantize(uint8_t* entry, const delta_field_t& field, int64_t q)
+{
+    double value = (double)(q)*field.resolution;
+    memcpy(entry + field.offset, &value, sizeof(double));
+}
+
+static inline uint8_t* entries(hubo_data* raw)
+{
+    return raw + sizeof(hubo_data_header_t);
+}
+
+static void reset_reference(delta_reference_t& ref, const delta_layout_t& layout, size_t count)
+{
+    ref.count = count;
+    ref.values.assign(count*layout.fields.size(), 0);
+    ref.blobs.assign(count*layout.blob_size, 0);
+}
+
+static void encode_section(hubo_data* raw, const delta_layout_t& layout, delta_reference_t& ref,
+                           bool keyframe, ByteArray& scratch, ByteArray& out)
+{
+    size_t count = get_data_component_count(raw);
+    const size_t nf = layout.fields.size();
+    if(keyframe)
+        reset_reference(ref, layout, count);
+
+    scratch.clear();
+    size_t changed = 0;
+    int64_t diffs[max_delta_fields];
+    int64_t quantized[max_delta_fields];
+    for(size_t i=0; i<count; ++i)
+    {
+        const uint8_t* entry = entries(raw) + i*layout.stride;
+        int64_t* ref_values = &ref.values[i*nf];
+
+        uint64_t mask = 0;
+        for(size_t f=0; f<nf; ++f)
+        {
+            quantized[f] = quantize(entry, layout.fields[f]);
+            diffs[f] = quantized[f] - ref_values[f];
+            if(diffs[f] != 0)
+                mask |= (uint64_t)(0x01) << f;
+        }
+
+        uint8_t* ref_blob = layout.blob_size > 0 ? &ref.blobs[i*layout.blob_size] : NULL;
+        if(layout.blob_size > 0
+           && memcmp(entry + layout.blob_offset, ref_blob, layout.blob_size) != 0)
+            mask |= (uint64_t)(0x01) << nf;
+
+        if(keyframe)
+        {
+            memcpy(ref_values, quantized, nf*sizeof(int64_t));
+            if(layout.blob_size > 0)
+                memcpy(ref_blob, entry + layout.blob_offset, layout.blob_size);
+        }
+
+        if(0 == mask)
+            continue;
+
+        ++changed;
+        put_varint(scratch, i);
+        put_varint(scratch, mask);
+        for(size_t f=0; f<nf; ++f)
+        {
+            if(diffs[f] != 0)
+                put_varint(scratch, zigzag(diffs[f]));
+        }
+
+        if(mask & ((uint64_t)(0x01) << nf))
+            scratch.insert(scratch.end(), entry + layout.blob_offset,
+                           entry + layout.blob_offset + layout.blob_size);
+    }
+
+    put_varint(out, changed);
+    out.insert(out.end(), scratch.begin(), scratch.end());
+}
+
+static bool decode_section(const uint8_t*& p, const uint8_t* end, hubo_data* raw,
+                           const delta_layout_t& layout, delta_reference_t& ref, bool keyframe)
+{
+    size_t count = get_data_component_count(raw);
+    const size_t nf = layout.fields.size();
+    if(keyframe)
+        reset_reference(ref, layout, count);
+
+    if(ref.count != count)
+        return false;
+
+    // Start every entry from the reference keyframe
+    for(size_t i=0; i<count; ++i)
+    {
+        uint8_t* entry = entries(raw) + i*layout.stride;
+        for(size_t f=0; f<nf; ++f)
+            dequantize(entry, layout.fields[f], ref.values[i*nf+f]);
+        if(layout.blob_size > 0)
+            memcpy(entry + layout.blob_offset, &ref.blobs[i*layout.blob_size], layout.blob_size);
+    }
+
+    uint64_t changed;
+    if(!get_varint(p, end, changed))
+        return false;
+
+    for(uint64_t n=0; n<changed; ++n)
+    {
+        uint64_t index, mask;
+        if(!get_varint(p, end, index) || !get_varint(p, end, mask) || index >= count)
+            return false;
+
+        uint8_t* entry = entries(raw) + index*layout.stride;
+        int64_t* ref_values = &ref.values[index*nf];
+        for(size_t f=0; f<nf; ++f)
+        {
+            if(!(mask & ((uint64_t)(0x01) << f)))
+                continue;
+
+            uint64_t diff;
+            if(!get_varint(p, end, diff))
+                return false;
+
+            int64_t q = ref_values[f] + unzigzag(diff);
+            dequantize(entry, layout.fields[f], q);
+            if(keyframe)
+                ref_values[f] = q;
+        }
+
+        if(mask & ((uint64_t)(0x01) << nf))
+        {
+            if(layout.blob_size == 0 || (size_t)(end - p) < layout.blob_size)
+                return false;
+
+            memcpy(entry + layout.blob_offset, p, layout.blob_size);
+            if(keyframe)
+                memcpy(&ref.blobs[index*layout.blob_size], p, layout.blob_size);
+            p += layout.blob_size;
+        }
+    }
+
+    return true;
+}
+
+DeltaEncoder::DeltaEncoder(size_t keyframe_interval_)
+    : keyframe_interval(keyframe_interval_)
+{
+    _sequence = 0;
+    _keyframe = 0;
+    _since_keyframe = 0;
+    _keyframe_size = 0;
+    _force_keyframe = true;
+    _joints.count = 0;
+    _imus.count = 0;
+    _fts.count = 0;
+}
+
+size_t DeltaEncoder::encode(const State& state, ByteArray& message)
+{
+    if( _joints.count != state.joints.size()
+     || _imus.count != state.imus.size()
+     || _fts.count != state.force_torques.size()
+     || _since_keyframe+1 >= keyframe_interval )
+        _force_keyframe = true;
+
+    if(!_force_keyframe)
+    {
+        size_t size = _encode(state, message, false);
+        if(size < _keyframe_size)
+        {
+            ++_since_keyframe;
+            return size;
+        }
+    }
+
+    _force_keyframe = false;
+    _since_keyframe = 0;
+    _keyframe_size = _encode(state, message, true);
+    return _keyframe_size;
+}
+
+size_t DeltaEncoder::_encode(const State& state, ByteArray& message, bool keyframe)
+{
+    ++_sequence;
+    if(keyframe)
+        _keyframe = _sequence;
+
+    message.clear();
+    message.resize(sizeof(hubo_delta_header_t));
+
+    encode_section(state.joints._raw_data, joint_layout(), _joints, keyframe, _scratch, message);
+    encode_section(state.imus._raw_data, imu_layout(), _imus, keyframe, _scratch, message);
+    encode_section(state.force_torques._raw_data, ft_layout(), _fts, keyframe, _scratch, message);
+
+    hubo_delta_header_t header;
+    memset(&header, 0, sizeof(header));
+    strcpy(header.code, HUBO_DELTA_HEADER_CODE);
+    header.frame_type = keyframe ? HUBO_DELTA_KEYFRAME : HUBO_DELTA_DIFFERENCE;
+    header.sequence = _sequence;
+    header.keyframe = _keyframe;
+    header.time = state.joints.get_time();
+    header.joint_count = state.joints.size();
+    header.imu_count = state.imus.size();
+    header.ft_count = state.force_torques.size();
+    header.payload_size = message.size() - sizeof(hubo_delta_header_t);
+    memcpy(&message[0], &header, sizeof(header));
+
+    return message.size();
+}
+
+DeltaDecoder::DeltaDecoder()
+{
+    _synchronized = false;
+    _keyframe = 0;
+    _time = 0;
+    _joints.count = 0;
+    _imus.count = 0;
+    _fts.count = 0;
+}
+
+HuboCan::error_result_t DeltaDecoder::decode(const uint8_t* message, size_t size, State& state)
+{
+    if(size < sizeof(hubo_delta_header_t))
+        return HuboCan::MALFORMED_HEADER;
+
+    hubo_delta_header_t header;
+    memcpy(&header, message, sizeof(header));
+    if( strncmp(header.code, HUBO_DELTA_HEADER_CODE, HUBO_DELTA_HEADER_CODE_SIZE) != 0
+     || header.payload_size != size - sizeof(hubo_delta_header_t) )
+        return HuboCan::MALFORMED_HEADER;
+
+    if( header.joint_count != state.joints.size()
+     || header.imu_count != state.imus.size()
+     || header.ft_count != state.force_torques.size() )
+    {
+        std::cout << "[DeltaDecoder::decode] Size mismatch! Received joints: "
+                  << (int)header.joint_count << ", IMUs: " << (int)header.imu_count
+                  << ", FTs: " << (int)header.ft_count << " | Expected "
+                  << state.joints.size() << ", " << state.imus.size() << ", "
+                  << state.force_torques.size() << std::endl;
+        return HuboCan::ARRAY_MISMATCH;
+    }
+
+    bool keyframe = (header.frame_type == HUBO_DELTA_KEYFRAME);
+    if(!keyframe && (!_synchronized || header.keyframe != _keyframe))
+        return HuboCan::SYNCH_ERROR;
+
+    const uint8_t* p = message + sizeof(hubo_delta_header_t);
+    const uint8_t* end = message + size;
+    bool okay = decode_section(p, end, state.joints._raw_data, joint_layout(), _joints, keyframe)
+             && decode_section(p, end, state.imus._raw_data, imu_layout(), _imus, keyframe)
+             && decode_section(p, end, state.force_torques._raw_data, ft_layout(), _fts, keyframe);
+
+    if(!okay)
+    {
+        std::cout << "[DeltaDecoder::decode] Malformed payload in frame #" << header.sequence
+                  << std::endl;
+        if(keyframe)
+            _synchronized = false;
+        return HuboCan::MALFORMED_HEADER;
+    }
+
+    if(keyframe)
+    {
+        _keyframe = header.sequence;
+        _synchronized = true;
+    }
+
+    _time = header.time;
+    set_data_timestamp(state.joints._raw_data, _time);
+    set_data_timestamp(state.imus._raw_data, _time);
+    set_data_timestamp(state.force_torques._raw_data, _time);
+
+    return HuboCan::OKAY;
+}
+
+} // namespace HuboState
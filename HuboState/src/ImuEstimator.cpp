@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "HuboState/ImuEstimator.hpp"
+
+#include <string.h>
+
+namespace HuboState {
+
+ImuEstimator::ImuEstimator(size_t imu_count, double time_constant)
+{
+    set_time_constant(time_constant);
+    resize(imu_count);
+}
+
+void ImuEstimator::resize(size_t imu_count)
+{
+    _imus.resize(imu_count);
+    reset();
+}
+
+void ImuEstimator::reset()
+{
+    for(size_t i=0; i<_imus.size(); ++i)
+        memset(&_imus[i], 0, sizeof(imu_estimate_t));
+}
+
+void ImuEstimator::set_time_constant(double seconds)
+{
+    _time_constant = seconds > 0 ? seconds : 0;
+}
+
+bool ImuEstimator::update(size_t imu_index, hubo_imu_state_t& imu, double sample_time)
+{
+    if(imu_index >= _imus.size())
+        return false;
+
+    imu_estimate_t& e = _imus[imu_index];
+
+    double dt = sample_time - e.time;
+    if(!e.initialized || _time_constant <= 0 || dt <= 0)
+    {
+        for(size_t i=0; i<3; ++i)
+            e.angle[i] = imu.angular_position[i];
+    }
+    else
+    {
+        double alpha = _time_constant/(_time_constant + dt);
+        for(size_t i=0; i<3; ++i)
+        {
+            e.angle[i] = alpha*(e.angle[i] + imu.angular_velocity[i]*dt)
+                         + (1.0-alpha)*imu.angular_position[i];
+        }
+    }
+
+    e.time = sample_time;
+    e.initialized = true;
+
+    for(size_t i=0; i<3; ++i)
+        imu.estimated_position[i] = e.angle[i];
+
+    return true;
+}
+
+} // namespace HuboState
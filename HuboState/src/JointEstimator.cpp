@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "HuboState/JointEstimator.hpp"
+
+#include <math.h>
+#include <string.h>
+
+namespace HuboState {
+
+JointEstimator::JointEstimator(size_t joint_count,
+                               double velocity_cutoff_hz,
+                               double acceleration_cutoff_hz)
+{
+    set_velocity_cutoff(velocity_cutoff_hz);
+    set_acceleration_cutoff(acceleration_cutoff_hz);
+    resize(joint_count);
+}
+
+void JointEstimator::resize(size_t joint_count)
+{
+    _joints.resize(joint_count);
+    reset();
+}
+
+void JointEstimator::reset()
+{
+    for(size_t i=0; i<_joints.size(); ++i)
+        reset(i);
+}
+
+void JointEstimator::reset(size_t joint_index)
+{
+    if(joint_index < _joints.size())
+        memset(&_joints[joint_index], 0, sizeof(joint_estimate_t));
+}
+
+void JointEstimator::set_velocity_cutoff(double cutoff_hz)
+{
+    _velocity_cutoff = cutoff_hz > 0 ? cutoff_hz : 0;
+}
+
+void JointEstimator::set_acceleration_cutoff(double cutoff_hz)
+{
+    _acceleration_cutoff = cutoff_hz > 0 ? cutoff_hz : 0;
+}
+
+double JointEstimator::_smoothing(double cutoff_hz, double dt)
+{
+    if(cutoff_hz <= 0)
+        return 1;
+
+    double tau = 1.0/(2*M_PI*cutoff_hz);
+    return dt/(dt + tau);
+}
+
+bool JointEstimator::update(size_t joint_index, double position, double sample_time,
+                            double& velocity, double& acceleration)
+{
+    if(joint_index >= _joints.size())
+        return false;
+
+    joint_estimate_t& j = _joints[joint_index];
+
+    if(j.samples == 0)
+    {
+        j.position = position;
+        j.time = sample_time;
+        j.samples = 1;
+        velocity = 0;
+        acceleration = 0;
+        return true;
+    }
+
+    double dt = sample_time - j.time;
+    if(dt <= 0)
+    {
+        velocity = j.velocity;
+        acceleration = j.acceleration;
+        return true;
+    }
+
+    double raw_velocity = (position - j.position)/dt;
+    double filtered_velocity = raw_velocity;
+    if(j.samples > 1)
+    {
+        double a = _smoothing(_velocity_cutoff, dt);
+        filtered_velocity = j.velocity + a*(raw_velocity - j.velocity);
+    }
+
+    double filtered_acceleration = 0;
+    if(j.samples > 1)
+    {
+        double raw_acceleration = (filtered_velocity - j.velocity)/dt;
+        filtered_acceleration = raw_acceleration;
+        if(j.samples > 2)
+        {
+            double a = _smoothing(_acceleration_cutoff, dt);
+            filtered_acceleration = j.acceleration + a*(raw_acceleration - j.acceleration);
+        }
+    }
+
+    j.position = position;
+    j.velocity = filtered_velocity;
+    j.acceleration = filtered_acceleration;
+    j.time = sample_time;
+    if(j.samples < 3)
+        ++j.samples;
+
+    velocity = j.velocity;
+    acceleration = j.acceleration;
+    return true;
+}
+
+} // namespace HuboState
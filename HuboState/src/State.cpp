@@ -78,6 +78,7 @@ void State::load_description(const HuboCan::HuboDescription &description)
 void State::_initialize()
 {
     _last_cmd_data = NULL;
+    _double_buffered = false;
 }
 
 void State::_create_memory()
@@ -86,6 +87,7 @@ void State::_create_memory()
 
     _last_cmd_data = hubo_cmd_init_data(_desc.getJointCount());
     joints.initialize(_desc.getJointNames(), HUBO_JOINT_SENSOR_CHANNEL);
+    joint_estimator.resize(_desc.getJointCount());
 
     std::vector<std::string> imu_names;
     std::vector<std::string> ft_names;
@@ -99,6 +101,7 @@ void State::_create_memory()
     }
 
     imus.initialize(imu_names, HUBO_IMU_SENSOR_CHANNEL);
+    imu_estimator.resize(imu_names.size());
     force_torques.initialize(ft_names, HUBO_FT_SENSOR_CHANNEL);
 }
 
@@ -129,8 +132,49 @@ HuboCan::error_result_t State::update(double timeout_sec, bool report_sync)
     return result;
 }
 
+void State::set_double_buffered(bool enable)
+{
+    _double_buffered = enable;
+    joints.set_double_buffered(enable);
+    imus.set_double_buffered(enable);
+    force_torques.set_double_buffered(enable);
+}
+
+double State::swap_buffers()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    double timestamp = (double)(time.tv_sec);
+    timestamp += (double)(time.tv_nsec)/1.0e9;
+
+    force_torques.swap_buffers(timestamp);
+    imus.swap_buffers(timestamp);
+    joints.swap_buffers(timestamp);
+
+    return timestamp;
+}
+
+HuboCan::error_result_t State::publish_front()
+{
+    bool success = true;
+    success &= force_torques.send_front();
+    success &= imus.send_front();
+    success &= joints.send_front();
+
+    if(success)
+        return HuboCan::OKAY;
+    else
+        return HuboCan::ACH_ERROR;
+}
+
 HuboCan::error_result_t State::publish()
 {
+    if(_double_buffered)
+    {
+        swap_buffers();
+        return publish_front();
+    }
+
     struct timespec time;
     clock_gettime(CLOCK_MONOTONIC, &time);
     double timestamp = (double)(time.tv_sec);
@@ -147,6 +191,24 @@ HuboCan::error_result_t State::publish()
         return HuboCan::ACH_ERROR;
 }
 
+void State::set_joint_position(size_t joint_index, double position, double sample_time)
+{
+    hubo_joint_state_t& joint = joints[joint_index];
+    joint.position = position;
+
+    double velocity = 0, acceleration = 0;
+    if(joint_estimator.update(joint_index, position, sample_time, velocity, acceleration))
+    {
+        joint.velocity = velocity;
+        joint.acceleration = acceleration;
+    }
+}
+
+void State::estimate_imu(size_t imu_index, double sample_time)
+{
+    imu_estimator.update(imu_index, imus[imu_index], sample_time);
+}
+
 double State::get_time()
 {
     return joints.get_time();
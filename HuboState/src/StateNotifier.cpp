@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+extern "C" {
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+}
+
+#include "HuboState/StateNotifier.hpp"
+
+#include <iostream>
+
+namespace HuboState {
+
+static socklen_t notify_address(struct sockaddr_un& address, const std::string& name)
+{
+    // Use the abstract socket namespace so that nothing is left behind in the
+    // filesystem if the interface process dies without cleaning up.
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    size_t length = name.size();
+    if(length > sizeof(address.sun_path)-1)
+        length = sizeof(address.sun_path)-1;
+    memcpy(address.sun_path+1, name.c_str(), length);
+    return offsetof(struct sockaddr_un, sun_path) + 1 + length;
+}
+
+static int receive_event_fd(int connection)
+{
+    char byte;
+    struct iovec iov;
+    iov.iov_base = &byte;
+    iov.iov_len = sizeof(byte);
+
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t r = recvmsg(connection, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    if(r == 0)
+        return -2;
+    if(r < 0)
+        return (errno == EAGAIN || errno == EWOULDBLOCK)? -1 : -2;
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if(NULL == cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+        return -2;
+
+    int fd;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    return fd;
+}
+
+StateNotifier::StateNotifier(const std::string& socket_name)
+{
+    _socket = -1;
+    _socket_name = socket_name;
+}
+
+StateNotifier::~StateNotifier()
+{
+    _close();
+}
+
+bool StateNotifier::open()
+{
+    _close();
+
+    _socket = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(_socket < 0)
+    {
+        std::cerr << "[StateNotifier::open] Could not create socket: "
+                  << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct sockaddr_un address;
+    socklen_t length = notify_address(address, _socket_name);
+    if( bind(_socket, (struct sockaddr*)&address, length) < 0
+     || listen(_socket, 16) < 0 )
+    {
+        std::cerr << "[StateNotifier::open] Could not bind '" << _socket_name << "': "
+                  << strerror(errno) << "\n -- Is another interface already running?"
+                  << std::endl;
+        _close();
+        return false;
+    }
+
+    return true;
+}
+
+size_t StateNotifier::notify()
+{
+    if(_socket < 0)
+        return 0;
+
+    _check_listeners();
+
+    size_t count = 0;
+    const uint64_t one = 1;
+    for(size_t i=0; i<_listeners.size(); ++i)
+    {
+        if(_listeners[i].event < 0)
+            continue;
+
+        // If the listener has fallen far enough behind to saturate its counter, the write
+        // fails with EAGAIN, which is fine: it is already readable.
+        if(write(_listeners[i].event, &one, sizeof(one)) == sizeof(one))
+            ++count;
+    }
+
+    return count;
+}
+
+void StateNotifier::_check_listeners()
+{
+    _polls.resize(_listeners.size()+1);
+    _polls[0].fd = _socket;
+    _polls[0].events = POLLIN;
+    _polls[0].revents = 0;
+    for(size_t i=0; i<_listeners.size(); ++i)
+    {
+        _polls[i+1].fd = _listeners[i].connection;
+        _polls[i+1].events = POLLIN;
+        _polls[i+1].revents = 0;
+    }
+
+    if(poll(&_polls[0], _polls.size(), 0) <= 0)
+        return;
+
+    for(size_t i=_listeners.size(); i > 0; --i)
+    {
+        short revents = _polls[i].revents;
+        listener_t& l = _listeners[i-1];
+        if(revents & (POLLHUP | POLLERR | POLLNVAL))
+        {
+            _drop_listener(i-1);
+        }
+        else if(revents & POLLIN)
+        {
+            int fd = receive_event_fd(l.connection);
+            if(fd == -2)
+            {
+                _drop_listener(i-1);
+            }
+            else if(fd >= 0)
+            {
+                if(l.event >= 0)
+                    close(fd);
+                else
+                    l.event = fd;
+            }
+        }
+    }
+
+    if(_polls[0].revents & POLLIN)
+        _accept_listeners();
+}
+
+void StateNotifier::_accept_listeners()
+{
+    int connection;
+    while( (connection = accept4(_socket, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0 )
+    {
+        listener_t l;
+        l.connection = connection;
+        // Listeners send their eventfd right after connecting, so it has usually arrived already
+        l.event = receive_event_fd(connection);
+        if(l.event == -2)
+        {
+            close(connection);
+            continue;
+        }
+
+        _listeners.push_back(l);
+    }
+}
+
+void StateNotifier::_drop_listener(size_t index)
+{
+    if(_listeners[index].event >= 0)
+        close(_listeners[index].event);
+    close(_listeners[index].connection);
+    _listeners.erase(_listeners.begin()+index);
+}
+
+void StateNotifier::_close()
+{
+    while(!_listeners.empty())
+        _drop_listener(_listeners.size()-1);
+
+    if(_socket >= 0)
+        close(_socket);
+    _socket = -1;
+}
+
+StateNotifier::StateNotifier(const StateNotifier&) { }
+
+StateNotifier& StateNotifier::operator=(const StateNotifier&) { return *this; }
+
+
+StateListener::StateListener(bool connect_now, const std::string& socket_name)
+{
+    _connection = -1;
+    _last_count = 0;
+    _socket_name = socket_name;
+    _event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(_event < 0)
+    {
+        std::cerr << "[StateListener] Could not create eventfd: " << strerror(errno) << std::endl;
+    }
+
+    if(connect_now)
+        connect();
+}
+
+StateListener::~StateListener()
+{
+    _disconnect();
+    if(_event >= 0)
+        close(_event);
+}
+
+bool StateListener::connect(bool verbose)
+{
+    _disconnect();
+
+    if(_event < 0)
+        return false;
+
+    _connection = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if(_connection < 0)
+    {
+        std::cerr << "[StateListener::connect] Could not create socket: "
+                  << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct sockaddr_un address;
+    socklen_t length = notify_address(address, _socket_name);
+    if(::connect(_connection, (struct sockaddr*)&address, length) < 0)
+    {
+        if(verbose)
+        {
+            std::cerr << "[StateListener::connect] Could not reach '" << _socket_name << "': "
+                      << strerror(errno) << "\n -- Is the interface running on this machine?"
+                      << std::endl;
+        }
+        _disconnect();
+        return false;
+    }
+
+    char byte = 0;
+    struct iovec iov;
+    iov.iov_base = &byte;
+    iov.iov_len = sizeof(byte);
+
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &_event, sizeof(int));
+
+    if(sendmsg(_connection, &msg, MSG_NOSIGNAL) < 0)
+    {
+        std::cerr << "[StateListener::connect] Could not register with '" << _socket_name
+                  << "': " << strerror(errno) << std::endl;
+        _disconnect();
+        return false;
+    }
+
+    return true;
+}
+
+bool StateListener::connected()
+{
+    if(_connection < 0)
+        return false;
+
+    struct pollfd p;
+    p.fd = _connection;
+    p.events = POLLIN;
+    p.revents = 0;
+    if(poll(&p, 1, 0) > 0 && (p.revents & (POLLHUP | POLLERR | POLLIN)))
+    {
+        _disconnect();
+        return false;
+    }
+
+    return true;
+}
+
+uint64_t StateListener::acknowledge()
+{
+    uint64_t count = 0;
+    if(_event < 0 || read(_event, &count, sizeof(count)) != sizeof(count))
+        return 0;
+
+    return count;
+}
+
+HuboCan::error_result_t StateListener::wait(double timeout_sec)
+{
+    _last_count = acknowledge();
+    if(_last_count > 0)
+        return HuboCan::OKAY;
+
+    if(_event < 0)
+        return HuboCan::UNINITIALIZED;
+
+    struct timespec timeout;
+    timeout.tv_sec = (time_t)timeout_sec;
+    timeout.tv_nsec = (long)((timeout_sec - (double)timeout.tv_sec)*1e9);
+
+    struct pollfd p;
+    p.fd = _event;
+    p.events = POLLIN;
+    p.revents = 0;
+    int r = ppoll(&p, 1, &timeout, NULL);
+    if(r < 0)
+        return (errno == EINTR)? HuboCan::INTERRUPTED : HuboCan::UNDEFINED_ERROR;
+
+    _last_count = acknowledge();
+    if(_last_count == 0)
+        return HuboCan::TIMEOUT;
+
+    return HuboCan::OKAY;
+}
+
+void StateListener::_disconnect()
+{
+    if(_connection >= 0)
+        close(_connection);
+    _connection = -1;
+}
+
+StateListener::StateListener(const StateListener&) { }
+
+StateListener& StateListener::operator=(const StateListener&) { return *this; }
+
+} // namespace HuboState
@@ -44,6 +44,9 @@ std::ostream& operator<<(std::ostream& stream, const hubo_joint_state_t& state)
     stream << "pos:";
     stream.width(width);
     stream << state.position;
+    stream << "  vel:";
+    stream.width(width);
+    stream << state.velocity;
     stream << "  ref:";
     stream.width(width);
     stream << state.reference;
@@ -89,6 +92,16 @@ std::ostream& operator<<(std::ostream& stream, const hubo_imu_state_t& imu)
     stream.width(width);
     stream << imu.angular_velocity[2];
 
+    stream << " | Estimate x:";
+    stream.width(width);
+    stream << imu.estimated_position[0];
+    stream << "  y:";
+    stream.width(width);
+    stream << imu.estimated_position[1];
+    stream << "  z:";
+    stream.width(width);
+    stream << imu.estimated_position[2];
+
     return stream;
 }
 
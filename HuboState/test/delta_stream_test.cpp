@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "HuboState/DeltaStream.hpp"
+
+#include <cstdlib>
+#include <cstddef>
+#include <cmath>
+
+using namespace HuboState;
+
+// Half of the resolution which DeltaStream quantizes each field to
+static const double joint_tolerance[] = { 0.5e-6, 0.5e-5, 0.5e-4, 0.5e-4, 0.5e-4, 0.5e-2, 0.5e-6 };
+static const double imu_tolerance[] = { 0.5e-6, 0.5e-5, 0.5e-6 };
+static const double ft_tolerance[] = { 0.5e-3, 0.5e-4 };
+
+// The joint states are packed, so their fields get copied in and out rather than pointed at
+static const size_t joint_offsets[] = {
+    offsetof(hubo_joint_state_t, position), offsetof(hubo_joint_state_t, velocity),
+    offsetof(hubo_joint_state_t, acceleration), offsetof(hubo_joint_state_t, duty),
+    offsetof(hubo_joint_state_t, current), offsetof(hubo_joint_state_t, temperature),
+    offsetof(hubo_joint_state_t, reference) };
+
+static double joint_field(const hubo_joint_state_t& joint, size_t f)
+{
+    double value;
+    memcpy(&value, (const uint8_t*)&joint + joint_offsets[f], sizeof(double));
+    return value;
+}
+
+static void set_joint_field(hubo_joint_state_t& joint, size_t f, double value)
+{
+    memcpy((uint8_t*)&joint + joint_offsets[f], &value, sizeof(double));
+}
+
+// Moves every value by up to scale, about the way that sensor data changes from one cycle to the
+// next when scale is small
+static void drift(State& state, double scale = 1e-5)
+{
+    for(size_t i=0; i<state.joints.size(); ++i)
+    {
+        for(size_t f=0; f<7; ++f)
+            set_joint_field(state.joints[i], f,
+                            joint_field(state.joints[i], f) + (2*drand48() - 1)*scale);
+    }
+
+    for(size_t i=0; i<state.imus.size(); ++i)
+    {
+        for(size_t k=0; k<3; ++k)
+        {
+            state.imus[i].angular_position[k] += (2*drand48() - 1)*scale;
+            state.imus[i].angular_velocity[k] += (2*drand48() - 1)*scale;
+            state.imus[i].estimated_position[k] += (2*drand48() - 1)*scale;
+        }
+    }
+
+    for(size_t i=0; i<state.force_torques.size(); ++i)
+    {
+        for(size_t k=0; k<3; ++k)
+        {
+            state.force_torques[i].force[k] += (2*drand48() - 1)*scale*1e3;
+            state.force_torques[i].torque[k] += (2*drand48() - 1)*scale*1e2;
+        }
+    }
+}
+
+static bool close(double sent, double received, double tolerance)
+{
+    // Anything which is not finite gets sent as zero
+    if(!std::isfinite(sent))
+        sent = 0;
+    return fabs(sent - received) <= tolerance*(1 + 1e-9) + fabs(sent)*1e-15;
+}
+
+static bool matches(State& sent, State& received)
+{
+    for(size_t i=0; i<sent.joints.size(); ++i)
+    {
+        hubo_joint_state_t& a = sent.joints[i];
+        hubo_joint_state_t& b = received.joints[i];
+        for(size_t f=0; f<7; ++f)
+        {
+            if(!close(joint_field(a, f), joint_field(b, f), joint_tolerance[f]))
+            {
+                std::cout << "Field " << f << " of joint " << i << " was sent as "
+                          << joint_field(a, f) << " but received as " << joint_field(b, f)
+                          << std::endl;
+                return false;
+            }
+        }
+
+        if( a.mode != b.mode || memcmp(&a.status, &b.status, sizeof(a.status)) != 0 )
+        {
+            std::cout << "The mode or status of joint " << i << " did not come through"
+                      << std::endl;
+            return false;
+        }
+    }
+
+    for(size_t i=0; i<sent.imus.size(); ++i)
+    {
+        for(size_t k=0; k<3; ++k)
+        {
+            if( !close(sent.imus[i].angular_position[k], received.imus[i].angular_position[k],
+                       imu_tolerance[0])
+             || !close(sent.imus[i].angular_velocity[k], received.imus[i].angular_velocity[k],
+                       imu_tolerance[1])
+             || !close(sent.imus[i].estimated_position[k],
+                       received.imus[i].estimated_position[k], imu_tolerance[2]) )
+            {
+                std::cout << "IMU " << i << " did not come through" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    for(size_t i=0; i<sent.force_torques.size(); ++i)
+    {
+        for(size_t k=0; k<3; ++k)
+        {
+            if( !close(sent.force_torques[i].force[k], received.force_torques[i].force[k],
+                       ft_tolerance[0])
+             || !close(sent.force_torques[i].torque[k], received.force_torques[i].torque[k],
+                       ft_tolerance[1]) )
+            {
+                std::cout << "Force-torque sensor " << i << " did not come through" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static uint8_t frame_type(const ByteArray& message)
+{
+    hubo_delta_header_t header;
+    memcpy(&header, &message[0], sizeof(header));
+    return header.frame_type;
+}
+
+int main(int, char* [])
+{
+    HuboCan::HuboDescription desc;
+    if(!desc.parseFile("../devices/DrcHubo.dd"))
+    {
+        std::cout << "Could not load the description" << std::endl;
+        return 1;
+    }
+
+    State sent(desc);
+    State received(desc);
+    State untouched(desc);
+    if(!sent.initialized() || !received.initialized() || sent.joints.size() < 2)
+    {
+        std::cout << "Could not initialize the states" << std::endl;
+        return 1;
+    }
+
+    srand48(5);
+    DeltaEncoder encoder(50);
+    DeltaDecoder decoder;
+    ByteArray message;
+
+    // The first frame is a keyframe, and the ones after it are differences from it
+    drift(sent, 1);
+    size_t differences = 0;
+    for(size_t cycle=0; cycle<20; ++cycle)
+    {
+        if(cycle > 0)
+            drift(sent);
+        size_t size = encoder.encode(sent, message);
+        if( (cycle == 0) != (frame_type(message) == HUBO_DELTA_KEYFRAME) )
+        {
+            std::cout << "Frame " << cycle << " has the wrong type" << std::endl;
+            return 2;
+        }
+        differences += frame_type(message) == HUBO_DELTA_DIFFERENCE ? 1 : 0;
+
+        if( decoder.decode(&message[0], size, received) != HuboCan::OKAY
+                || !matches(sent, received) )
+        {
+            std::cout << "Frame " << cycle << " did not survive the round trip" << std::endl;
+            return 2;
+        }
+    }
+
+    // Values at both ends of the range, flipping sign between frames, make for the largest
+    // zigzag differences. Anything which is not finite gets sent as zero.
+    for(size_t flip=0; flip<4; ++flip)
+    {
+        double sign = flip%2 == 0 ? 1 : -1;
+        sent.joints[0].position = sign*1e9;
+        sent.joints[1].position = -sign*1e9;
+        sent.joints[0].temperature = -sign*1e12;
+        sent.joints[1].velocity = flip < 2 ? NAN : -INFINITY;
+        sent.joints[1].mode = flip%2 == 0 ? HUBO_CMD_RIGID : HUBO_CMD_COMPLIANT;
+        sent.joints[1].status.error.jam = flip%2;
+        sent.joints[0].status.home_flag = 0xFF - flip;
+
+        size_t size = encoder.encode(sent, message);
+        if( frame_type(message) != HUBO_DELTA_DIFFERENCE
+                || decoder.decode(&message[0], size, received) != HuboCan::OKAY
+                || !matches(sent, received) )
+        {
+            std::cout << "Extreme values did not survive difference frame " << flip << std::endl;
+            return 3;
+        }
+    }
+
+    // Losing a difference frame costs nothing, since the next one is relative to the keyframe
+    drift(sent);
+    encoder.encode(sent, message);
+    drift(sent);
+    size_t size = encoder.encode(sent, message);
+    if( frame_type(message) != HUBO_DELTA_DIFFERENCE
+            || decoder.decode(&message[0], size, received) != HuboCan::OKAY
+            || !matches(sent, received) )
+    {
+        std::cout << "Could not carry on after losing a difference frame" << std::endl;
+        return 4;
+    }
+
+    // Losing a keyframe leaves the decoder unable to decode anything until the next one
+    encoder.request_keyframe();
+    drift(sent);
+    encoder.encode(sent, message);
+    for(size_t i=0; i<sent.joints.size(); ++i)
+        untouched.joints[i] = received.joints[i];
+
+    for(size_t cycle=0; cycle<3; ++cycle)
+    {
+        drift(sent);
+        size = encoder.encode(sent, message);
+        if( decoder.decode(&message[0], size, received) != HuboCan::SYNCH_ERROR )
+        {
+            std::cout << "A difference from a lost keyframe did not report a SYNCH_ERROR"
+                      << std::endl;
+            return 5;
+        }
+    }
+
+    for(size_t i=0; i<sent.joints.size(); ++i)
+    {
+        if(memcmp(&untouched.joints[i], &received.joints[i], sizeof(hubo_joint_state_t)) != 0)
+        {
+            std::cout << "A frame which could not be decoded changed joint " << i << std::endl;
+            return 5;
+        }
+    }
+
+    // ... and the decoder resynchronizes on the next keyframe, just like one that joins late
+    DeltaDecoder late;
+    if( late.decode(&message[0], size, untouched) != HuboCan::SYNCH_ERROR )
+    {
+        std::cout << "A decoder without a keyframe decoded a difference frame" << std::endl;
+        return 6;
+    }
+
+    encoder.request_keyframe();
+    drift(sent);
+    size = encoder.encode(sent, message);
+    if( frame_type(message) != HUBO_DELTA_KEYFRAME
+            || decoder.decode(&message[0], size, received) != HuboCan::OKAY
+            || late.decode(&message[0], size, untouched) != HuboCan::OKAY
+            || !matches(sent, received) || !matches(sent, untouched) )
+    {
+        std::cout << "Could not resynchronize on a keyframe" << std::endl;
+        return 6;
+    }
+
+    drift(sent);
+    size = encoder.encode(sent, message);
+    if( frame_type(message) != HUBO_DELTA_DIFFERENCE
+            || decoder.decode(&message[0], size, received) != HuboCan::OKAY
+            || !matches(sent, received) )
+    {
+        std::cout << "Could not decode a difference after resynchronizing" << std::endl;
+        return 6;
+    }
+
+    std::cout << "Round trip passed with " << differences << " difference frames of " << size
+              << " bytes" << std::endl;
+    return 0;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "HuboState/StateNotifier.hpp"
+
+#include <iostream>
+
+using namespace HuboState;
+
+int main(int, char* [])
+{
+    StateNotifier notifier("hubo_state_notify_test");
+    if(!notifier.open())
+        return 1;
+
+    StateListener listener(true, "hubo_state_notify_test");
+
+    if(notifier.notify() != 1 || listener.wait(0.1) != HuboCan::OKAY)
+    {
+        std::cout << "Listener was not notified of the first cycle" << std::endl;
+        return 2;
+    }
+
+    notifier.notify();
+    notifier.notify();
+    notifier.notify();
+    if(listener.acknowledge() != 3)
+    {
+        std::cout << "Listener did not count the missed cycles" << std::endl;
+        return 3;
+    }
+
+    if(listener.wait(0.01) != HuboCan::TIMEOUT)
+    {
+        std::cout << "Listener woke up without a new cycle" << std::endl;
+        return 4;
+    }
+
+    {
+        StateListener other(true, "hubo_state_notify_test");
+        if(notifier.notify() != 2)
+        {
+            std::cout << "Second listener was not registered" << std::endl;
+            return 5;
+        }
+    }
+
+    notifier.notify();
+    if(notifier.listener_count() != 1)
+    {
+        std::cout << "Closed listener was not dropped" << std::endl;
+        return 6;
+    }
+
+    std::cout << "StateNotifier test passed" << std::endl;
+    return 0;
+}
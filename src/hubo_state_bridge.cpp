@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2015, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s): Michael X. Grey <greyxmike@gmail.com>
+ *
+ * Humanoid Robotics Lab
+ *
+ * Directed by Prof. Mike Stilman <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "HuboState/DeltaStream.hpp"
+#include "HuboRT/Daemonizer.hpp"
+
+#include <iostream>
+#include <stdlib.h>
+
+// On the robot, run this with the 'encode' argument to compress the state into the
+// hubo_state_delta channel. On a remote machine which pulls hubo_state_delta (instead of the
+// full state channels) through achd, run this with the 'decode' argument to reconstruct the state
+// and publish it on the local state channels, so that State instances work as usual.
+
+int main(int argc, char* argv[])
+{
+    bool encode = true;
+    bool terminal = false;
+    size_t keyframe_interval = 100;
+    for(int i=1; i<argc; ++i)
+    {
+        if(strcmp(argv[i], "encode") == 0)
+        {
+            encode = true;
+        }
+        else if(strcmp(argv[i], "decode") == 0)
+        {
+            encode = false;
+        }
+        else if(strcmp(argv[i], "terminal") == 0)
+        {
+            std::cout << "terminal flag noticed -- will run in terminal mode" << std::endl;
+            terminal = true;
+        }
+        else if(strcmp(argv[i], "keyframe_interval") == 0)
+        {
+            if(i+1 >= argc)
+            {
+                std::cout << "The 'keyframe_interval' argument must be followed by a value!"
+                          << std::endl;
+            }
+            else
+            {
+                keyframe_interval = atoi(argv[i+1]);
+            }
+        }
+    }
+
+    HuboRT::Daemonizer rt;
+    if(!terminal)
+    {
+        if(!rt.begin(encode? "state_delta_encoder" : "state_delta_decoder", 30))
+        {
+            return 1;
+        }
+    }
+
+    HuboState::State state(10);
+    if(!state.initialized())
+    {
+        std::cout << "State was not initialized correctly, so we are quitting.\n"
+                  << " -- Either your ach channels are not open"
+                  << " or no HuboDescription has been published!\n" << std::endl;
+        return 2;
+    }
+
+    ach_channel_t channel;
+    ach_status_t r = ach_open(&channel, HUBO_DELTA_CHANNEL, NULL);
+    if(ACH_OK != r)
+    {
+        std::cout << "Could not open channel '" << HUBO_DELTA_CHANNEL << "': "
+                  << ach_result_to_string(r) << std::endl;
+        return 3;
+    }
+
+    HuboState::ByteArray message;
+    if(encode)
+    {
+        HuboState::DeltaEncoder encoder(keyframe_interval);
+        while(rt.good())
+        {
+            if(state.update(1) != HuboCan::OKAY)
+                continue;
+
+            size_t size = encoder.encode(state, message);
+            r = ach_put(&channel, &message[0], size);
+            if(ACH_OK != r)
+            {
+                report_ach_errors(r, "hubo_state_bridge", "ach_put", HUBO_DELTA_CHANNEL);
+            }
+        }
+    }
+    else
+    {
+        HuboState::DeltaDecoder decoder;
+        message.resize(4096);
+        bool waiting = false;
+        while(rt.good())
+        {
+            size_t fs = 0;
+            struct timespec wait_time;
+            clock_gettime( ACH_DEFAULT_CLOCK, &wait_time );
+            wait_time.tv_sec += 1;
+
+            // Do not use ACH_O_LAST here, because skipping over a keyframe would leave us unable
+            // to decode anything until the next keyframe arrives
+            r = ach_get(&channel, &message[0], message.size(), &fs, &wait_time, ACH_O_WAIT);
+            if(ACH_TIMEOUT == r)
+            {
+                continue;
+            }
+            else if(ACH_OVERFLOW == r)
+            {
+                message.resize(fs);
+                continue;
+            }
+            else if(ACH_OK != r && ACH_MISSED_FRAME != r)
+            {
+                report_ach_errors(r, "hubo_state_bridge", "ach_get", HUBO_DELTA_CHANNEL);
+                continue;
+            }
+
+            HuboCan::error_result_t result = decoder.decode(&message[0], fs, state);
+            if(result == HuboCan::SYNCH_ERROR)
+            {
+                if(!waiting)
+                    std::cout << "Waiting for the next keyframe" << std::endl;
+                waiting = true;
+                continue;
+            }
+            else if(result != HuboCan::OKAY)
+            {
+                std::cout << "Failed to decode state: " << result << std::endl;
+                continue;
+            }
+
+            waiting = false;
+            state.force_torques.send_data(decoder.get_time());
+            state.imus.send_data(decoder.get_time());
+            state.joints.send_data(decoder.get_time());
+        }
+    }
+
+    ach_close(&channel);
+    return 0;
+}
@@ -36,7 +36,9 @@
 #include "HuboCan/VirtualPump.hpp"
 #include "HuboCan/HuboDescription.hpp"
 #include "HuboState/State.hpp"
+#include "HuboState/StateNotifier.hpp"
 #include "HuboCmd/Aggregator.hpp"
+#include "HuboCmd/hubo_cmd_stream.hpp"
 #include "HuboCmd/AuxReceiver.hpp"
 
 using namespace HuboCan;
@@ -52,6 +54,11 @@ int main(int argc, char* argv[])
     }
 
     double frequency_override = 0;
+    double velocity_cutoff = -1;
+    double acceleration_cutoff = -1;
+    double imu_time_constant = -1;
+    bool threaded_aggregator = false;
+    hubo_cmd_safety_policy_t safety_policy = HUBO_CMD_SAFETY_CLAMP;
     std::string robot_name = "Hubo2Plus";
     for(int i=1; i<argc; ++i)
     {
@@ -77,6 +84,64 @@ int main(int argc, char* argv[])
                 frequency_override = atof(argv[i+1]);
             }
         }
+        else if(strcmp(argv[i],"velocity_cutoff")==0)
+        {
+            if(i+1 >= argc)
+            {
+                std::cout << "The 'velocity_cutoff' argument must be followed by a value!" << std::endl;
+            }
+            else
+            {
+                velocity_cutoff = atof(argv[i+1]);
+            }
+        }
+        else if(strcmp(argv[i],"acceleration_cutoff")==0)
+        {
+            if(i+1 >= argc)
+            {
+                std::cout << "The 'acceleration_cutoff' argument must be followed by a value!" << std::endl;
+            }
+            else
+            {
+                acceleration_cutoff = atof(argv[i+1]);
+            }
+        }
+        else if(strcmp(argv[i],"threaded_aggregator")==0)
+        {
+            std::cout << "threaded_aggregator flag noticed -- will aggregate commands in a thread"
+                      << std::endl;
+            threaded_aggregator = true;
+        }
+        else if(strcmp(argv[i],"safety")==0)
+        {
+            if(i+1 >= argc)
+            {
+                std::cout << "The 'safety' argument must be followed by off, clamp, or reject!" << std::endl;
+            }
+            else if(strcmp(argv[i+1],"off")==0)
+            {
+                safety_policy = HUBO_CMD_SAFETY_OFF;
+            }
+            else if(strcmp(argv[i+1],"reject")==0)
+            {
+                safety_policy = HUBO_CMD_SAFETY_REJECT;
+            }
+            else if(strcmp(argv[i+1],"clamp")!=0)
+            {
+                std::cout << "Unknown safety policy '" << argv[i+1] << "' -- will clamp" << std::endl;
+            }
+        }
+        else if(strcmp(argv[i],"imu_time_constant")==0)
+        {
+            if(i+1 >= argc)
+            {
+                std::cout << "The 'imu_time_constant' argument must be followed by a value!" << std::endl;
+            }
+            else
+            {
+                imu_time_constant = atof(argv[i+1]);
+            }
+        }
     }
 
     HuboDescription desc;
@@ -102,6 +167,15 @@ int main(int argc, char* argv[])
     HuboCmd::Aggregator agg(desc);
     HuboCmd::AuxReceiver aux(&desc);
 
+    state.set_double_buffered(true);
+
+    if(velocity_cutoff >= 0)
+        state.joint_estimator.set_velocity_cutoff(velocity_cutoff);
+    if(acceleration_cutoff >= 0)
+        state.joint_estimator.set_acceleration_cutoff(acceleration_cutoff);
+    if(imu_time_constant >= 0)
+        state.imu_estimator.set_time_constant(imu_time_constant);
+
     if(!state.initialized())
     {
         std::cout << "State was not initialized correctly, so we are quitting.\n"
@@ -110,11 +184,24 @@ int main(int argc, char* argv[])
         return 3;
     }
 
-    agg.run();
+    agg.set_state(&state);
+    agg.set_safety_policy(safety_policy);
+    std::cout << "Joint limit safety policy: " << safety_policy << std::endl;
+
+    if(threaded_aggregator)
+        agg.run_thread();
+    else
+        agg.run();
+
+    // Open this only after run() has forked the aggregator, or the child would inherit the
+    // listening socket and keep its name bound after this interface exits
+    HuboState::StateNotifier notifier;
+    notifier.open();
 
     while(can.pump() && rt.good())
     {
         state.publish();
+        notifier.notify();
         aux.update();
         agg.update();
     }
@@ -36,8 +36,66 @@
 #include "HuboPath/Player.hpp"
 #include "HuboRT/Daemonizer.hpp"
 
-int main(int, char* [])
+int main(int argc, char* argv[])
 {
+    double prefix_time = 0;
+    hubo_path_underrun_t underrun = HUBO_PATH_UNDERRUN_SLOW;
+    int cache_capacity = -1;
+    std::string cache_directory;
+    for(int i=1; i<argc; ++i)
+    {
+        if(strcmp(argv[i],"progressive")==0)
+        {
+            if(i+1 >= argc)
+            {
+                std::cout << "The 'progressive' argument must be followed by a prefix time!" << std::endl;
+            }
+            else
+            {
+                prefix_time = atof(argv[i+1]);
+            }
+        }
+        else if(strcmp(argv[i],"underrun")==0)
+        {
+            if(i+1 >= argc)
+            {
+                std::cout << "The 'underrun' argument must be followed by hold or slow!" << std::endl;
+            }
+            else if(strcmp(argv[i+1],"hold")==0)
+            {
+                underrun = HUBO_PATH_UNDERRUN_HOLD;
+            }
+            else if(strcmp(argv[i+1],"slow")!=0)
+            {
+                std::cout << "Unknown underrun policy '" << argv[i+1] << "' -- will slow down"
+                          << std::endl;
+            }
+        }
+        else if(strcmp(argv[i],"cache")==0)
+        {
+            if(i+1 >= argc)
+            {
+                std::cout << "The 'cache' argument must be followed by a number of trajectories!"
+                          << std::endl;
+            }
+            else
+            {
+                cache_capacity = std::max(0, atoi(argv[i+1]));
+            }
+        }
+        else if(strcmp(argv[i],"cache_dir")==0)
+        {
+            if(i+1 >= argc)
+            {
+                std::cout << "The 'cache_dir' argument must be followed by a directory!" << std::endl;
+            }
+            else
+            {
+                cache_directory = argv[i+1];
+            }
+        }
+    }
+
     HuboRT::Daemonizer rt;
     if(!rt.begin("player", 40))
     {
@@ -46,6 +104,26 @@ int main(int, char* [])
     
     HuboPath::Player player;
     player.update(10);
+
+    if(prefix_time > 0)
+    {
+        std::cout << "Raw trajectories will start playing once " << prefix_time << "s of them "
+                  << "have arrived (underrun policy: " << underrun << ")" << std::endl;
+        player.set_progressive_playback(prefix_time, underrun);
+    }
+
+    if(cache_capacity >= 0 || !cache_directory.empty())
+    {
+        size_t capacity = cache_capacity >= 0 ? (size_t)cache_capacity
+                                             : player.trajectory_cache().capacity();
+        if(player.set_trajectory_cache(capacity, cache_directory))
+        {
+            std::cout << "Caching up to " << capacity << " interpolated trajectories in memory";
+            if(!cache_directory.empty())
+                std::cout << " and saving them in " << cache_directory;
+            std::cout << std::endl;
+        }
+    }
     
     std::cout << "Beginning execution loop" << std::endl;
     while( player.step() && rt.good() )